@@ -40,10 +40,18 @@
 
 #include <mbf_mesh_core/mesh_planner.h>
 #include <mbf_msgs/GetPathResult.h>
+#include <mesh_map/contraction_hierarchy.h>
 #include <mesh_map/mesh_map.h>
+#include <mesh_map/planner_workspace.h>
+#include <mesh_map/potential_field_cache.h>
+#include <mesh_map/vertex_priority_queue.h>
+#include <mesh_map/workspace_pool.h>
 #include <dijkstra_mesh_planner/DijkstraMeshPlannerConfig.h>
 #include <nav_msgs/Path.h>
 
+#include <future>
+#include <mutex>
+
 namespace dijkstra_mesh_planner
 {
 class DijkstraMeshPlanner : public mbf_mesh_core::MeshPlanner
@@ -89,13 +97,42 @@ public:
                             std::string& message);
 
   /**
-   * @brief Requests the planner to cancel, e.g. if it takes too much time.
+   * @brief Computes plans from many start poses to the same goal pose with one Dijkstra search seeded at the goal,
+   * which runs until the vertices of all start poses are settled. A cached potential field of the goal covering all
+   * start poses is backtracked instead. Neither the vector field of the map, which is followed by the controller, is
+   * replaced nor are the paths published.
+   *
+   * @param goal The goal pose shared by all plans
+   * @param starts The start poses
+   * @param tolerance The goal tolerance, TODO is currently not used
+   * @param outcomes The result outcome code of each plan, see the GetPath action definition
+   * @param plans The computed plans, one per start pose
+   * @param costs The computed costs for the plans
+   * @param message a detailed outcome message
+   */
+  virtual void makePlans(const geometry_msgs::PoseStamped& goal, const std::vector<geometry_msgs::PoseStamped>& starts,
+                         double tolerance, std::vector<uint32_t>& outcomes,
+                         std::vector<std::vector<geometry_msgs::PoseStamped>>& plans, std::vector<double>& costs,
+                         std::string& message);
+
+  /**
+   * @brief Requests the planner to cancel, e.g. if it takes too much time. All running requests are canceled.
    *
    * @return True if a cancel has been successfully requested, false if not
    * implemented.
    */
   virtual bool cancel();
 
+  /**
+   * @brief Each call plans in its own planning context, such that makePlans() may be called concurrently
+   *
+   * @return true
+   */
+  virtual bool supportsConcurrentPlans()
+  {
+    return true;
+  }
+
   /**
    * @brief initializes this planner with the given plugin name and map
    *
@@ -107,49 +144,258 @@ public:
   virtual bool initialize(const std::string& name, const boost::shared_ptr<mesh_map::MeshMap>& mesh_map_ptr);
 
   /**
-   * @brief delivers vector field which has been generated during the latest planning
+   * @brief delivers vector field which has been generated during the latest finished planning
    *
-   * @return vector field of the plan
+   * @return vector field of the plan, shared with the mesh map
    */
-  lvr2::DenseVertexMap<mesh_map::Vector> getVectorMap();
+  mesh_map::VectorFieldSnapshot::ConstPtr getVectorMap();
 
 protected:
   /**
-   * @brief runs dijkstra path planning and stores the resulting distances and predecessors to the fields potential and
-   * predecessors of this class
+   * @brief per request state of the search. Each makePlan call checks out its own context from the pool, such that
+   * multiple requests can be planned concurrently on the same mesh map.
+   */
+  struct PlanningContext
+  {
+    // true if the abort of this request was requested; else false
+    std::atomic_bool canceled;
+    // true if the request uses the incremental search state shared between requests; else false
+    bool incremental;
+    // number of vertices expanded during the search
+    size_t expanded_vertices;
+    // predecessors while wave propagation
+    lvr2::DenseVertexMap<lvr2::VertexHandle> predecessors;
+    // stores the current vector map containing vectors pointing to the source
+    // (path goal)
+    lvr2::DenseVertexMap<mesh_map::Vector> vector_map;
+    // vertices which hold a vector in the vector map
+    std::vector<lvr2::VertexHandle> vector_vertices;
+    // vector field of the request, shared with the mesh map if it is stored as the latest vector field
+    mesh_map::VectorFieldSnapshot::ConstPtr vector_field;
+    // true if the vector field is stored as the latest vector field of the map, false for batch requests
+    bool store_vector_field;
+    // potential field or distance values to the source (path goal)
+    lvr2::DenseVertexMap<float> potential;
+    // cached potential field the request has been backtracked from instead of the potential, if any
+    mesh_map::PotentialField::ConstPtr potential_field;
+    // workspace of the Dijkstra, A* and forward bidirectional search, which restores only the touched vertices
+    mesh_map::PlannerWorkspace workspace;
+    // workspace of the backward bidirectional search
+    mesh_map::PlannerWorkspace backward_workspace;
+    // distances of the backward bidirectional search to the goal vertex
+    lvr2::DenseVertexMap<float> backward_distances;
+    // predecessors of the backward bidirectional search towards the goal vertex
+    lvr2::DenseVertexMap<lvr2::VertexHandle> backward_predecessors;
+    // priority queues of the contraction hierarchy searches, kept to not allocate them for the whole mesh per request
+    mesh_map::VertexPriorityQueue::Ptr forward_queue;
+    mesh_map::VertexPriorityQueue::Ptr backward_queue;
+  };
+
+  /**
+   * @brief plans a single path in the given request context and converts it to a list of poses, without publishing
+   *
+   * @param start[in] start pose of the requested path
+   * @param goal[in] goal pose of the requested path
+   * @param header[in] header of the computed poses
+   * @param plan[out] poses of the path from the start to the goal pose
+   * @param cost[out] length of the path
+   * @param ctx[in,out] state of the request
+   *
+   * @return result code in form of GetPath action result
+   */
+  uint32_t planPath(const geometry_msgs::PoseStamped& start, const geometry_msgs::PoseStamped& goal,
+                    const std_msgs::Header& header, std::vector<geometry_msgs::PoseStamped>& plan, double& cost,
+                    PlanningContext& ctx);
+
+  /**
+   * @brief converts a path of vertices to a list of poses
+   *
+   * @param path[in,out] path from the search seed towards the start, consumed by the conversion
+   * @param start[in] start position of the path
+   * @param goal[in] goal position of the path
+   * @param header[in] header of the computed poses
+   * @param plan[out] poses of the path from the start to the goal position
+   * @param cost[out] length of the path
+   */
+  void pathToPlan(std::list<lvr2::VertexHandle>& path, const mesh_map::Vector& start, const mesh_map::Vector& goal,
+                  const std_msgs::Header& header, std::vector<geometry_msgs::PoseStamped>& plan, double& cost);
+
+  /**
+   * @brief runs one dijkstra search seeded at the given start position until the vertices of all goal positions are
+   * settled and backtracks a path to each of them. The distances and predecessors are stored to the potential and
+   * predecessors of the request context.
+   *
+   * @param start[in] 3D position the search is seeded at
+   * @param goals[in] 3D goal positions of the requested paths
+   * @param paths[out] optimal path from the given starting position to each goal position
+   * @param outcomes[out] result code of each path: SUCCESS, NO_PATH_FOUND or INVALID_GOAL
+   * @param ctx[in,out] state of the request
+   *
+   * @return result code in form of GetPath action result: SUCCESS, INVALID_START, NOT_INITIALIZED and CANCELED are
+   * possible
+   */
+  uint32_t dijkstra(const mesh_map::Vector& start, const std::vector<mesh_map::Vector>& goals,
+                    std::vector<std::list<lvr2::VertexHandle>>& paths, std::vector<uint32_t>& outcomes,
+                    PlanningContext& ctx);
+
+  /**
+   * @brief runs dijkstra path planning and stores the resulting distances and predecessors to the potential and
+   * predecessors of the request context
    *
    * @param start[in] 3D starting position of the requested path
    * @param goal[in] 3D goal position of the requested path
    * @param path[out] optimal path from the given starting position to tie goal position
+   * @param ctx[in,out] state of the request
    *
    * @return result code in form of GetPath action result: SUCCESS, NO_PATH_FOUND, INVALID_START, INVALID_GOAL, and
    * CANCELED are possible
    */
-  uint32_t dijkstra(const mesh_map::Vector& start, const mesh_map::Vector& goal, std::list<lvr2::VertexHandle>& path);
+  uint32_t dijkstra(const mesh_map::Vector& start, const mesh_map::Vector& goal, std::list<lvr2::VertexHandle>& path,
+                    PlanningContext& ctx);
 
   /**
    * @brief runs dijkstra path planning
    *
    * @param start[in] 3D starting position of the requested path
    * @param goal[in] 3D goal position of the requested path
-   * @param edge_weights[in] edge distances of the map
-   * @param costs[in] vertex costs of the map
+   * @param edge_weights[in] edge distances of the map, laid out like the neighbour arrays of the compact mesh
+   * @param costs[in] snapshot of the vertex costs of the map, pinned for the whole search
    * @param path[out] optimal path from the given starting position to tie goal position
    * @param distances[out] per vertex distances to goal
    * @param predecessors[out] dense predecessor map for all visited vertices
+   * @param ctx[in,out] state of the request
    *
    * @return result code in form of GetPath action result: SUCCESS, NO_PATH_FOUND, INVALID_START, INVALID_GOAL, and
    * CANCELED are possible
    */
   uint32_t dijkstra(const mesh_map::Vector& start, const mesh_map::Vector& goal,
-                    const lvr2::DenseEdgeMap<float>& edge_weights, const lvr2::DenseVertexMap<float>& costs,
+                    const std::vector<float>& edge_weights, const mesh_map::CostSnapshot& costs,
                     std::list<lvr2::VertexHandle>& path, lvr2::DenseVertexMap<float>& distances,
-                    lvr2::DenseVertexMap<lvr2::VertexHandle>& predecessors);
+                    lvr2::DenseVertexMap<lvr2::VertexHandle>& predecessors, PlanningContext& ctx);
+
+  /**
+   * @brief runs a bidirectional dijkstra search, growing a search tree from both the start and the goal vertex until
+   * the shortest connection between both trees is found. The predecessors along the backward part of the path are
+   * rewired to point towards the start vertex, such that the path and the vector field along it can be backtracked
+   * as for the unidirectional search.
+   *
+   * @param start_vertex[in] seed vertex of the forward search
+   * @param goal_vertex[in] seed vertex of the backward search
+   * @param edge_weights[in] edge weights of the map, laid out like the neighbour arrays of the compact mesh
+   * @param costs[in] snapshot of the vertex costs of the map
+   * @param distances[out] per vertex distances to the start vertex
+   * @param predecessors[out] dense predecessor map for all vertices visited by the forward search and the path
+   * @param ctx[in,out] state of the request containing the workspaces and the maps of the backward search
+   *
+   * @return number of vertices added to the fixed sets of both searches
+   */
+  size_t bidirectionalDijkstra(const lvr2::VertexHandle& start_vertex, const lvr2::VertexHandle& goal_vertex,
+                               const std::vector<float>& edge_weights, const mesh_map::CostSnapshot& costs,
+                               lvr2::DenseVertexMap<float>& distances,
+                               lvr2::DenseVertexMap<lvr2::VertexHandle>& predecessors, PlanningContext& ctx);
+
+  /**
+   * @brief runs a bidirectional search on the contraction hierarchy. Both searches only follow the upward edges of the
+   * hierarchy and meet at the highest ranked vertex of the shortest path. The path is unpacked into mesh edges and
+   * written to the distances and predecessors, the vertices visited by the upward searches are restored, since they
+   * are connected by shortcuts instead of mesh edges.
+   *
+   * @param hierarchy[in] contraction hierarchy of the vertices passable at the costs of the request
+   * @param start_vertex[in] seed vertex of the forward search
+   * @param goal_vertex[in] seed vertex of the backward search, an impassable goal vertex is entered over its passable
+   * neighbours
+   * @param edge_weights[in] edge weights of the map, laid out like the neighbour arrays of the compact mesh
+   * @param distances[out] distances of the path vertices to the start vertex
+   * @param predecessors[out] predecessors of the path vertices towards the start vertex
+   * @param ctx[in,out] state of the request containing the workspaces and the maps of the backward search
+   *
+   * @return number of vertices added to the fixed sets of both searches
+   */
+  size_t hierarchyDijkstra(const mesh_map::ContractionHierarchy& hierarchy, const lvr2::VertexHandle& start_vertex,
+                           const lvr2::VertexHandle& goal_vertex, const std::vector<float>& edge_weights,
+                           lvr2::DenseVertexMap<float>& distances,
+                           lvr2::DenseVertexMap<lvr2::VertexHandle>& predecessors, PlanningContext& ctx);
 
   /**
-   * @brief calculates the vector field based on the current predecessors map and stores it to the vector_map field of this class
+   * @brief delivers the contraction hierarchy of the vertices which are passable at the given costs. The hierarchy is
+   * kept as long as no vertex crosses the cost limit. Otherwise a background build is started and no hierarchy is
+   * returned, such that the request does not wait for the build.
+   *
+   * @param costs[in] snapshot of the vertex costs of the request
+   *
+   * @return the contraction hierarchy shared by all requests, or a null pointer if it is not up to date yet
    */
-  void computeVectorMap();
+  mesh_map::ContractionHierarchy::ConstPtr contractionHierarchy(const mesh_map::CostSnapshot& costs);
+
+  /**
+   * @brief checks if the contraction hierarchy contains exactly the vertices which are passable at the given costs.
+   * The hierarchy_mutex has to be held by the caller.
+   *
+   * @param costs[in] snapshot of the vertex costs
+   * @param cost_limit[in] cost limit of the passable vertices
+   *
+   * @return true if the hierarchy can be searched at the given costs; else false
+   */
+  bool hierarchyUpToDate(const mesh_map::CostSnapshot& costs, const double cost_limit);
+
+  /**
+   * @brief starts the background build of the contraction hierarchy, unless a build is running already. The
+   * hierarchy_mutex has to be held by the caller.
+   *
+   * @param cost_limit[in] cost limit of the passable vertices
+   */
+  void startHierarchyBuild(const double cost_limit);
+
+  /**
+   * @brief builds the contraction hierarchy of the vertices passable at the latest costs of the map. The hierarchy is
+   * read from the hierarchy file if that file matches the passable vertices, otherwise it is built and written to
+   * the file. Runs in the background, the requests keep using the previous hierarchy or the Dijkstra search.
+   *
+   * @param cost_limit[in] cost limit of the passable vertices
+   */
+  void buildHierarchy(const double cost_limit);
+
+  /**
+   * @brief runs an incremental dijkstra search, which keeps its distances, predecessors and open vertices between
+   * calls with the same start vertex. Vertices whose costs crossed the cost limit since the previous call are
+   * repaired: the subtrees behind vertices which became impassable are reset and re-seeded from their valid
+   * neighbours, vertices which became passable are expanded again. Afterwards the search is continued until the goal
+   * vertex is settled. If the start vertex or the cost limit changed, or the cost changes can not be reconstructed,
+   * the search starts from scratch. The caller has to hold the incremental search lock.
+   *
+   * @param start_vertex[in] seed vertex of the search
+   * @param goal_vertex[in] vertex at which the search stops
+   * @param edge_weights[in] edge weights of the map, laid out like the neighbour arrays of the compact mesh
+   * @param costs[in] snapshot of the vertex costs of the map, its version is compared against the recorded cost
+   * changes
+   * @param distances[in,out] per vertex distances to the start vertex
+   * @param predecessors[in,out] dense predecessor map for all visited vertices
+   * @param ctx[in,out] state of the request
+   *
+   * @return number of vertices added to the fixed set
+   */
+  size_t incrementalDijkstra(const lvr2::VertexHandle& start_vertex, const lvr2::VertexHandle& goal_vertex,
+                             const std::vector<float>& edge_weights, const mesh_map::CostSnapshot& costs,
+                             lvr2::DenseVertexMap<float>& distances,
+                             lvr2::DenseVertexMap<lvr2::VertexHandle>& predecessors, PlanningContext& ctx);
+
+  /**
+   * @brief delivers a human readable name of the given search mode
+   *
+   * @param search_mode search mode as defined in the DijkstraMeshPlanner config
+   *
+   * @return name of the search mode
+   */
+  static std::string searchModeName(const int search_mode);
+
+  /**
+   * @brief calculates the vector field based on the given predecessors map and stores it to the vector field of the
+   * request context
+   *
+   * @param predecessors predecessors of the search
+   * @param ctx state of the request
+   */
+  void computeVectorMap(const lvr2::DenseVertexMap<lvr2::VertexHandle>& predecessors, PlanningContext& ctx);
 
   /**
    * @brief gets called on new incoming reconfigure parameters
@@ -166,8 +412,6 @@ private:
   std::string name;
   // node handle
   ros::NodeHandle private_nh;
-  // true if the abort of the current planning was requested; else false
-  std::atomic_bool cancel_planning;
   // publisher of resulting path
   ros::Publisher path_pub;
   // publisher of resulting vector fiels
@@ -178,6 +422,43 @@ private:
   std::string map_frame;
   // offset of maximum distance from goal position
   float goal_dist_offset;
+  // priority queue implementation used for the propagation
+  mesh_map::PriorityQueueType priority_queue_type;
+  // contexts of the running requests and idle contexts kept for later requests
+  mesh_map::WorkspacePool<PlanningContext> contexts;
+
+  // guards the incremental search state, which is used by one request at a time
+  std::mutex incremental_mutex;
+  // true if the incremental search state is consistent with the potential and predecessors; else false
+  bool incremental_valid;
+  // seed vertex of the incremental search
+  lvr2::VertexHandle incremental_seed;
+  // costs version of the map the incremental search is up to date with
+  uint64_t incremental_version;
+  // cost limit used by the incremental search
+  double incremental_cost_limit;
+  // open vertices of the incremental search
+  mesh_map::VertexPriorityQueue::Ptr incremental_pq;
+  // vertices which have been expanded with their current distance by the incremental search
+  lvr2::DenseVertexMap<bool> incremental_fixed;
+  // vertices with costs within the cost limit at the costs version of the incremental search
+  lvr2::DenseVertexMap<bool> incremental_passable;
+  // distances of the incremental search to its seed vertex
+  lvr2::DenseVertexMap<float> incremental_distances;
+  // predecessors of the incremental search towards its seed vertex
+  lvr2::DenseVertexMap<lvr2::VertexHandle> incremental_predecessors;
+  // guards the contraction hierarchy, its version and its cost limit, and the background build
+  std::mutex hierarchy_mutex;
+  // contraction hierarchy of the passable vertices, shared by all requests
+  mesh_map::ContractionHierarchy::ConstPtr hierarchy;
+  // costs version of the map the contraction hierarchy is up to date with
+  uint64_t hierarchy_version;
+  // cost limit the contraction hierarchy has been built with
+  double hierarchy_cost_limit;
+  // file the contraction hierarchy is stored in, empty to rebuild it on every start
+  std::string hierarchy_file;
+  // background build of the contraction hierarchy, invalid if no build has been started yet
+  std::future<void> hierarchy_build;
   // Server for Reconfiguration
   boost::shared_ptr<dynamic_reconfigure::Server<dijkstra_mesh_planner::DijkstraMeshPlannerConfig>>
       reconfigure_server_ptr;
@@ -185,15 +466,10 @@ private:
   bool first_config;
   DijkstraMeshPlannerConfig config;
 
-  // predecessors while wave propagation
-  lvr2::DenseVertexMap<lvr2::VertexHandle> predecessors;
-  // the face which is cut by line to the source
-  lvr2::DenseVertexMap<lvr2::FaceHandle> cutting_faces;
-  // stores the current vector map containing vectors pointing to the source
-  // (path goal)
-  lvr2::DenseVertexMap<mesh_map::Vector> vector_map;
-  // potential field or distance values to the source (path goal)
-  lvr2::DenseVertexMap<float> potential;
+  // vector field of the latest finished plan, shared with the mesh map and accessed atomically
+  mesh_map::VectorFieldSnapshot::ConstPtr vector_field;
+  // completed searches of recent goals, which are reused for repeated plans to the same goal
+  mesh_map::PotentialFieldCache potential_cache;
 };
 
 }  // namespace dijkstra_mesh_planner
@@ -38,9 +38,10 @@
 // TODO fix lvr2 missing imports
 #include <lvr2/geometry/Handles.hpp>
 using namespace std;
+#include <algorithm>
+#include <chrono>
 #include <unordered_set>
 
-#include <lvr2/util/Meap.hpp>
 #include <mbf_msgs/GetPathResult.h>
 #include <mesh_map/util.h>
 #include <pluginlib/class_list_macros.h>
@@ -52,37 +53,134 @@ PLUGINLIB_EXPORT_CLASS(dijkstra_mesh_planner::DijkstraMeshPlanner, mbf_mesh_core
 namespace dijkstra_mesh_planner
 {
 DijkstraMeshPlanner::DijkstraMeshPlanner()
+  : incremental_valid(false), incremental_seed(0), incremental_version(0)
+  , incremental_cost_limit(0), hierarchy_version(0), hierarchy_cost_limit(0)
 {
 }
 
 DijkstraMeshPlanner::~DijkstraMeshPlanner()
 {
+  // the background build of the contraction hierarchy accesses the planner
+  if (hierarchy_build.valid())
+    hierarchy_build.wait();
 }
 
 uint32_t DijkstraMeshPlanner::makePlan(const geometry_msgs::PoseStamped& start, const geometry_msgs::PoseStamped& goal,
                                        double tolerance, std::vector<geometry_msgs::PoseStamped>& plan, double& cost,
                                        std::string& message)
 {
-  const auto& mesh = mesh_map->mesh();
-  std::list<lvr2::VertexHandle> path;
   ROS_INFO("start dijkstra mesh planner.");
 
-  mesh_map::Vector goal_vec = mesh_map::toVector(goal.pose.position);
-  mesh_map::Vector start_vec = mesh_map::toVector(start.pose.position);
+  // check out the state of this request, concurrent requests use their own contexts
+  const mesh_map::WorkspacePool<PlanningContext>::Lease ctx_lease = contexts.acquire();
+  PlanningContext& ctx = *ctx_lease;
+  ctx.store_vector_field = true;
 
-  // call dijkstra with the goal pose as seed / start vertex
-  uint32_t outcome = dijkstra(goal_vec, start_vec, path);
+  std_msgs::Header header;
+  header.stamp = ros::Time::now();
+  header.frame_id = mesh_map->mapFrame();
 
-  path.reverse();
+  uint32_t outcome = planPath(start, goal, header, plan, cost, ctx);
+
+  message = "Expanded " + std::to_string(ctx.expanded_vertices) + " vertices using the " +
+            searchModeName(config.search_mode) + " search.";
+
+  ROS_INFO_STREAM("Path length: " << cost << "m");
+  nav_msgs::Path path_msg;
+  path_msg.poses = plan;
+  path_msg.header = header;
+
+  path_pub.publish(path_msg);
+  if (ctx.potential_field)
+    mesh_map->publishVertexCosts(ctx.potential_field->potential, "Potential");
+  else
+    mesh_map->publishVertexCosts(ctx.potential, "Potential");
+
+  ROS_INFO_STREAM("Path length: " << cost << "m");
+
+  if (publish_vector_field && ctx.vector_field)
+  {
+    mesh_map->publishVectorField("vector_field", ctx.vector_field->vector_map, publish_face_vectors);
+  }
+
+  return outcome;
+}
+
+void DijkstraMeshPlanner::makePlans(const geometry_msgs::PoseStamped& goal,
+                                    const std::vector<geometry_msgs::PoseStamped>& starts, double tolerance,
+                                    std::vector<uint32_t>& outcomes,
+                                    std::vector<std::vector<geometry_msgs::PoseStamped>>& plans,
+                                    std::vector<double>& costs, std::string& message)
+{
+  std::vector<std::list<lvr2::VertexHandle>> paths;
+
+  // check out the state of this request, concurrent requests use their own contexts
+  const mesh_map::WorkspacePool<PlanningContext>::Lease ctx_lease = contexts.acquire();
+  PlanningContext& ctx = *ctx_lease;
+  // what-if requests must not change the vector field the controller follows
+  ctx.store_vector_field = false;
+
+  const mesh_map::Vector goal_vec = mesh_map::toVector(goal.pose.position);
+  std::vector<mesh_map::Vector> start_vecs;
+  start_vecs.reserve(starts.size());
+  for (const auto& start : starts)
+  {
+    start_vecs.push_back(mesh_map::toVector(start.pose.position));
+  }
+
+  // one search from the goal, which stops as soon as the vertices of all start poses are settled
+  const uint32_t outcome = dijkstra(goal_vec, start_vecs, paths, outcomes, ctx);
+  if (outcome != mbf_msgs::GetPathResult::SUCCESS)
+    outcomes.assign(starts.size(), outcome);
 
   std_msgs::Header header;
   header.stamp = ros::Time::now();
   header.frame_id = mesh_map->mapFrame();
 
+  plans.assign(starts.size(), std::vector<geometry_msgs::PoseStamped>());
+  costs.assign(starts.size(), 0);
+  size_t num_planned = 0;
+  for (size_t i = 0; i < starts.size(); i++)
+  {
+    if (outcomes[i] != mbf_msgs::GetPathResult::SUCCESS)
+      continue;
+    pathToPlan(paths[i], start_vecs[i], goal_vec, header, plans[i], costs[i]);
+    num_planned++;
+  }
+
+  message = "Planned " + std::to_string(num_planned) + " of " + std::to_string(starts.size()) + " paths and expanded " +
+            std::to_string(ctx.expanded_vertices) + " vertices using one Dijkstra search.";
+  ROS_INFO_STREAM(message);
+}
+
+uint32_t DijkstraMeshPlanner::planPath(const geometry_msgs::PoseStamped& start, const geometry_msgs::PoseStamped& goal,
+                                       const std_msgs::Header& header, std::vector<geometry_msgs::PoseStamped>& plan,
+                                       double& cost, PlanningContext& ctx)
+{
+  std::list<lvr2::VertexHandle> path;
+
+  mesh_map::Vector goal_vec = mesh_map::toVector(goal.pose.position);
+  mesh_map::Vector start_vec = mesh_map::toVector(start.pose.position);
+
+  // call dijkstra with the goal pose as seed / start vertex
+  uint32_t outcome = dijkstra(goal_vec, start_vec, path, ctx);
+
+  pathToPlan(path, start_vec, goal_vec, header, plan, cost);
+  return outcome;
+}
+
+void DijkstraMeshPlanner::pathToPlan(std::list<lvr2::VertexHandle>& path, const mesh_map::Vector& start,
+                                     const mesh_map::Vector& goal, const std_msgs::Header& header,
+                                     std::vector<geometry_msgs::PoseStamped>& plan, double& cost)
+{
+  const auto& mesh = mesh_map->mesh();
+
+  path.reverse();
+
   cost = 0;
   if (!path.empty())
   {
-    mesh_map::Vector& vec = start_vec;
+    mesh_map::Vector vec = start;
     const auto& vertex_normals = mesh_map->vertexNormals();
     mesh_map::Normal normal = vertex_normals[path.front()];
 
@@ -103,32 +201,16 @@ uint32_t DijkstraMeshPlanner::makePlan(const geometry_msgs::PoseStamped& start,
       plan.push_back(pose);
       path.pop_front();
     }
-    pose.pose = mesh_map::calculatePoseFromPosition(vec, goal_vec, normal, dir_length);
+    pose.pose = mesh_map::calculatePoseFromPosition(vec, goal, normal, dir_length);
     cost += dir_length;
     plan.push_back(pose);
   }
-
-  ROS_INFO_STREAM("Path length: " << cost << "m");
-  nav_msgs::Path path_msg;
-  path_msg.poses = plan;
-  path_msg.header = header;
-
-  path_pub.publish(path_msg);
-  mesh_map->publishVertexCosts(potential, "Potential");
-
-  ROS_INFO_STREAM("Path length: " << cost << "m");
-
-  if (publish_vector_field)
-  {
-    mesh_map->publishVectorField("vector_field", vector_map, publish_face_vectors);
-  }
-
-  return outcome;
 }
 
 bool DijkstraMeshPlanner::cancel()
 {
-  cancel_planning = true;
+  // the cancel request carries no request id, all running requests are canceled
+  contexts.cancelAll();
   return true;
 }
 
@@ -144,6 +226,13 @@ bool DijkstraMeshPlanner::initialize(const std::string& plugin_name,
   private_nh.param("publish_face_vectors", publish_face_vectors, false);
   private_nh.param("goal_dist_offset", goal_dist_offset, 0.3f);
 
+  priority_queue_type = mesh_map::readPriorityQueueType(private_nh);
+
+  // the contraction hierarchy is stored next to the map file by default
+  const std::string& map_file = mesh_map->mapFile();
+  private_nh.param<std::string>("contraction_hierarchy_file", hierarchy_file,
+                                map_file.empty() ? "" : map_file + "." + name + ".ch");
+
   path_pub = private_nh.advertise<nav_msgs::Path>("path", 1, true);
   const auto& mesh = mesh_map->mesh();
 
@@ -157,14 +246,24 @@ bool DijkstraMeshPlanner::initialize(const std::string& plugin_name,
   return true;
 }
 
-lvr2::DenseVertexMap<mesh_map::Vector> DijkstraMeshPlanner::getVectorMap()
+mesh_map::VectorFieldSnapshot::ConstPtr DijkstraMeshPlanner::getVectorMap()
 {
-  return vector_map;
+  return std::atomic_load(&vector_field);
 }
 
 void DijkstraMeshPlanner::reconfigureCallback(dijkstra_mesh_planner::DijkstraMeshPlannerConfig& cfg, uint32_t level)
 {
   ROS_INFO_STREAM("New height diff layer config through dynamic reconfigure.");
+
+  // the contraction hierarchy is loaded or built in the background as soon as it is configured, which is already the
+  // case for the initial config set during the initialization
+  if (cfg.search_mode == DijkstraMeshPlanner_ContractionHierarchy)
+  {
+    std::lock_guard<std::mutex> lock(hierarchy_mutex);
+    if (!hierarchy || hierarchy_cost_limit != cfg.cost_limit)
+      startHierarchyBuild(cfg.cost_limit);
+  }
+
   if (first_config)
   {
     config = cfg;
@@ -174,16 +273,31 @@ void DijkstraMeshPlanner::reconfigureCallback(dijkstra_mesh_planner::DijkstraMes
   config = cfg;
 }
 
-void DijkstraMeshPlanner::computeVectorMap()
+std::string DijkstraMeshPlanner::searchModeName(const int search_mode)
+{
+  switch (search_mode)
+  {
+    case DijkstraMeshPlanner_AStar:
+      return "A*";
+    case DijkstraMeshPlanner_Bidirectional:
+      return "bidirectional Dijkstra";
+    case DijkstraMeshPlanner_ContractionHierarchy:
+      return "contraction hierarchy";
+    default:
+      return "Dijkstra";
+  }
+}
+
+void DijkstraMeshPlanner::computeVectorMap(const lvr2::DenseVertexMap<lvr2::VertexHandle>& predecessors,
+                                           PlanningContext& ctx)
 {
   const auto& mesh = mesh_map->mesh();
 
-  for (auto v3 : mesh.vertices())
-  {
+  auto computeVector = [&](const lvr2::VertexHandle& v3) {
     const lvr2::VertexHandle& v1 = predecessors[v3];
     // if predecessor is pointing to it self, continue with the next vertex.
     if (v1 == v3)
-      continue;
+      return;
 
     const auto& vec3 = mesh.getVertexPosition(v3);
     const auto& vec1 = mesh.getVertexPosition(v1);
@@ -191,28 +305,239 @@ void DijkstraMeshPlanner::computeVectorMap()
     // compute the direction vector and store it in the direction vertex map
     const auto dirVec = vec1 - vec3;
     // store the normalized rotated vector in the vector map
-    vector_map.insert(v3, dirVec.normalized());
+    ctx.vector_map.insert(v3, dirVec.normalized());
+    ctx.vector_vertices.push_back(v3);
+  };
+
+  // only the vertices touched by the search can have a predecessor, unless the incremental search wrote the maps
+  if (ctx.incremental)
+  {
+    for (auto v3 : mesh.vertices())
+      computeVector(v3);
+  }
+  else
+  {
+    for (auto v3 : ctx.workspace.touchedVertices())
+      computeVector(v3);
+  }
+
+  // hand the vector map over to the mesh map without copying it, the request keeps a reference for publishing it.
+  // Concurrent requests replace the latest vector field of the map in the order they finish.
+  if (ctx.store_vector_field)
+  {
+    ctx.vector_field = mesh_map->setVectorMap(std::move(ctx.vector_map), std::move(ctx.vector_vertices));
+    std::atomic_store(&vector_field, ctx.vector_field);
+  }
+  else
+  {
+    ctx.vector_field = mesh_map->createVectorField(std::move(ctx.vector_map), std::move(ctx.vector_vertices));
   }
-  mesh_map->setVectorMap(vector_map);
 }
 
 uint32_t DijkstraMeshPlanner::dijkstra(const mesh_map::Vector& start, const mesh_map::Vector& goal,
-                                       std::list<lvr2::VertexHandle>& path)
+                                       std::list<lvr2::VertexHandle>& path, PlanningContext& ctx)
 {
-  return dijkstra(start, goal, mesh_map->edgeDistances(), mesh_map->vertexCosts(), path, potential, predecessors);
+  // pin the current costs for the whole search, concurrent layer updates publish a new snapshot
+  const mesh_map::CostSnapshot::ConstPtr cost_snapshot = mesh_map->costSnapshot();
+  if (!cost_snapshot)
+    return mbf_msgs::GetPathResult::NOT_INITIALIZED;
+  const std::vector<float>& edge_weights = mesh_map->compactMesh().neighbourDistances();
+
+  // the incremental search state is shared by all requests, concurrent requests fall back to a regular search
+  std::unique_lock<std::mutex> incremental_lock(incremental_mutex, std::defer_lock);
+  const bool incremental_requested = config.incremental && config.search_mode == DijkstraMeshPlanner_Dijkstra;
+  ctx.incremental = incremental_requested && incremental_lock.try_lock();
+  if (incremental_requested && !ctx.incremental)
+    ROS_INFO_STREAM("The incremental search is used by another request, running a regular Dijkstra search.");
+
+  if (!ctx.incremental)
+    return dijkstra(start, goal, edge_weights, *cost_snapshot, path, ctx.potential, ctx.predecessors, ctx);
+
+  const uint32_t outcome =
+      dijkstra(start, goal, edge_weights, *cost_snapshot, path, incremental_distances, incremental_predecessors, ctx);
+  // the incremental maps are kept for the next request, the context receives a copy of the potential for publishing
+  ctx.potential = incremental_distances;
+  ctx.workspace.invalidate();
+  return outcome;
+}
+
+uint32_t DijkstraMeshPlanner::dijkstra(const mesh_map::Vector& original_start,
+                                       const std::vector<mesh_map::Vector>& original_goals,
+                                       std::vector<std::list<lvr2::VertexHandle>>& paths,
+                                       std::vector<uint32_t>& outcomes, PlanningContext& ctx)
+{
+  // pin the current costs for the whole search, concurrent layer updates publish a new snapshot
+  const mesh_map::CostSnapshot::ConstPtr cost_snapshot = mesh_map->costSnapshot();
+  if (!cost_snapshot)
+    return mbf_msgs::GetPathResult::NOT_INITIALIZED;
+  const mesh_map::CostSnapshot& costs = *cost_snapshot;
+  const std::vector<float>& edge_weights = mesh_map->compactMesh().neighbourDistances();
+
+  const auto& mesh = mesh_map->mesh();
+  const auto& graph = mesh_map->compactMesh();
+  const auto& neighbours = graph.neighbourVertices();
+  const auto& vertex_costs = costs.vertex_costs;
+  const auto& invalid = mesh_map->invalid;
+
+  lvr2::DenseVertexMap<float>& distances = ctx.potential;
+  lvr2::DenseVertexMap<lvr2::VertexHandle>& predecessors = ctx.predecessors;
+  ctx.incremental = false;
+  ctx.expanded_vertices = 0;
+  ctx.potential_field.reset();
+  paths.assign(original_goals.size(), std::list<lvr2::VertexHandle>());
+  outcomes.assign(original_goals.size(), mbf_msgs::GetPathResult::NO_PATH_FOUND);
+
+  const auto& start_opt = mesh_map->getNearestVertexHandle(original_start);
+  if (!start_opt)
+    return mbf_msgs::GetPathResult::INVALID_START;
+  const lvr2::VertexHandle start_vertex = start_opt.unwrap();
+
+  // the vertices the search has to settle, sorted to look them up while popping the vertices
+  std::vector<lvr2::VertexHandle> goal_vertices(original_goals.size(), start_vertex);
+  std::vector<lvr2::Index> pending;
+  for (size_t i = 0; i < original_goals.size(); i++)
+  {
+    const auto& goal_opt = mesh_map->getNearestVertexHandle(original_goals[i]);
+    if (!goal_opt)
+    {
+      outcomes[i] = mbf_msgs::GetPathResult::INVALID_GOAL;
+      continue;
+    }
+    goal_vertices[i] = goal_opt.unwrap();
+    pending.push_back(goal_vertices[i].idx());
+  }
+  std::sort(pending.begin(), pending.end());
+  pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+
+  auto backtrackPaths = [&](const lvr2::VertexMap<lvr2::VertexHandle>& field_predecessors) {
+    for (size_t i = 0; i < goal_vertices.size(); i++)
+    {
+      if (outcomes[i] == mbf_msgs::GetPathResult::INVALID_GOAL)
+        continue;
+      if (goal_vertices[i] != start_vertex && field_predecessors[goal_vertices[i]] == goal_vertices[i])
+        continue;
+
+      auto vH = goal_vertices[i];
+      while (vH != start_vertex)
+      {
+        vH = field_predecessors[vH];
+        paths[i].push_front(vH);
+      }
+      outcomes[i] = mbf_msgs::GetPathResult::SUCCESS;
+    }
+  };
+
+  // the search is seeded at the shared goal, the cached potential field of a previous batch may already cover it
+  potential_cache.setCapacity(config.potential_cache_size);
+  const mesh_map::PotentialField::ConstPtr cached_field = potential_cache.find(
+      start_vertex.idx(), mesh.getVertexPosition(start_vertex), 0, costs.version, config.cost_limit);
+  std::vector<lvr2::VertexHandle> pending_vertices;
+  for (const lvr2::Index index : pending)
+  {
+    pending_vertices.push_back(lvr2::VertexHandle(index));
+  }
+  if (cached_field && cached_field->covers(pending_vertices))
+  {
+    ROS_INFO_STREAM("Reusing the cached potential field of the goal, only backtracking the paths.");
+    ctx.potential_field = cached_field;
+    ctx.vector_field = cached_field->vector_field;
+    backtrackPaths(cached_field->predecessors);
+    return mbf_msgs::GetPathResult::SUCCESS;
+  }
+
+  ctx.workspace.reset(mesh, distances, predecessors);
+  mesh_map::StampedVertexFlags& fixed = ctx.workspace.fixed();
+
+  // the vector map of the previous request has been moved into its vector field snapshot, a released one is recycled
+  ctx.vector_map = mesh_map->acquireVectorMap();
+  ctx.vector_vertices.clear();
+
+  mesh_map::VertexPriorityQueue::Ptr pq_ptr =
+      mesh_map::createVertexPriorityQueue(priority_queue_type, mesh.nextVertexIndex());
+  mesh_map::VertexPriorityQueue& pq = *pq_ptr;
+
+  ctx.workspace.touch(start_vertex);
+  distances[start_vertex] = 0;
+  pq.insert(start_vertex, 0);
+
+  size_t num_pending = pending.size();
+  float goal_dist = num_pending == 0 ? 0 : std::numeric_limits<float>::infinity();
+
+  while (!pq.isEmpty() && !ctx.canceled)
+  {
+    lvr2::VertexHandle current_vh = pq.popMin();
+    fixed.set(current_vh);
+
+    // the search continues by the goal distance offset beyond the last settled start vertex, like a single search
+    if (num_pending > 0 && std::binary_search(pending.begin(), pending.end(), current_vh.idx()) && --num_pending == 0)
+      goal_dist = distances[current_vh] + goal_dist_offset;
+
+    if (distances[current_vh] > goal_dist)
+      break;
+
+    if (vertex_costs[current_vh] > config.cost_limit)
+      continue;
+
+    ctx.expanded_vertices++;
+
+    const lvr2::Index neighbours_end = graph.neighboursEnd(current_vh);
+    for (lvr2::Index i = graph.neighboursBegin(current_vh); i < neighbours_end; i++)
+    {
+      const lvr2::VertexHandle vH(neighbours[i]);
+      if (fixed[vH] || invalid[vH])
+        continue;
+
+      const float tmp_cost = distances[current_vh] + edge_weights[i];
+      if (tmp_cost < distances[vH])
+      {
+        ctx.workspace.touch(vH);
+        distances[vH] = tmp_cost;
+        pq.insert(vH, tmp_cost);
+        predecessors[vH] = current_vh;
+      }
+    }
+  }
+
+  if (ctx.canceled)
+  {
+    ROS_WARN_STREAM("Dijkstra has been canceled!");
+    return mbf_msgs::GetPathResult::CANCELED;
+  }
+
+  backtrackPaths(predecessors);
+  computeVectorMap(predecessors, ctx);
+
+  if (config.potential_cache_size > 0)
+  {
+    auto field = std::make_shared<mesh_map::PotentialField>();
+    field->seed = mesh.getVertexPosition(start_vertex);
+    field->seed_index = start_vertex.idx();
+    field->costs_version = costs.version;
+    field->cost_limit = config.cost_limit;
+    field->storeSettled(ctx.workspace.touchedVertices(), distances, predecessors, fixed);
+    field->vector_field = ctx.vector_field;
+    potential_cache.insert(field);
+  }
+
+  ROS_INFO_STREAM("Expanded " << ctx.expanded_vertices << " vertices for " << original_goals.size()
+                              << " start poses using one Dijkstra search.");
+  return mbf_msgs::GetPathResult::SUCCESS;
 }
 
 uint32_t DijkstraMeshPlanner::dijkstra(const mesh_map::Vector& original_start, const mesh_map::Vector& original_goal,
-                                       const lvr2::DenseEdgeMap<float>& edge_weights,
-                                       const lvr2::DenseVertexMap<float>& costs, std::list<lvr2::VertexHandle>& path,
+                                       const std::vector<float>& edge_weights,
+                                       const mesh_map::CostSnapshot& costs, std::list<lvr2::VertexHandle>& path,
                                        lvr2::DenseVertexMap<float>& distances,
-                                       lvr2::DenseVertexMap<lvr2::VertexHandle>& predecessors)
+                                       lvr2::DenseVertexMap<lvr2::VertexHandle>& predecessors,
+                                       PlanningContext& ctx)
 {
   ROS_INFO_STREAM("Init wave front propagation.");
   ros::WallTime t_initialization_start = ros::WallTime::now();
 
   const auto& mesh = mesh_map->mesh();
-  const auto& vertex_costs = mesh_map->vertexCosts();
+  const auto& graph = mesh_map->compactMesh();
+  const auto& neighbours = graph.neighbourVertices();
+  const auto& vertex_costs = costs.vertex_costs;
 
   auto& invalid = mesh_map->invalid;
 
@@ -222,8 +547,8 @@ uint32_t DijkstraMeshPlanner::dijkstra(const mesh_map::Vector& original_start, c
   // Find the closest vertex handle of start and goal
   const auto& start_opt = mesh_map->getNearestVertexHandle(original_start);
   const auto& goal_opt = mesh_map->getNearestVertexHandle(original_goal);
-  // reset cancel planning
-  cancel_planning = false;
+  ctx.expanded_vertices = 0;
+  ctx.potential_field.reset();
 
   if (!start_opt)
     return mbf_msgs::GetPathResult::INVALID_START;
@@ -233,110 +558,157 @@ uint32_t DijkstraMeshPlanner::dijkstra(const mesh_map::Vector& original_start, c
   const auto& start_vertex = start_opt.unwrap();
   const auto& goal_vertex = goal_opt.unwrap();
 
+  int search_mode = ctx.incremental ? static_cast<int>(DijkstraMeshPlanner_Dijkstra) : config.search_mode;
+  const bool incremental = ctx.incremental;
+
+  // the contraction hierarchy is built in the background, the requests use the Dijkstra search until it is ready
+  mesh_map::ContractionHierarchy::ConstPtr hierarchy_ptr;
+  if (search_mode == DijkstraMeshPlanner_ContractionHierarchy)
+  {
+    hierarchy_ptr = contractionHierarchy(costs);
+    if (!hierarchy_ptr)
+    {
+      ROS_INFO_STREAM("The contraction hierarchy is not up to date yet, using the Dijkstra search instead.");
+      search_mode = DijkstraMeshPlanner_Dijkstra;
+    }
+  }
+
   path.clear();
-  distances.clear();
-  predecessors.clear();
+  mesh_map::StampedVertexFlags& fixed = ctx.workspace.fixed();
+  if (!incremental)
+  {
+    // the incremental search keeps its own maps, only the maps of this request are reset
+    ctx.workspace.reset(mesh, distances, predecessors);
+  }
 
   if (goal_vertex == start_vertex)
   {
     return mbf_msgs::GetPathResult::SUCCESS;
   }
 
-  lvr2::DenseVertexMap<bool> fixed(mesh.nextVertexIndex(), false);
-
-  // clear vector field map
-  vector_map.clear();
-
-  ros::WallTime t_start, t_end;
-  t_start = ros::WallTime::now();
-
-  // initialize distances with infinity
-  // initialize predecessor of each vertex with itself
-  for (auto const& vH : mesh.vertices())
+  // a unidirectional search seeded at the same vertex can be backtracked from any vertex it has settled
+  const bool cacheable = !incremental && (search_mode == DijkstraMeshPlanner_Dijkstra ||
+                                          search_mode == DijkstraMeshPlanner_AStar);
+  potential_cache.setCapacity(config.potential_cache_size);
+  const mesh_map::PotentialField::ConstPtr cached_field =
+      cacheable ? potential_cache.find(start_vertex.idx(), mesh.getVertexPosition(start_vertex), 0, costs.version,
+                                       config.cost_limit) :
+                  mesh_map::PotentialField::ConstPtr();
+  if (cached_field && cached_field->covers(std::array<lvr2::VertexHandle, 1>{ goal_vertex }))
   {
-    distances.insert(vH, std::numeric_limits<float>::infinity());
-    predecessors.insert(vH, vH);
+    // the path is backtracked along the cached predecessors, the maps of the context stay untouched
+    ROS_INFO_STREAM("Reusing the cached potential field of the goal, only backtracking the path.");
+    ctx.potential_field = cached_field;
+    auto vH = goal_vertex;
+    while (vH != start_vertex)
+    {
+      vH = cached_field->predecessors[vH];
+      path.push_front(vH);
+    }
+    ctx.vector_field = cached_field->vector_field;
+    if (ctx.store_vector_field)
+    {
+      mesh_map->setVectorField(ctx.vector_field);
+      std::atomic_store(&vector_field, ctx.vector_field);
+    }
+    return mbf_msgs::GetPathResult::SUCCESS;
   }
 
-  lvr2::Meap<lvr2::VertexHandle, float> pq;
+  // the vector map of the previous request has been moved into its vector field snapshot, a released one is recycled
+  ctx.vector_map = mesh_map->acquireVectorMap();
+  ctx.vector_vertices.clear();
 
-  // Set start distance to zero
-  // add start vertex to priority queue
-  distances[start_vertex] = 0;
-  pq.insert(start_vertex, 0);
-
-  float goal_dist = std::numeric_limits<float>::infinity();
+  ros::WallTime t_start, t_end;
+  t_start = ros::WallTime::now();
 
-  ROS_INFO_STREAM("Start Dijkstra");
+  ROS_INFO_STREAM("Start " << searchModeName(search_mode) << " search");
   ros::WallTime t_propagation_start = ros::WallTime::now();
   double initialization_duration = (t_propagation_start - t_initialization_start).toNSec() * 1e-6;
 
   size_t fixed_set_cnt = 0;
 
-  while (!pq.isEmpty() && !cancel_planning)
+  if (incremental)
   {
-    lvr2::VertexHandle current_vh = pq.popMin().key();
-    fixed[current_vh] = true;
-    fixed_set_cnt++;
-
-    if (current_vh == goal_vertex)
+    fixed_set_cnt =
+        incrementalDijkstra(start_vertex, goal_vertex, edge_weights, costs, distances, predecessors, ctx);
+  }
+  else if (search_mode == DijkstraMeshPlanner_Bidirectional)
+  {
+    fixed_set_cnt =
+        bidirectionalDijkstra(start_vertex, goal_vertex, edge_weights, costs, distances, predecessors, ctx);
+  }
+  else if (search_mode == DijkstraMeshPlanner_ContractionHierarchy)
+  {
+    fixed_set_cnt = hierarchyDijkstra(*hierarchy_ptr, start_vertex, goal_vertex, edge_weights, distances,
+                                      predecessors, ctx);
+  }
+  else
+  {
+    // A* orders the vertices by their distance plus the Euclidean distance to the goal vertex, which is a lower
+    // bound of the remaining path length, since every edge weight is at least as long as the edge itself.
+    const bool use_heuristic = search_mode == DijkstraMeshPlanner_AStar;
+    const mesh_map::Vector goal_position = mesh.getVertexPosition(goal_vertex);
+    mesh_map::VertexPriorityQueue::Ptr pq_ptr =
+        mesh_map::createVertexPriorityQueue(priority_queue_type, mesh.nextVertexIndex());
+    mesh_map::VertexPriorityQueue& pq = *pq_ptr;
+
+    // Set start distance to zero
+    // add start vertex to priority queue
+    ctx.workspace.touch(start_vertex);
+    distances[start_vertex] = 0;
+    pq.insert(start_vertex, use_heuristic ? goal_position.distance(mesh.getVertexPosition(start_vertex)) : 0);
+
+    float goal_dist = std::numeric_limits<float>::infinity();
+
+    while (!pq.isEmpty() && !ctx.canceled)
     {
-      ROS_INFO_STREAM("The Dijkstra Mesh Planner reached the goal.");
-      goal_dist = distances[current_vh] + goal_dist_offset;
-    }
+      lvr2::VertexHandle current_vh = pq.popMin();
+      fixed.set(current_vh);
+      fixed_set_cnt++;
 
-    if (distances[current_vh] > goal_dist)
-      continue;
+      if (current_vh == goal_vertex)
+      {
+        ROS_INFO_STREAM("The Dijkstra Mesh Planner reached the goal.");
+        goal_dist = distances[current_vh] + goal_dist_offset;
+      }
 
-    if (vertex_costs[current_vh] > config.cost_limit)
-      continue;
+      // the vertices are popped in ascending key order, all remaining vertices are beyond the goal distance
+      float current_key = distances[current_vh];
+      if (use_heuristic)
+        current_key += goal_position.distance(mesh.getVertexPosition(current_vh));
+      if (current_key > goal_dist)
+        break;
 
-    std::vector<lvr2::EdgeHandle> edges;
-    try
-    {
-      mesh.getEdgesOfVertex(current_vh, edges);
-    }
-    catch (lvr2::PanicException exception)
-    {
-      invalid.insert(current_vh, true);
-      continue;
-    }
-    catch (lvr2::VertexLoopException exception)
-    {
-      invalid.insert(current_vh, true);
-      continue;
-    }
-    for (auto eH : edges)
-    {
-      try
+      if (vertex_costs[current_vh] > config.cost_limit)
+        continue;
+
+      ctx.expanded_vertices++;
+
+      const lvr2::Index neighbours_end = graph.neighboursEnd(current_vh);
+      for (lvr2::Index i = graph.neighboursBegin(current_vh); i < neighbours_end; i++)
       {
-        std::array<lvr2::VertexHandle, 2> vertices = mesh.getVerticesOfEdge(eH);
-        auto vH = vertices[0] == current_vh ? vertices[1] : vertices[0];
+        const lvr2::VertexHandle vH(neighbours[i]);
         if (fixed[vH])
           continue;
         if (invalid[vH])
           continue;
 
-        float tmp_cost = distances[current_vh] + edge_weights[eH];
+        float tmp_cost = distances[current_vh] + edge_weights[i];
         if (tmp_cost < distances[vH])
         {
+          ctx.workspace.touch(vH);
           distances[vH] = tmp_cost;
-          pq.insert(vH, tmp_cost);
+          if (use_heuristic)
+            pq.insert(vH, tmp_cost + goal_position.distance(mesh.getVertexPosition(vH)));
+          else
+            pq.insert(vH, tmp_cost);
           predecessors[vH] = current_vh;
         }
       }
-      catch (lvr2::PanicException exception)
-      {
-        continue;
-      }
-      catch (lvr2::VertexLoopException exception)
-      {
-        continue;
-      }
     }
   }
 
-  if (cancel_planning)
+  if (ctx.canceled)
   {
     ROS_WARN_STREAM("Wave front propagation has been canceled!");
     return mbf_msgs::GetPathResult::CANCELED;
@@ -355,7 +727,7 @@ uint32_t DijkstraMeshPlanner::dijkstra(const mesh_map::Vector& original_start, c
 
   auto vH = goal_vertex;
 
-  while (vH != start_vertex && !cancel_planning)
+  while (vH != start_vertex && !ctx.canceled)
   {
     vH = predecessors[vH];
     path.push_front(vH);
@@ -366,18 +738,32 @@ uint32_t DijkstraMeshPlanner::dijkstra(const mesh_map::Vector& original_start, c
   ROS_INFO_STREAM("Execution time (ms): " << execution_time << " for " << mesh.numVertices()
                                           << " num vertices in the mesh.");
 
-  computeVectorMap();
+  computeVectorMap(predecessors, ctx);
 
-  if (cancel_planning)
+  if (ctx.canceled)
   {
     ROS_WARN_STREAM("Dijkstra has been canceled!");
     return mbf_msgs::GetPathResult::CANCELED;
   }
 
+  if (cacheable && config.potential_cache_size > 0)
+  {
+    auto field = std::make_shared<mesh_map::PotentialField>();
+    field->seed = mesh.getVertexPosition(start_vertex);
+    field->seed_index = start_vertex.idx();
+    field->costs_version = costs.version;
+    field->cost_limit = config.cost_limit;
+    field->storeSettled(ctx.workspace.touchedVertices(), distances, predecessors, fixed);
+    field->vector_field = ctx.vector_field;
+    potential_cache.insert(field);
+  }
+
   ros::WallTime t_path_backtracking = ros::WallTime::now();
   double path_backtracking_duration = (t_path_backtracking - t_propagation_end).toNSec() * 1e-6;
 
   ROS_INFO_STREAM("Processed " << fixed_set_cnt << " vertices in the fixed set.");
+  ROS_INFO_STREAM("Expanded " << ctx.expanded_vertices << " vertices using the " << searchModeName(search_mode)
+                              << " search.");
   ROS_INFO_STREAM("Initialization duration (ms): " << initialization_duration);
   ROS_INFO_STREAM("Execution time wavefront propagation (ms): "<< propagation_duration);
   ROS_INFO_STREAM("Path backtracking duration (ms): " << path_backtracking_duration);
@@ -386,5 +772,625 @@ uint32_t DijkstraMeshPlanner::dijkstra(const mesh_map::Vector& original_start, c
   return mbf_msgs::GetPathResult::SUCCESS;
 }
 
+size_t DijkstraMeshPlanner::incrementalDijkstra(const lvr2::VertexHandle& start_vertex,
+                                                const lvr2::VertexHandle& goal_vertex,
+                                                const std::vector<float>& edge_weights,
+                                                const mesh_map::CostSnapshot& costs,
+                                                lvr2::DenseVertexMap<float>& distances,
+                                                lvr2::DenseVertexMap<lvr2::VertexHandle>& predecessors,
+                                                PlanningContext& ctx)
+{
+  const auto& mesh = mesh_map->mesh();
+  const auto& graph = mesh_map->compactMesh();
+  const auto& neighbours = graph.neighbourVertices();
+  const auto& vertex_costs = costs.vertex_costs;
+  const auto& invalid = mesh_map->invalid;
+  const float inf = std::numeric_limits<float>::infinity();
+
+  // the recorded changes may already cover versions newer than the pinned snapshot, re-examining these vertices with
+  // the snapshot costs is harmless and they are reported again by the next call
+  std::vector<lvr2::VertexHandle> changed_vertices;
+  uint64_t recorded_version;
+  const uint64_t costs_version = costs.version;
+  const bool repair = incremental_valid && incremental_seed == start_vertex &&
+                      incremental_cost_limit == config.cost_limit && incremental_version <= costs_version &&
+                      mesh_map->changedVerticesSince(incremental_version, changed_vertices, recorded_version);
+
+  if (!repair)
+  {
+    ROS_INFO_STREAM("Start the incremental Dijkstra search from scratch.");
+
+    // repaired vertices are queued with keys below already popped ones, which a radix heap can not handle
+    const mesh_map::PriorityQueueType pq_type =
+        priority_queue_type == mesh_map::RADIX_HEAP ? mesh_map::DARY_HEAP : priority_queue_type;
+    incremental_pq = mesh_map::createVertexPriorityQueue(pq_type, mesh.nextVertexIndex());
+    incremental_fixed = lvr2::DenseVertexMap<bool>(mesh.nextVertexIndex(), false);
+    incremental_passable = lvr2::DenseVertexMap<bool>(mesh.nextVertexIndex(), false);
+
+    for (auto const& vH : mesh.vertices())
+    {
+      distances.insert(vH, inf);
+      predecessors.insert(vH, vH);
+      incremental_passable[vH] = vertex_costs[vH] <= config.cost_limit;
+    }
+
+    distances[start_vertex] = 0;
+    incremental_pq->insert(start_vertex, 0);
+  }
+
+  mesh_map::VertexPriorityQueue& pq = *incremental_pq;
+  lvr2::DenseVertexMap<bool>& fixed = incremental_fixed;
+  lvr2::DenseVertexMap<bool>& passable = incremental_passable;
+
+  if (repair)
+  {
+    // only vertices which crossed the cost limit change the graph, since the search runs on the edge distances
+    std::vector<lvr2::VertexHandle> blocked, opened;
+    for (const auto& vH : changed_vertices)
+    {
+      const bool now_passable = vertex_costs[vH] <= config.cost_limit;
+      if (now_passable == passable[vH])
+        continue;
+      passable[vH] = now_passable;
+      (now_passable ? opened : blocked).push_back(vH);
+    }
+
+    // reset all vertices whose shortest path leads over a blocked vertex. The blocked vertices keep their distances,
+    // since they can still be reached, but not passed.
+    std::vector<lvr2::VertexHandle> stack, reset;
+    for (const auto& bH : blocked)
+    {
+      const lvr2::Index neighbours_end = graph.neighboursEnd(bH);
+      for (lvr2::Index i = graph.neighboursBegin(bH); i < neighbours_end; i++)
+      {
+        const lvr2::VertexHandle vH(neighbours[i]);
+        if (vH != bH && predecessors[vH] == bH)
+          stack.push_back(vH);
+      }
+    }
+    while (!stack.empty())
+    {
+      const lvr2::VertexHandle current_vh = stack.back();
+      stack.pop_back();
+      if (distances[current_vh] == inf)
+        continue;
+
+      distances[current_vh] = inf;
+      predecessors[current_vh] = current_vh;
+      fixed[current_vh] = false;
+      reset.push_back(current_vh);
+
+      const lvr2::Index neighbours_end = graph.neighboursEnd(current_vh);
+      for (lvr2::Index i = graph.neighboursBegin(current_vh); i < neighbours_end; i++)
+      {
+        const lvr2::VertexHandle vH(neighbours[i]);
+        if (vH != current_vh && predecessors[vH] == current_vh)
+          stack.push_back(vH);
+      }
+    }
+
+    // re-seed the reset vertices from their expanded neighbours outside of the reset area
+    for (const auto& vH : reset)
+    {
+      float best_dist = inf;
+      lvr2::VertexHandle best_predecessor = vH;
+      const lvr2::Index neighbours_end = graph.neighboursEnd(vH);
+      for (lvr2::Index i = graph.neighboursBegin(vH); i < neighbours_end; i++)
+      {
+        const lvr2::VertexHandle nH(neighbours[i]);
+        if (fixed[nH] && passable[nH] && distances[nH] + edge_weights[i] < best_dist)
+        {
+          best_dist = distances[nH] + edge_weights[i];
+          best_predecessor = nH;
+        }
+      }
+
+      distances[vH] = best_dist;
+      predecessors[vH] = best_predecessor;
+      if (best_dist < inf || pq.containsKey(vH))
+        pq.insert(vH, best_dist);
+    }
+
+    // vertices which have been reached, but not expanded before, have to be expanded now
+    for (const auto& vH : opened)
+    {
+      if (fixed[vH] && distances[vH] < inf)
+      {
+        fixed[vH] = false;
+        pq.insert(vH, distances[vH]);
+      }
+    }
+
+    ROS_INFO_STREAM("Repairing the incremental Dijkstra search: " << blocked.size() << " vertices blocked, "
+                                                                  << opened.size() << " vertices opened, "
+                                                                  << reset.size() << " vertices reset.");
+  }
+
+  incremental_valid = true;
+  incremental_seed = start_vertex;
+  incremental_version = costs_version;
+  incremental_cost_limit = config.cost_limit;
+
+  // the goal may already be settled by a previous call, its distance can only decrease by vertices still in the queue
+  float goal_dist = inf;
+  if (fixed[goal_vertex])
+    goal_dist = distances[goal_vertex] + goal_dist_offset;
+
+  size_t fixed_set_cnt = 0;
+
+  while (!pq.isEmpty() && !ctx.canceled)
+  {
+    lvr2::VertexHandle current_vh = pq.popMin();
+    const float current_dist = distances[current_vh];
+
+    // vertices which lost their path to the start remain in the queue with an infinite key
+    if (current_dist == inf)
+      continue;
+
+    if (current_vh == goal_vertex)
+    {
+      ROS_INFO_STREAM("The Dijkstra Mesh Planner reached the goal.");
+      goal_dist = current_dist + goal_dist_offset;
+    }
+
+    // keep the vertex open for the next call
+    if (current_dist > goal_dist)
+    {
+      pq.insert(current_vh, current_dist);
+      break;
+    }
+
+    fixed[current_vh] = true;
+    fixed_set_cnt++;
+
+    if (!passable[current_vh])
+      continue;
+
+    ctx.expanded_vertices++;
+
+    const lvr2::Index neighbours_end = graph.neighboursEnd(current_vh);
+    for (lvr2::Index i = graph.neighboursBegin(current_vh); i < neighbours_end; i++)
+    {
+      const lvr2::VertexHandle vH(neighbours[i]);
+      if (invalid[vH])
+        continue;
+
+      // repaired vertices may improve already expanded ones, which have to be expanded again
+      float tmp_cost = current_dist + edge_weights[i];
+      if (tmp_cost < distances[vH])
+      {
+        distances[vH] = tmp_cost;
+        pq.insert(vH, tmp_cost);
+        predecessors[vH] = current_vh;
+        fixed[vH] = false;
+      }
+    }
+  }
+
+  return fixed_set_cnt;
+}
+
+size_t DijkstraMeshPlanner::bidirectionalDijkstra(const lvr2::VertexHandle& start_vertex,
+                                                  const lvr2::VertexHandle& goal_vertex,
+                                                  const std::vector<float>& edge_weights,
+                                                  const mesh_map::CostSnapshot& costs,
+                                                  lvr2::DenseVertexMap<float>& distances,
+                                                  lvr2::DenseVertexMap<lvr2::VertexHandle>& predecessors,
+                                                  PlanningContext& ctx)
+{
+  const auto& mesh = mesh_map->mesh();
+  const auto& graph = mesh_map->compactMesh();
+  const auto& neighbours = graph.neighbourVertices();
+  const auto& vertex_costs = costs.vertex_costs;
+  const auto& invalid = mesh_map->invalid;
+  const float inf = std::numeric_limits<float>::infinity();
+
+  // the forward search grows from the start vertex and writes to the given distances and predecessors, the backward
+  // search grows from the goal vertex using its own maps. The forward maps have been reset by the caller.
+  mesh_map::PlannerWorkspace& workspace = ctx.workspace;
+  mesh_map::PlannerWorkspace& backward_workspace = ctx.backward_workspace;
+  lvr2::DenseVertexMap<float>& backward_distances = ctx.backward_distances;
+  lvr2::DenseVertexMap<lvr2::VertexHandle>& backward_predecessors = ctx.backward_predecessors;
+  backward_workspace.reset(mesh, backward_distances, backward_predecessors);
+  mesh_map::StampedVertexFlags& forward_fixed = workspace.fixed();
+  mesh_map::StampedVertexFlags& backward_fixed = backward_workspace.fixed();
+
+  mesh_map::VertexPriorityQueue::Ptr forward_pq =
+      mesh_map::createVertexPriorityQueue(priority_queue_type, mesh.nextVertexIndex());
+  mesh_map::VertexPriorityQueue::Ptr backward_pq =
+      mesh_map::createVertexPriorityQueue(priority_queue_type, mesh.nextVertexIndex());
+
+  workspace.touch(start_vertex);
+  distances[start_vertex] = 0;
+  forward_pq->insert(start_vertex, 0);
+  backward_workspace.touch(goal_vertex);
+  backward_distances[goal_vertex] = 0;
+  backward_pq->insert(goal_vertex, 0);
+
+  // length of the shortest path found so far and the edge connecting both search trees on it
+  float best_dist = inf;
+  lvr2::VertexHandle meeting_forward(start_vertex);
+  lvr2::VertexHandle meeting_backward(goal_vertex);
+
+  // distances of the latest popped vertices, both are lower bounds for the remaining vertices of their queue
+  float forward_radius = 0;
+  float backward_radius = 0;
+
+  size_t fixed_set_cnt = 0;
+  bool forward = true;
+
+  // if one of the queues runs empty, its search tree is complete and the best path found so far is the shortest one
+  while (!forward_pq->isEmpty() && !backward_pq->isEmpty() && !ctx.canceled &&
+         forward_radius + backward_radius < best_dist)
+  {
+    // alternate between both search directions
+    mesh_map::VertexPriorityQueue& pq = forward ? *forward_pq : *backward_pq;
+    lvr2::DenseVertexMap<float>& own_distances = forward ? distances : backward_distances;
+    lvr2::DenseVertexMap<lvr2::VertexHandle>& own_predecessors = forward ? predecessors : backward_predecessors;
+    mesh_map::StampedVertexFlags& own_fixed = forward ? forward_fixed : backward_fixed;
+    mesh_map::PlannerWorkspace& own_workspace = forward ? workspace : backward_workspace;
+    const lvr2::DenseVertexMap<float>& other_distances = forward ? backward_distances : distances;
+
+    lvr2::VertexHandle current_vh = pq.popMin();
+    own_fixed.set(current_vh);
+    fixed_set_cnt++;
+    (forward ? forward_radius : backward_radius) = own_distances[current_vh];
+
+    // the goal vertex is the end of the path, it is expanded regardless of its costs
+    const bool is_end = !forward && current_vh == goal_vertex;
+    if (is_end || vertex_costs[current_vh] <= config.cost_limit)
+    {
+      ctx.expanded_vertices++;
+
+      const lvr2::Index neighbours_end = graph.neighboursEnd(current_vh);
+      for (lvr2::Index i = graph.neighboursBegin(current_vh); i < neighbours_end; i++)
+      {
+        const lvr2::VertexHandle vH(neighbours[i]);
+        if (invalid[vH])
+          continue;
+
+        const float tmp_cost = own_distances[current_vh] + edge_weights[i];
+
+        // the edge connects both search trees, the neighbour lies on the path and has to be passable unless it is
+        // the goal vertex itself
+        if (other_distances[vH] < inf && (vertex_costs[vH] <= config.cost_limit || (forward && vH == goal_vertex)))
+        {
+          const float path_dist = tmp_cost + other_distances[vH];
+          if (path_dist < best_dist)
+          {
+            best_dist = path_dist;
+            meeting_forward = forward ? current_vh : vH;
+            meeting_backward = forward ? vH : current_vh;
+          }
+        }
+
+        if (own_fixed[vH])
+          continue;
+
+        if (tmp_cost < own_distances[vH])
+        {
+          own_workspace.touch(vH);
+          own_distances[vH] = tmp_cost;
+          pq.insert(vH, tmp_cost);
+          own_predecessors[vH] = current_vh;
+        }
+      }
+    }
+    forward = !forward;
+  }
+
+  if (best_dist == inf || ctx.canceled)
+    return fixed_set_cnt;
+
+  // let the predecessors of the backward part of the path point towards the start vertex to get a consistent path
+  // and vector field along the path. Vertices visited by the backward search only stay without a predecessor.
+  lvr2::VertexHandle prev = meeting_forward;
+  lvr2::VertexHandle vH = meeting_backward;
+  while (true)
+  {
+    const lvr2::VertexHandle next = backward_predecessors[vH];
+    workspace.touch(vH);
+    predecessors[vH] = prev;
+    distances[vH] = best_dist - backward_distances[vH];
+    if (vH == goal_vertex)
+      break;
+    prev = vH;
+    vH = next;
+  }
+
+  ROS_INFO_STREAM("The Dijkstra Mesh Planner connected both search trees.");
+  return fixed_set_cnt;
+}
+
+mesh_map::ContractionHierarchy::ConstPtr DijkstraMeshPlanner::contractionHierarchy(const mesh_map::CostSnapshot& costs)
+{
+  const double cost_limit = config.cost_limit;
+  std::lock_guard<std::mutex> lock(hierarchy_mutex);
+  if (hierarchyUpToDate(costs, cost_limit))
+    return hierarchy;
+
+  // the request does not wait for the hierarchy, it falls back to the Dijkstra search until the build is finished. A
+  // build uses the latest costs, it does not help requests on costs older than the hierarchy.
+  if (!hierarchy || hierarchy_cost_limit != cost_limit || hierarchy_version < costs.version)
+    startHierarchyBuild(cost_limit);
+  return mesh_map::ContractionHierarchy::ConstPtr();
+}
+
+bool DijkstraMeshPlanner::hierarchyUpToDate(const mesh_map::CostSnapshot& costs, const double cost_limit)
+{
+  if (!hierarchy || hierarchy_cost_limit != cost_limit)
+    return false;
+  if (hierarchy_version == costs.version)
+    return true;
+
+  // the search runs on the edge distances, such that only vertices which crossed the cost limit change the graph. The
+  // costs may also be older than the hierarchy, e.g. of a request which started before the latest update.
+  const auto& vertex_costs = costs.vertex_costs;
+  const auto& invalid = mesh_map->invalid;
+  std::vector<lvr2::VertexHandle> changed_vertices;
+  uint64_t recorded_version;
+  if (mesh_map->changedVerticesSince(std::min(hierarchy_version, costs.version), changed_vertices, recorded_version) &&
+      recorded_version >= std::max(hierarchy_version, costs.version) &&
+      std::none_of(changed_vertices.begin(), changed_vertices.end(), [&](const lvr2::VertexHandle& vH) {
+        return (!invalid[vH] && vertex_costs[vH] <= cost_limit) != hierarchy->contains(vH);
+      }))
+  {
+    hierarchy_version = std::max(hierarchy_version, costs.version);
+    return true;
+  }
+  return false;
+}
+
+void DijkstraMeshPlanner::startHierarchyBuild(const double cost_limit)
+{
+  // a running build is not interrupted, the next request checks the hierarchy it delivers again
+  if (hierarchy_build.valid() && hierarchy_build.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    return;
+  hierarchy_build = std::async(std::launch::async, &DijkstraMeshPlanner::buildHierarchy, this, cost_limit);
+}
+
+void DijkstraMeshPlanner::buildHierarchy(const double cost_limit)
+{
+  const mesh_map::CostSnapshot::ConstPtr costs = mesh_map->costSnapshot();
+  if (!costs)
+    return;
+
+  const auto& mesh = mesh_map->mesh();
+  const auto& vertex_costs = costs->vertex_costs;
+  const auto& invalid = mesh_map->invalid;
+  std::vector<uint8_t> passable(mesh.nextVertexIndex(), 0);
+  for (auto vH : mesh.vertices())
+  {
+    passable[vH.idx()] = !invalid[vH] && vertex_costs[vH] <= cost_limit;
+  }
+
+  mesh_map::ContractionHierarchy::ConstPtr new_hierarchy;
+  {
+    std::lock_guard<std::mutex> lock(hierarchy_mutex);
+    new_hierarchy = hierarchy;
+  }
+
+  // the changes may not be recorded anymore, e.g. if a layer changed all of its costs
+  if (!new_hierarchy || new_hierarchy->passableVertices() != passable)
+  {
+    ros::WallTime t_start = ros::WallTime::now();
+    auto built_hierarchy = std::make_shared<mesh_map::ContractionHierarchy>();
+    if (!hierarchy_file.empty() && built_hierarchy->read(hierarchy_file, mesh_map->meshHash()) &&
+        built_hierarchy->passableVertices() == passable)
+    {
+      ROS_INFO_STREAM("Loaded the contraction hierarchy from '" << hierarchy_file << "'.");
+    }
+    else
+    {
+      ROS_INFO_STREAM("Building the contraction hierarchy of the passable vertices...");
+      built_hierarchy->build(mesh_map->compactMesh(), mesh_map->compactMesh().neighbourDistances(), passable);
+      ROS_INFO_STREAM("Built the contraction hierarchy with " << built_hierarchy->numShortcuts() << " shortcuts in "
+                                                              << (ros::WallTime::now() - t_start).toNSec() * 1e-6
+                                                              << " ms.");
+      if (!hierarchy_file.empty())
+      {
+        if (built_hierarchy->write(hierarchy_file, mesh_map->meshHash()))
+          ROS_INFO_STREAM("Saved the contraction hierarchy to '" << hierarchy_file << "'.");
+        else
+          ROS_WARN_STREAM("Could not write the contraction hierarchy file '" << hierarchy_file << "'!");
+      }
+    }
+    new_hierarchy = built_hierarchy;
+  }
+
+  std::lock_guard<std::mutex> lock(hierarchy_mutex);
+  hierarchy = new_hierarchy;
+  hierarchy_version = costs->version;
+  hierarchy_cost_limit = cost_limit;
+}
+
+size_t DijkstraMeshPlanner::hierarchyDijkstra(const mesh_map::ContractionHierarchy& hierarchy,
+                                              const lvr2::VertexHandle& start_vertex,
+                                              const lvr2::VertexHandle& goal_vertex,
+                                              const std::vector<float>& edge_weights,
+                                              lvr2::DenseVertexMap<float>& distances,
+                                              lvr2::DenseVertexMap<lvr2::VertexHandle>& predecessors,
+                                              PlanningContext& ctx)
+{
+  const auto& mesh = mesh_map->mesh();
+  const auto& graph = mesh_map->compactMesh();
+  const auto& neighbours = graph.neighbourVertices();
+  const auto& upward_targets = hierarchy.upwardTargets();
+  const auto& upward_weights = hierarchy.upwardWeights();
+  const auto& invalid = mesh_map->invalid;
+  const float inf = std::numeric_limits<float>::infinity();
+
+  // the forward search writes to the given distances and predecessors, which have been reset by the caller, the
+  // backward search uses its own maps
+  mesh_map::PlannerWorkspace& workspace = ctx.workspace;
+  mesh_map::PlannerWorkspace& backward_workspace = ctx.backward_workspace;
+  lvr2::DenseVertexMap<float>& backward_distances = ctx.backward_distances;
+  lvr2::DenseVertexMap<lvr2::VertexHandle>& backward_predecessors = ctx.backward_predecessors;
+  backward_workspace.reset(mesh, backward_distances, backward_predecessors);
+  mesh_map::StampedVertexFlags& forward_fixed = workspace.fixed();
+  mesh_map::StampedVertexFlags& backward_fixed = backward_workspace.fixed();
+
+  // an impassable start vertex is not expanded by the other search modes either
+  if (!hierarchy.contains(start_vertex) || invalid[goal_vertex])
+    return 0;
+
+  if (!ctx.forward_queue)
+    ctx.forward_queue = mesh_map::createVertexPriorityQueue(priority_queue_type, mesh.nextVertexIndex());
+  if (!ctx.backward_queue)
+    ctx.backward_queue = mesh_map::createVertexPriorityQueue(priority_queue_type, mesh.nextVertexIndex());
+  mesh_map::VertexPriorityQueue& forward_pq = *ctx.forward_queue;
+  mesh_map::VertexPriorityQueue& backward_pq = *ctx.backward_queue;
+  forward_pq.clear();
+  backward_pq.clear();
+
+  workspace.touch(start_vertex);
+  distances[start_vertex] = 0;
+  forward_pq.insert(start_vertex, 0);
+
+  if (hierarchy.contains(goal_vertex))
+  {
+    backward_workspace.touch(goal_vertex);
+    backward_distances[goal_vertex] = 0;
+    backward_pq.insert(goal_vertex, 0);
+  }
+  else
+  {
+    // the impassable goal vertex is the end of the path, it is only entered from its passable neighbours
+    const lvr2::Index neighbours_end = graph.neighboursEnd(goal_vertex);
+    for (lvr2::Index i = graph.neighboursBegin(goal_vertex); i < neighbours_end; i++)
+    {
+      const lvr2::VertexHandle vH(neighbours[i]);
+      if (hierarchy.contains(vH) && edge_weights[i] < backward_distances[vH])
+      {
+        backward_workspace.touch(vH);
+        backward_distances[vH] = edge_weights[i];
+        backward_pq.insert(vH, edge_weights[i]);
+      }
+    }
+  }
+
+  // length of the shortest path found so far and the vertex at which both searches met on it
+  float best_dist = inf;
+  lvr2::VertexHandle meeting_vertex(start_vertex);
+
+  size_t fixed_set_cnt = 0;
+  bool forward = true;
+  bool forward_done = false;
+  bool backward_done = false;
+
+  while (!(forward_done && backward_done) && !ctx.canceled)
+  {
+    // alternate between both search directions
+    bool& done = forward ? forward_done : backward_done;
+    mesh_map::VertexPriorityQueue& pq = forward ? forward_pq : backward_pq;
+    lvr2::DenseVertexMap<float>& own_distances = forward ? distances : backward_distances;
+    lvr2::DenseVertexMap<lvr2::VertexHandle>& own_predecessors = forward ? predecessors : backward_predecessors;
+    mesh_map::StampedVertexFlags& own_fixed = forward ? forward_fixed : backward_fixed;
+    mesh_map::PlannerWorkspace& own_workspace = forward ? workspace : backward_workspace;
+    const lvr2::DenseVertexMap<float>& other_distances = forward ? backward_distances : distances;
+    forward = !forward;
+
+    if (done || pq.isEmpty())
+    {
+      done = true;
+      continue;
+    }
+
+    const lvr2::VertexHandle current_vh = pq.popMin();
+    own_fixed.set(current_vh);
+    fixed_set_cnt++;
+
+    // the upward searches do not meet in the middle, but at the highest ranked vertex of the path. Each search
+    // continues until its smallest distance reaches the length of the shortest path found so far.
+    const float current_dist = own_distances[current_vh];
+    if (current_dist >= best_dist)
+    {
+      done = true;
+      continue;
+    }
+
+    if (other_distances[current_vh] < inf && current_dist + other_distances[current_vh] < best_dist)
+    {
+      best_dist = current_dist + other_distances[current_vh];
+      meeting_vertex = current_vh;
+    }
+
+    // stall on demand: a higher ranked neighbour reached on a shorter path proves that the vertex is not on a
+    // shortest upward path, its edges do not have to be relaxed
+    const lvr2::Index upward_end = hierarchy.upwardEnd(current_vh);
+    bool stalled = false;
+    for (lvr2::Index i = hierarchy.upwardBegin(current_vh); i < upward_end && !stalled; i++)
+    {
+      stalled = own_distances[lvr2::VertexHandle(upward_targets[i])] + upward_weights[i] < current_dist;
+    }
+    if (stalled)
+      continue;
+
+    ctx.expanded_vertices++;
+
+    for (lvr2::Index i = hierarchy.upwardBegin(current_vh); i < upward_end; i++)
+    {
+      const lvr2::VertexHandle vH(upward_targets[i]);
+      if (own_fixed[vH])
+        continue;
+
+      const float tmp_cost = current_dist + upward_weights[i];
+      if (tmp_cost < own_distances[vH])
+      {
+        own_workspace.touch(vH);
+        own_distances[vH] = tmp_cost;
+        pq.insert(vH, tmp_cost);
+        own_predecessors[vH] = current_vh;
+      }
+    }
+  }
+
+  // collect the path of the hierarchy from the start vertex over the meeting vertex to the end of the backward search
+  std::vector<lvr2::VertexHandle> hierarchy_path;
+  if (best_dist < inf && !ctx.canceled)
+  {
+    for (lvr2::VertexHandle vH = meeting_vertex; vH != start_vertex; vH = predecessors[vH])
+    {
+      hierarchy_path.push_back(vH);
+    }
+    hierarchy_path.push_back(start_vertex);
+    std::reverse(hierarchy_path.begin(), hierarchy_path.end());
+    for (lvr2::VertexHandle vH = meeting_vertex; backward_predecessors[vH] != vH; vH = backward_predecessors[vH])
+    {
+      hierarchy_path.push_back(backward_predecessors[vH]);
+    }
+  }
+
+  // only the unpacked path is kept, the vertices of the upward searches are connected by shortcuts
+  workspace.reset(mesh, distances, predecessors);
+
+  std::vector<lvr2::VertexHandle> path;
+  std::vector<float> lengths;
+  if (hierarchy_path.empty() || !hierarchy.unpackPath(hierarchy_path, path, lengths))
+  {
+    if (!hierarchy_path.empty())
+      ROS_ERROR_STREAM("Could not unpack the path of the contraction hierarchy!");
+    return fixed_set_cnt;
+  }
+
+  workspace.touch(start_vertex);
+  distances[start_vertex] = 0;
+  for (size_t k = 1; k < path.size(); k++)
+  {
+    workspace.touch(path[k]);
+    predecessors[path[k]] = path[k - 1];
+    distances[path[k]] = lengths[k];
+  }
+  if (path.back() != goal_vertex)
+  {
+    workspace.touch(goal_vertex);
+    predecessors[goal_vertex] = path.back();
+    distances[goal_vertex] = best_dist;
+  }
+
+  ROS_INFO_STREAM("The Dijkstra Mesh Planner connected both upward searches of the contraction hierarchy.");
+  return fixed_set_cnt;
+}
+
 } /* namespace dijkstra_mesh_planner */
 
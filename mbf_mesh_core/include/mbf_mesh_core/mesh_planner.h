@@ -72,6 +72,44 @@ public:
                             double tolerance, std::vector<geometry_msgs::PoseStamped>& plan, double& cost,
                             std::string& message) = 0;
 
+  /**
+   * @brief Computes plans from many start poses to the same goal pose. Planners may override it to share one goal
+   * rooted propagation between all start poses. The plans are what-if queries, overriding planners should neither
+   * publish them nor replace the vector field of the map, which is followed by the controller. The default
+   * implementation calls makePlan() for each start pose, so it does both, like a regular plan request.
+   * @param goal The goal pose shared by all plans
+   * @param starts The start poses
+   * @param tolerance If the goal is obstructed, how many meters the planner can
+   * relax the constraint in x and y before failing
+   * @param outcomes The result code of each plan as described on GetPath action result, one per start pose
+   * @param plans The plans... filled by the planner, one per start pose
+   * @param costs The costs of the plans, one per start pose
+   * @param message Optional more detailed outcome as a string
+   */
+  virtual void makePlans(const geometry_msgs::PoseStamped& goal, const std::vector<geometry_msgs::PoseStamped>& starts,
+                         double tolerance, std::vector<uint32_t>& outcomes,
+                         std::vector<std::vector<geometry_msgs::PoseStamped>>& plans, std::vector<double>& costs,
+                         std::string& message)
+  {
+    outcomes.assign(starts.size(), 0);
+    plans.assign(starts.size(), std::vector<geometry_msgs::PoseStamped>());
+    costs.assign(starts.size(), 0);
+    for (size_t i = 0; i < starts.size(); i++)
+    {
+      outcomes[i] = makePlan(starts[i], goal, tolerance, plans[i], costs[i], message);
+    }
+  }
+
+  /**
+   * @brief Defines whether makePlans() may be called concurrently for different goals, e.g. by the batch planning of
+   * the navigation server. Planners which plan each request in its own state may override it.
+   * @return true, if concurrent calls are supported; default is false.
+   */
+  virtual bool supportsConcurrentPlans()
+  {
+    return false;
+  }
+
   /**
    * @brief Requests the planner to cancel, e.g. if it takes too much time.
    * @return True if a cancel has been successfully requested, false if not
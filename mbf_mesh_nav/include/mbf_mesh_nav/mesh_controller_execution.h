@@ -103,9 +103,6 @@ private:
   //! mesh for 3d navigation planning
   const MeshPtr& mesh_ptr_;
 
-  //! Whether to lock mesh before calling the controller
-  bool lock_mesh_;
-
   //! name of the controller plugin assigned by the class loader
   std::string controller_name_;
 };
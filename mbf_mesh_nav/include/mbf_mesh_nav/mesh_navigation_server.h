@@ -44,7 +44,10 @@
 #include "mesh_planner_execution.h"
 #include "mesh_recovery_execution.h"
 
+#include <mbf_mesh_nav/DistanceMatrix.h>
 #include <mbf_mesh_nav/MoveBaseFlexConfig.h>
+#include <mbf_mesh_nav/PlanBatch.h>
+#include <mesh_map/distance_matrix.h>
 #include <mbf_msgs/CheckPath.h>
 #include <mbf_msgs/CheckPose.h>
 #include <std_srvs/Empty.h>
@@ -180,6 +183,47 @@ private:
    */
   bool callServiceCheckPathCost(mbf_msgs::CheckPath::Request& request, mbf_msgs::CheckPath::Response& response);
 
+  /**
+   * @brief Evaluates the cost of many poses at once. The poses are projected onto the mesh in one batch and the
+   * combined vertex costs are interpolated at the projected positions in parallel.
+   * @param poses The poses to evaluate
+   * @param states The resulting state of each pose, see the mbf_msgs/CheckPose response constants
+   * @param costs The interpolated cost of each pose, zero if the pose is not free
+   */
+  void checkPoseCosts(const std::vector<geometry_msgs::PoseStamped>& poses, std::vector<uint8_t>& states,
+                      std::vector<float>& costs);
+
+  /**
+   * @brief Callback method for the plan_batch service. The pairs are grouped by their goal position, each group is
+   * planned with one call of the planner's batch interface and distinct goals are planned in parallel.
+   * @param request Request object, see the mbf_mesh_nav/PlanBatch service
+   * definition file.
+   * @param response Response object, see the mbf_mesh_nav/PlanBatch service
+   * definition file.
+   * @return true, if the service completed successfully, false otherwise
+   */
+  bool callServicePlanBatch(mbf_mesh_nav::PlanBatch::Request& request, mbf_mesh_nav::PlanBatch::Response& response);
+
+  /**
+   * @brief Callback method for the distance_matrix service. Computes the geodesic distances from all sources to all
+   * targets with one propagation per source, see mesh_map::DistanceMatrix.
+   * @param request Request object, see the mbf_mesh_nav/DistanceMatrix service
+   * definition file.
+   * @param response Response object, see the mbf_mesh_nav/DistanceMatrix service
+   * definition file.
+   * @return true, if the service completed successfully, false otherwise
+   */
+  bool callServiceDistanceMatrix(mbf_mesh_nav::DistanceMatrix::Request& request,
+                                 mbf_mesh_nav::DistanceMatrix::Response& response);
+
+  /**
+   * @brief Transforms a pose into the map frame, poses given in the map frame are copied
+   * @param pose The pose to transform
+   * @param map_pose The transformed pose
+   * @return true, if the pose could be transformed
+   */
+  bool transformToMap(const geometry_msgs::PoseStamped& pose, geometry_msgs::PoseStamped& map_pose);
+
   /**
    * @brief Callback method for the make_plan service
    * @param request Empty request object.
@@ -229,6 +273,18 @@ private:
   //! Service Server for the check_path_cost service
   ros::ServiceServer check_path_cost_srv_;
 
+  //! Service Server for the plan_batch service
+  ros::ServiceServer plan_batch_srv_;
+
+  //! Service Server for the distance_matrix service
+  ros::ServiceServer distance_matrix_srv_;
+
+  //! distance matrix engine of the distance_matrix service, reuses its workspaces between the calls
+  std::unique_ptr<mesh_map::DistanceMatrix> distance_matrix_;
+
+  //! maximum distance of a checked pose to the mesh surface, poses further away are outside of the mesh
+  double check_cost_search_distance_;
+
   //! Start/stop meshs mutex; concurrent calls to start can lead to segfault
   boost::mutex check_meshs_mutex_;
 };
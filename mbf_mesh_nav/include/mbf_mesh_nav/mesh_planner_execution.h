@@ -100,9 +100,6 @@ private:
   //! Shared pointer to the mesh for 3d navigation planning
   const MeshPtr& mesh_ptr_;
 
-  //! Whether to lock mesh before calling the planner (see issue #4 for details)
-  bool lock_mesh_;
-
   //! Name of the planner assigned by the class loader
   std::string planner_name_;
 };
@@ -0,0 +1,171 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+/*
+ * Benchmark and behaviour check of the distance_matrix service of a running mesh navigation server. It computes the
+ * distances between all given points with one distance_matrix call and plans all pairs with one plan_batch call, then
+ * compares the runtimes of both and checks the matrix distances against the lengths of the planned paths. The exit
+ * code is non-zero if a pair is only reachable for one of them or if its distances deviate more than the tolerance.
+ *
+ * usage: distance_matrix_benchmark points_file [planner] [tolerance] [cost_limit] [server]
+ *
+ * The points file contains one position "x y z" in the "map" frame per line, each point is used as source and target.
+ * The planner is the planner plugin of the plan_batch call, the first loaded planner by default. The tolerance is the
+ * maximum relative deviation of the distances, 0.1 by default. The server is the namespace of the services,
+ * "move_base_flex" by default.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <mbf_mesh_nav/DistanceMatrix.h>
+#include <mbf_mesh_nav/PlanBatch.h>
+#include <mbf_msgs/GetPathResult.h>
+#include <ros/ros.h>
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "distance_matrix_benchmark");
+  if (argc < 2)
+  {
+    std::cerr << "usage: distance_matrix_benchmark points_file [planner] [tolerance] [cost_limit] [server]"
+              << std::endl;
+    return 2;
+  }
+  const std::string planner = argc > 2 ? argv[2] : "";
+  const float tolerance = argc > 3 ? std::atof(argv[3]) : 0.1;
+  const float cost_limit = argc > 4 ? std::atof(argv[4]) : 1.0;
+  const std::string server = argc > 5 ? argv[5] : "move_base_flex";
+
+  std::vector<geometry_msgs::PoseStamped> points;
+  std::ifstream points_file(argv[1]);
+  geometry_msgs::PoseStamped pose;
+  pose.header.frame_id = "map";
+  pose.pose.orientation.w = 1;
+  while (points_file >> pose.pose.position.x >> pose.pose.position.y >> pose.pose.position.z)
+  {
+    points.push_back(pose);
+  }
+  if (points.empty())
+  {
+    std::cerr << "Could not read any point from '" << argv[1] << "'!" << std::endl;
+    return 2;
+  }
+
+  ros::NodeHandle nh;
+  ros::ServiceClient matrix_client = nh.serviceClient<mbf_mesh_nav::DistanceMatrix>(server + "/distance_matrix");
+  ros::ServiceClient batch_client = nh.serviceClient<mbf_mesh_nav::PlanBatch>(server + "/plan_batch");
+  if (!matrix_client.waitForExistence(ros::Duration(10)) || !batch_client.waitForExistence(ros::Duration(10)))
+  {
+    std::cerr << "The services of the server '" << server << "' are not available!" << std::endl;
+    return 2;
+  }
+
+  const size_t n = points.size();
+  mbf_mesh_nav::DistanceMatrix matrix;
+  matrix.request.sources = points;
+  matrix.request.targets = points;
+  matrix.request.max_dist = 0.4;
+  matrix.request.cost_limit = cost_limit;
+
+  // the paths are planned from each target to each source, which are seeded at the source like the matrix rows
+  mbf_mesh_nav::PlanBatch batch;
+  batch.request.planner = planner;
+  for (size_t s = 0; s < n; s++)
+  {
+    for (size_t t = 0; t < n; t++)
+    {
+      batch.request.starts.push_back(points[t]);
+      batch.request.goals.push_back(points[s]);
+    }
+  }
+
+  ros::WallTime t_start = ros::WallTime::now();
+  if (!matrix_client.call(matrix))
+  {
+    std::cerr << "The distance_matrix call failed!" << std::endl;
+    return 2;
+  }
+  const double matrix_duration = (ros::WallTime::now() - t_start).toNSec() * 1e-6;
+
+  t_start = ros::WallTime::now();
+  if (!batch_client.call(batch))
+  {
+    std::cerr << "The plan_batch call failed!" << std::endl;
+    return 2;
+  }
+  const double batch_duration = (ros::WallTime::now() - t_start).toNSec() * 1e-6;
+
+  size_t num_compared = 0, num_reachability_errors = 0, num_deviations = 0;
+  float max_deviation = 0;
+  for (size_t i = 0; i < n * n; i++)
+  {
+    // pairs of the same point have a zero distance, which is not comparable relatively
+    if (i / n == i % n)
+      continue;
+
+    const bool matrix_reached = std::isfinite(matrix.response.distances[i]);
+    const bool batch_reached = batch.response.outcomes[i] == mbf_msgs::GetPathResult::SUCCESS;
+    if (matrix_reached != batch_reached)
+    {
+      num_reachability_errors++;
+      continue;
+    }
+    if (!matrix_reached)
+      continue;
+
+    const float deviation = std::fabs(matrix.response.distances[i] - batch.response.costs[i]) /
+                            std::max(static_cast<float>(batch.response.costs[i]), 1e-3f);
+    max_deviation = std::max(max_deviation, deviation);
+    if (deviation > tolerance)
+      num_deviations++;
+    num_compared++;
+  }
+
+  std::cout << "distance_matrix: " << matrix_duration << " ms, " << matrix.response.message << std::endl;
+  std::cout << "plan_batch: " << batch_duration << " ms, " << batch.response.message << std::endl;
+  std::cout << "compared " << num_compared << " pairs, max relative deviation: " << max_deviation << ", "
+            << num_deviations << " pairs above the tolerance of " << tolerance << ", " << num_reachability_errors
+            << " pairs with a different reachability" << std::endl;
+
+  return num_deviations == 0 && num_reachability_errors == 0 ? 0 : 1;
+}
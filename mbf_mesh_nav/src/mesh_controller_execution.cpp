@@ -46,8 +46,6 @@ MeshControllerExecution::MeshControllerExecution(const std::string name,
   : AbstractControllerExecution(name, controller_ptr, vel_pub, goal_pub, tf_listener_ptr, toAbstract(config))
   , mesh_ptr_(mesh_ptr)
 {
-  ros::NodeHandle private_nh("~");
-  private_nh.param("controller_lock_mesh", lock_mesh_, true);
 }
 
 MeshControllerExecution::~MeshControllerExecution()
@@ -71,15 +69,8 @@ uint32_t MeshControllerExecution::computeVelocityCmd(const geometry_msgs::PoseSt
                                                      const geometry_msgs::TwistStamped& robot_velocity,
                                                      geometry_msgs::TwistStamped& vel_cmd, std::string& message)
 {
-  // Lock the mesh while planning, but following issue #4, we allow to move the
-  // responsibility to the planner itself
-  if (lock_mesh_)
-  {
-    // TODO
-    // boost::lock_guard<mesh::Mesh::mutex_t> lock(*(mesh_ptr_->getMutex()));
-    // return controller_->computeVelocityCommands(robot_pose, robot_velocity,
-    // vel_cmd, message);
-  }
+  // The mesh is not locked, the controller pins the current cost and vector field snapshots of the mesh map, which
+  // are never modified while layers update
   return controller_->computeVelocityCommands(robot_pose, robot_velocity, vel_cmd, message);
 }
 
@@ -35,15 +35,56 @@
  *
  */
 
+#include <limits>
+#include <map>
+#include <omp.h>
+#include <tuple>
+
 #include <geometry_msgs/PoseArray.h>
 #include <mbf_abstract_nav/MoveBaseFlexConfig.h>
+#include <mbf_msgs/GetPathResult.h>
+#include <mbf_utility/navigation_utility.h>
 #include <mesh_map/mesh_map.h>
+#include <mesh_map/util.h>
+#include <mesh_map/vertex_priority_queue.h>
 #include <nav_msgs/Path.h>
 
 #include "mbf_mesh_nav/mesh_navigation_server.h"
 
 namespace mbf_mesh_nav
 {
+//! service cost of a lethal pose, as in the costmap conventions
+static const double LETHAL_COST = 254;
+
+//! service cost of an unknown pose or a pose outside of the mesh, as in the costmap conventions
+static const double UNKNOWN_COST = 255;
+
+//! scale from the combined vertex costs to the integral service costs
+static const double COST_SCALE = 100;
+
+/**
+ * @brief Converts the evaluated cost of a pose to the integral cost reported by the check services
+ * @param state The state of the pose
+ * @param cost The interpolated cost of the pose
+ * @param lethal_cost_mult The multiplier for lethal poses, ignored if zero
+ * @param unknown_cost_mult The multiplier for unknown poses and poses outside of the mesh, ignored if zero
+ * @return the service cost of the pose
+ */
+static double serviceCost(const uint8_t state, const float cost, const double lethal_cost_mult,
+                          const double unknown_cost_mult)
+{
+  switch (state)
+  {
+    case mbf_msgs::CheckPose::Response::LETHAL:
+      return LETHAL_COST * (lethal_cost_mult > 0 ? lethal_cost_mult : 1.0);
+    case mbf_msgs::CheckPose::Response::UNKNOWN:
+    case mbf_msgs::CheckPose::Response::OUTSIDE:
+      return UNKNOWN_COST * (unknown_cost_mult > 0 ? unknown_cost_mult : 1.0);
+    default:
+      return cost * COST_SCALE;
+  }
+}
+
 MeshNavigationServer::MeshNavigationServer(const TFPtr& tf_listener_ptr)
   : AbstractNavigationServer(tf_listener_ptr)
   , recovery_plugin_loader_("mbf_mesh_core", "mbf_mesh_core::MeshRecovery")
@@ -52,12 +93,18 @@ MeshNavigationServer::MeshNavigationServer(const TFPtr& tf_listener_ptr)
   , mesh_ptr_(new mesh_map::MeshMap(*tf_listener_ptr_))
   , setup_reconfigure_(false)
 {
+  private_nh_.param("check_cost_search_distance", check_cost_search_distance_, 0.4);
+
   // advertise services and current goal topic
   check_pose_cost_srv_ =
       private_nh_.advertiseService("check_pose_cost", &MeshNavigationServer::callServiceCheckPoseCost, this);
   check_path_cost_srv_ =
       private_nh_.advertiseService("check_path_cost", &MeshNavigationServer::callServiceCheckPathCost, this);
   clear_mesh_srv_ = private_nh_.advertiseService("clear_mesh", &MeshNavigationServer::callServiceClearMesh, this);
+  plan_batch_srv_ = private_nh_.advertiseService("plan_batch", &MeshNavigationServer::callServicePlanBatch, this);
+  distance_matrix_.reset(new mesh_map::DistanceMatrix(*mesh_ptr_, mesh_map::readPriorityQueueType(private_nh_)));
+  distance_matrix_srv_ =
+      private_nh_.advertiseService("distance_matrix", &MeshNavigationServer::callServiceDistanceMatrix, this);
 
   // dynamic reconfigure server for mbf_mesh_nav configuration; also include
   // abstract server parameters
@@ -264,18 +311,309 @@ void MeshNavigationServer::reconfigure(mbf_mesh_nav::MoveBaseFlexConfig& config,
   last_config_ = config;
 }
 
+void MeshNavigationServer::checkPoseCosts(const std::vector<geometry_msgs::PoseStamped>& poses,
+                                          std::vector<uint8_t>& states, std::vector<float>& costs)
+{
+  const size_t num_poses = poses.size();
+  states.assign(num_poses, mbf_msgs::CheckPose::Response::FREE);
+  costs.assign(num_poses, 0);
+
+  // transform the poses into the map frame; paths are usually given in the map frame already
+  const std::string& map_frame = mesh_ptr_->mapFrame();
+  std::vector<mesh_map::Vector> positions(num_poses);
+  for (size_t i = 0; i < num_poses; i++)
+  {
+    geometry_msgs::PoseStamped pose;
+    if (poses[i].header.frame_id == map_frame)
+    {
+      positions[i] = mesh_map::toVector(poses[i].pose.position);
+    }
+    else if (mbf_utility::transformPose(*tf_listener_ptr_, map_frame, tf_timeout_, poses[i], pose))
+    {
+      positions[i] = mesh_map::toVector(pose.pose.position);
+    }
+    else
+    {
+      ROS_WARN_STREAM_THROTTLE(1, "Could not transform the pose from \"" << poses[i].header.frame_id
+                                                                      << "\" into the map frame \"" << map_frame
+                                                                      << "\"!");
+      states[i] = mbf_msgs::CheckPose::Response::UNKNOWN;
+    }
+  }
+
+  // project all poses onto the mesh in one batch
+  std::vector<lvr2::OptionalFaceHandle> faces;
+  std::vector<std::array<float, 3>> barycentric_coords;
+  std::vector<float> distances;
+  mesh_ptr_->searchContainingFaces(positions, check_cost_search_distance_, faces, barycentric_coords, distances);
+
+  // pin the current costs for all poses, concurrent layer updates publish a new snapshot
+  const mesh_map::CostSnapshot::ConstPtr cost_snapshot = mesh_ptr_->costSnapshot();
+  const auto& mesh = mesh_ptr_->mesh();
+  const auto& invalid = mesh_ptr_->invalid;
+
+#pragma omp parallel for schedule(static)
+  for (size_t i = 0; i < num_poses; i++)
+  {
+    if (states[i] != mbf_msgs::CheckPose::Response::FREE)
+      continue;
+
+    if (!cost_snapshot)
+    {
+      states[i] = mbf_msgs::CheckPose::Response::UNKNOWN;
+      continue;
+    }
+    const auto& vertex_costs = cost_snapshot->vertex_costs;
+
+    if (!faces[i])
+    {
+      states[i] = mbf_msgs::CheckPose::Response::OUTSIDE;
+      continue;
+    }
+
+    const std::array<lvr2::VertexHandle, 3> vertices = mesh.getVerticesOfFace(faces[i].unwrap());
+    bool unknown = false;
+    bool lethal = false;
+    for (const auto& vH : vertices)
+    {
+      unknown |= invalid[vH];
+      // lethal vertices have infinite costs, a face touching one is crossing a lethal area
+      lethal |= !std::isfinite(vertex_costs[vH]);
+    }
+
+    if (unknown)
+    {
+      states[i] = mbf_msgs::CheckPose::Response::UNKNOWN;
+    }
+    else if (lethal)
+    {
+      states[i] = mbf_msgs::CheckPose::Response::LETHAL;
+    }
+    else
+    {
+      const float cost = mesh_ptr_->costAtPosition(vertex_costs, vertices, barycentric_coords[i]);
+      if (std::isfinite(cost))
+        costs[i] = cost;
+      else
+        states[i] = mbf_msgs::CheckPose::Response::UNKNOWN;
+    }
+  }
+}
+
 bool MeshNavigationServer::callServiceCheckPoseCost(mbf_msgs::CheckPose::Request& request,
                                                     mbf_msgs::CheckPose::Response& response)
 {
-  // TODO implement
-  return false;
+  geometry_msgs::PoseStamped pose = request.pose;
+  if (request.current_pose && !robot_info_.getRobotPose(pose))
+  {
+    ROS_ERROR_STREAM("Get robot pose failed, could not check the pose cost!");
+    return false;
+  }
+
+  std::vector<uint8_t> states;
+  std::vector<float> costs;
+  checkPoseCosts({ pose }, states, costs);
+
+  response.state = states[0];
+  response.cost = serviceCost(states[0], costs[0], request.lethal_cost_mult, request.unknown_cost_mult);
+  return true;
 }
 
 bool MeshNavigationServer::callServiceCheckPathCost(mbf_msgs::CheckPath::Request& request,
                                                     mbf_msgs::CheckPath::Response& response)
 {
-  // TODO implement
-  return false;
+  // check every (skip_poses + 1)th pose of the path, all of them in one batch
+  const size_t step = request.skip_poses + 1;
+  const std::vector<geometry_msgs::PoseStamped>& path = request.path.poses;
+  std::vector<geometry_msgs::PoseStamped> poses;
+  poses.reserve(path.size() / step + 1);
+  for (size_t i = 0; i < path.size(); i += step)
+  {
+    poses.push_back(path[i]);
+  }
+
+  std::vector<uint8_t> states;
+  std::vector<float> costs;
+  checkPoseCosts(poses, states, costs);
+
+  // aggregate the costs along the path and stop at the first pose reaching the requested return state
+  double cost = 0;
+  response.state = mbf_msgs::CheckPath::Response::FREE;
+  response.last_checked = 0;
+  for (size_t i = 0; i < poses.size(); i++)
+  {
+    response.last_checked = i * step;
+    response.state = std::max(response.state, states[i]);
+    cost += serviceCost(states[i], costs[i], request.lethal_cost_mult, request.unknown_cost_mult);
+    if (request.return_on > 0 && states[i] >= request.return_on)
+      break;
+  }
+  response.cost = cost;
+  return true;
+}
+
+bool MeshNavigationServer::callServicePlanBatch(mbf_mesh_nav::PlanBatch::Request& request,
+                                                mbf_mesh_nav::PlanBatch::Response& response)
+{
+  const size_t num_pairs = request.starts.size();
+  if (request.goals.size() != num_pairs)
+  {
+    ROS_ERROR_STREAM("The batch contains " << num_pairs << " start poses, but " << request.goals.size()
+                                           << " goal poses!");
+    return false;
+  }
+
+  const std::vector<std::string>& planner_names = planner_plugin_manager_.getLoadedNames();
+  const std::string planner_name =
+      request.planner.empty() && !planner_names.empty() ? planner_names.front() : request.planner;
+  if (!planner_plugin_manager_.hasPlugin(planner_name))
+  {
+    ROS_ERROR_STREAM("No planner plugin \"" << planner_name << "\" has been loaded, could not plan the batch!");
+    return false;
+  }
+  mbf_mesh_core::MeshPlanner::Ptr planner_ptr =
+      boost::static_pointer_cast<mbf_mesh_core::MeshPlanner>(planner_plugin_manager_.getPlugin(planner_name));
+
+  response.outcomes.assign(num_pairs, mbf_msgs::GetPathResult::TF_ERROR);
+  response.costs.assign(num_pairs, 0);
+  response.paths.assign(request.return_paths ? num_pairs : 0, nav_msgs::Path());
+
+  const std::string& map_frame = mesh_ptr_->mapFrame();
+
+  // group the pairs by their goal position, each group is planned with one propagation rooted at its goal
+  std::vector<geometry_msgs::PoseStamped> starts(num_pairs);
+  std::vector<geometry_msgs::PoseStamped> goals(num_pairs);
+  std::map<std::tuple<double, double, double>, size_t> group_indices;
+  std::vector<std::vector<size_t>> groups;
+  for (size_t i = 0; i < num_pairs; i++)
+  {
+    if (!transformToMap(request.starts[i], starts[i]) || !transformToMap(request.goals[i], goals[i]))
+    {
+      ROS_WARN_STREAM_THROTTLE(1, "Could not transform the poses of the pair " << i << " into the map frame \""
+                                                                               << map_frame << "\"!");
+      continue;
+    }
+
+    const geometry_msgs::Point& goal = goals[i].pose.position;
+    const auto inserted = group_indices.emplace(std::make_tuple(goal.x, goal.y, goal.z), groups.size());
+    if (inserted.second)
+      groups.emplace_back();
+    groups[inserted.first->second].push_back(i);
+  }
+
+  // distinct goals are planned in parallel if the planner supports concurrent calls, otherwise one after the other
+  const int max_threads = request.max_threads > 0 ? request.max_threads : omp_get_max_threads();
+  const int num_threads = planner_ptr->supportsConcurrentPlans() ? max_threads : 1;
+  ros::WallTime t_start = ros::WallTime::now();
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+  for (size_t g = 0; g < groups.size(); g++)
+  {
+    const std::vector<size_t>& group = groups[g];
+    std::vector<geometry_msgs::PoseStamped> group_starts;
+    group_starts.reserve(group.size());
+    for (const size_t i : group)
+    {
+      group_starts.push_back(starts[i]);
+    }
+
+    std::vector<uint32_t> outcomes;
+    std::vector<std::vector<geometry_msgs::PoseStamped>> plans;
+    std::vector<double> costs;
+    std::string message;
+    planner_ptr->makePlans(goals[group.front()], group_starts, request.tolerance, outcomes, plans, costs, message);
+
+    for (size_t k = 0; k < group.size(); k++)
+    {
+      const size_t i = group[k];
+      response.outcomes[i] = outcomes[k];
+      response.costs[i] = costs[k];
+      if (request.return_paths)
+      {
+        response.paths[i].header.frame_id = map_frame;
+        if (!plans[k].empty())
+          response.paths[i].header = plans[k].front().header;
+        response.paths[i].poses.swap(plans[k]);
+      }
+    }
+  }
+
+  size_t num_planned = 0;
+  for (const uint32_t outcome : response.outcomes)
+  {
+    if (outcome == mbf_msgs::GetPathResult::SUCCESS)
+      num_planned++;
+  }
+
+  const double duration = (ros::WallTime::now() - t_start).toNSec() * 1e-6;
+  response.message = "Planned " + std::to_string(num_planned) + " of " + std::to_string(num_pairs) + " pairs to " +
+                     std::to_string(groups.size()) + " goals with the planner \"" + planner_name + "\" in " +
+                     std::to_string(duration) + " ms.";
+  ROS_INFO_STREAM(response.message);
+  return true;
+}
+
+bool MeshNavigationServer::callServiceDistanceMatrix(mbf_mesh_nav::DistanceMatrix::Request& request,
+                                                     mbf_mesh_nav::DistanceMatrix::Response& response)
+{
+  const size_t num_sources = request.sources.size();
+  const size_t num_targets = request.targets.size();
+  response.distances.assign(num_sources * num_targets, std::numeric_limits<float>::infinity());
+
+  // only the poses which could be transformed into the map frame are passed to the engine
+  auto transformPositions = [this](const std::vector<geometry_msgs::PoseStamped>& poses,
+                                   std::vector<mesh_map::Vector>& positions, std::vector<size_t>& indices) {
+    geometry_msgs::PoseStamped map_pose;
+    for (size_t i = 0; i < poses.size(); i++)
+    {
+      if (!transformToMap(poses[i], map_pose))
+      {
+        ROS_WARN_STREAM_THROTTLE(1, "Could not transform the pose " << i << " into the map frame \""
+                                                                    << mesh_ptr_->mapFrame() << "\"!");
+        continue;
+      }
+      positions.push_back(mesh_map::toVector(map_pose.pose.position));
+      indices.push_back(i);
+    }
+  };
+
+  std::vector<mesh_map::Vector> sources, targets;
+  std::vector<size_t> source_indices, target_indices;
+  transformPositions(request.sources, sources, source_indices);
+  transformPositions(request.targets, targets, target_indices);
+
+  ros::WallTime t_start = ros::WallTime::now();
+  std::vector<float> distances;
+  const size_t num_located = distance_matrix_->compute(sources, targets, request.max_dist, request.cost_limit,
+                                                       static_cast<int>(request.max_threads), distances);
+
+  for (size_t s = 0; s < source_indices.size(); s++)
+  {
+    for (size_t t = 0; t < target_indices.size(); t++)
+    {
+      response.distances[source_indices[s] * num_targets + target_indices[t]] = distances[s * targets.size() + t];
+    }
+  }
+
+  const double duration = (ros::WallTime::now() - t_start).toNSec() * 1e-6;
+  response.message = "Computed the distances from " + std::to_string(num_located) + " of " +
+                     std::to_string(num_sources) + " sources to " + std::to_string(num_targets) + " targets in " +
+                     std::to_string(duration) + " ms.";
+  ROS_INFO_STREAM(response.message);
+  return true;
+}
+
+bool MeshNavigationServer::transformToMap(const geometry_msgs::PoseStamped& pose,
+                                          geometry_msgs::PoseStamped& map_pose)
+{
+  // the poses are usually given in the map frame already
+  const std::string& map_frame = mesh_ptr_->mapFrame();
+  if (pose.header.frame_id == map_frame)
+  {
+    map_pose = pose;
+    return true;
+  }
+  return mbf_utility::transformPose(*tf_listener_ptr_, map_frame, tf_timeout_, pose, map_pose);
 }
 
 bool MeshNavigationServer::callServiceClearMesh(std_srvs::Empty::Request& request, std_srvs::Empty::Response& response)
@@ -42,8 +42,6 @@ MeshPlannerExecution::MeshPlannerExecution(const std::string name, const mbf_mes
                                            const MeshPtr& mesh_ptr, const MoveBaseFlexConfig& config)
   : AbstractPlannerExecution(name, planner_ptr, toAbstract(config)), mesh_ptr_(mesh_ptr)
 {
-  ros::NodeHandle private_nh("~");
-  private_nh.param("planner_lock_mesh", lock_mesh_, true);
 }
 
 MeshPlannerExecution::~MeshPlannerExecution()
@@ -68,6 +66,8 @@ uint32_t MeshPlannerExecution::makePlan(const geometry_msgs::PoseStamped &start,
                                            double &cost,
                                            std::string &message)
 {
+  // The mesh is not locked, the planner pins the current cost snapshot of the mesh map, which is never modified while
+  // layers update
   ros::Time start_time = ros::Time::now();
   uint32_t outcome = planner_->makePlan(start, goal, tolerance, plan, cost, message);
   ROS_INFO_STREAM("Runtime of " << plugin_name_ << ":" << (ros::Time::now() - start_time).toNSec() * 1e-6 << "ms");
@@ -170,8 +170,8 @@ private:
   //! The triangle on which the robot is located
   lvr2::OptionalFaceHandle current_face;
 
-  //! The vector field to the goal.
-  lvr2::DenseVertexMap<mesh_map::Vector> vector_map;
+  //! The vector field to the goal, pinned when the plan is set
+  mesh_map::VectorFieldSnapshot::ConstPtr vector_field;
 
   //! shared pointer to dynamic reconfigure server
   boost::shared_ptr<dynamic_reconfigure::Server<mesh_controller::MeshControllerConfig>> reconfigure_server_ptr;
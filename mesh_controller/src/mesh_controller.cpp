@@ -72,6 +72,14 @@ uint32_t MeshController::computeVelocityCommands(const geometry_msgs::PoseStampe
 {
   const auto& mesh = map_ptr->mesh();
 
+  // pin the current costs for this control cycle, concurrent layer updates publish a new snapshot
+  const mesh_map::CostSnapshot::ConstPtr cost_snapshot = map_ptr->costSnapshot();
+  if (!vector_field || !cost_snapshot)
+  {
+    ROS_ERROR_STREAM("No vector field or costs available!");
+    return mbf_msgs::ExePathResult::NOT_INITIALIZED;
+  }
+
   robot_pos = poseToPositionVector(pose);
   robot_dir = poseToDirectionVector(pose);
   std::array<float, 3> bary_coords;
@@ -149,7 +157,7 @@ uint32_t MeshController::computeVelocityCommands(const geometry_msgs::PoseStampe
 
   // update to which position of the plan the robot is closest
 
-  const auto& opt_dir = map_ptr->directionAtPosition(vector_map, handles, bary_coords);
+  const auto& opt_dir = map_ptr->directionAtPosition(vector_field->vector_map, handles, bary_coords);
   if (!opt_dir)
   {
     DEBUG_CALL(map_ptr->publishDebugFace(face, mesh_map::color(0.3, 0.4, 0), "no_directions");)
@@ -157,7 +165,7 @@ uint32_t MeshController::computeVelocityCommands(const geometry_msgs::PoseStampe
     return mbf_msgs::ExePathResult::FAILURE;
   }
   mesh_map::Normal mesh_dir = opt_dir.get().normalized();
-  float cost = map_ptr->costAtPosition(handles, bary_coords);
+  float cost = map_ptr->costAtPosition(cost_snapshot->vertex_costs, handles, bary_coords);
   const mesh_map::Normal& mesh_normal = poseToDirectionVector(pose, tf2::Vector3(0,0,1));
   std::array<float, 2> velocities = naiveControl(robot_pos, robot_dir, mesh_dir, mesh_normal, cost);
   cmd_vel.twist.linear.x = std::min(config.max_lin_velocity, velocities[0] * config.lin_vel_factor);
@@ -180,8 +188,8 @@ bool MeshController::isGoalReached(double dist_tolerance, double angle_tolerance
 
 bool MeshController::setPlan(const std::vector<geometry_msgs::PoseStamped>& plan)
 {
-  // copy vector field // TODO just use vector field without copying
-  vector_map = map_ptr->getVectorMap();
+  // the vector field of the plan is kept until the next plan is set
+  vector_field = map_ptr->vectorField();
   DEBUG_CALL(map_ptr->publishDebugPoint(poseToPositionVector(plan.front()), mesh_map::color(0, 1, 0), "plan_start");)
   DEBUG_CALL(map_ptr->publishDebugPoint(poseToPositionVector(plan.back()), mesh_map::color(1, 0, 0), "plan_goal");)
   current_plan = plan;
@@ -41,6 +41,7 @@
 #include <dynamic_reconfigure/server.h>
 #include <mesh_layers/InflationLayerConfig.h>
 #include <mesh_map/abstract_layer.h>
+#include <mesh_map/vertex_priority_queue.h>
 
 namespace mesh_layers
 {
@@ -65,6 +66,13 @@ class InflationLayer : public mesh_map::AbstractLayer
    */
   virtual bool writeLayer();
 
+  /**
+   * @brief delivers the key under which the layer is cached in the map file, derived from the mesh hash, the lethal vertices and the inflation parameters
+   *
+   * @return key of the cached layer
+   */
+  uint64_t cacheKey();
+
   /**
    * @brief delivers the default layer value
    *
@@ -104,7 +112,7 @@ class InflationLayer : public mesh_map::AbstractLayer
    * @param distances current distances from the start vertices
    * @param predecessors current predecessors of vertices visited during the wave front propagation
    * @param max_distance max distance of propagation
-   * @param edge_weights weights of the edges
+   * @param corner precomputed geometry of the current face seen from the third vertex
    * @param fh current face
    * @param normal normal of the current face
    * @param v1 first vertex of the current face
@@ -115,7 +123,7 @@ class InflationLayer : public mesh_map::AbstractLayer
    */
   inline bool waveFrontUpdate(lvr2::DenseVertexMap<float>& distances,
                               lvr2::DenseVertexMap<lvr2::VertexHandle>& predecessors, const float& max_distance,
-                              const lvr2::DenseEdgeMap<float>& edge_weights, const lvr2::FaceHandle& fh,
+                              const mesh_map::TriangleCorner& corner, const lvr2::FaceHandle& fh,
                               const lvr2::BaseVector<float>& normal, const lvr2::VertexHandle& v1,
                               const lvr2::VertexHandle& v2, const lvr2::VertexHandle& v3);
 
@@ -213,6 +221,16 @@ class InflationLayer : public mesh_map::AbstractLayer
    */
   virtual void updateLethal(std::set<lvr2::VertexHandle>& added_lethal, std::set<lvr2::VertexHandle>& removed_lethal);
 
+  /**
+   * @brief the inflation is computed around the lethal vertices of the previous layers
+   *
+   * @return true
+   */
+  virtual bool dependsOnLethals()
+  {
+    return true;
+  }
+
   /**
    * @brief initializes this layer plugin
    *
@@ -224,6 +242,9 @@ class InflationLayer : public mesh_map::AbstractLayer
 
   lvr2::DenseVertexMap<float> riskiness;
 
+  // vertices whose riskiness changed with the latest inflation
+  std::vector<lvr2::VertexHandle> riskiness_changes;
+
   lvr2::DenseVertexMap<float> direction;
 
   lvr2::DenseVertexMap<lvr2::FaceHandle> cutting_faces;
@@ -234,6 +255,9 @@ class InflationLayer : public mesh_map::AbstractLayer
 
   std::set<lvr2::VertexHandle> lethal_vertices;
 
+  // priority queue implementation used for the wave front inflation
+  mesh_map::PriorityQueueType priority_queue_type;
+
   // Server for Reconfiguration
   boost::shared_ptr<dynamic_reconfigure::Server<mesh_layers::InflationLayerConfig>> reconfigure_server_ptr;
   dynamic_reconfigure::Server<mesh_layers::InflationLayerConfig>::CallbackType config_callback;
@@ -64,6 +64,13 @@ class RidgeLayer : public mesh_map::AbstractLayer
    */
   virtual bool writeLayer();
 
+  /**
+   * @brief delivers the key under which the layer is cached in the map file, derived from the mesh hash and the radius
+   *
+   * @return key of the cached layer
+   */
+  uint64_t cacheKey();
+
   /**
    * @brief delivers the threshold above which vertices are marked lethal
    *
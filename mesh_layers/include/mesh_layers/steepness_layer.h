@@ -63,6 +63,13 @@ class SteepnessLayer : public mesh_map::AbstractLayer
    */
   virtual bool writeLayer();
 
+  /**
+   * @brief delivers the key under which the layer is cached in the map file, derived from the mesh hash
+   *
+   * @return key of the cached layer
+   */
+  uint64_t cacheKey();
+
   /**
    * @brief delivers the threshold above which vertices are marked lethal
    *
@@ -39,6 +39,7 @@
 
 #include <lvr2/algorithm/GeometryAlgorithms.hpp>
 #include <lvr2/algorithm/NormalAlgorithms.hpp>
+#include <mesh_map/util.h>
 #include <pluginlib/class_list_macros.h>
 
 PLUGINLIB_EXPORT_CLASS(mesh_layers::HeightDiffLayer, mesh_map::AbstractLayer)
@@ -48,13 +49,9 @@ namespace mesh_layers
 bool HeightDiffLayer::readLayer()
 {
   ROS_INFO_STREAM("Try to read height differences from map file...");
-  auto height_diff_opt = mesh_io_ptr->getDenseAttributeMap<lvr2::DenseVertexMap<float>>("height_diff");
-
-  if (height_diff_opt)
+  if (mesh_map::readLayerCache(*mesh_io_ptr, "height_diff", cacheKey(), height_diff))
   {
     ROS_INFO_STREAM("Height differences have been read successfully.");
-    height_diff = height_diff_opt.get();
-
     return computeLethals();
   }
 
@@ -78,7 +75,7 @@ bool HeightDiffLayer::computeLethals()
 bool HeightDiffLayer::writeLayer()
 {
   ROS_INFO_STREAM("Saving height_differences to map file...");
-  if (mesh_io_ptr->addDenseAttributeMap(height_diff, "height_diff"))
+  if (mesh_map::writeLayerCache(*mesh_io_ptr, "height_diff", cacheKey(), height_diff))
   {
     ROS_INFO_STREAM("Saved height differences to map file.");
     return true;
@@ -90,6 +87,11 @@ bool HeightDiffLayer::writeLayer()
   }
 }
 
+uint64_t HeightDiffLayer::cacheKey()
+{
+  return mesh_map::layerCacheKey(map_ptr->meshHash(), { config.radius });
+}
+
 float HeightDiffLayer::threshold()
 {
   return config.threshold;
@@ -125,8 +127,9 @@ void HeightDiffLayer::reconfigureCallback(mesh_layers::HeightDiffLayerConfig& cf
   }
 
   config = cfg;
+  // only the lethal vertices changed, the mesh map derives the affected vertices from them
   if (notify)
-    notifyChange();
+    notifyChange(std::vector<lvr2::VertexHandle>());
 }
 
 bool HeightDiffLayer::initialize(const std::string& name)
@@ -38,7 +38,6 @@
 #include "mesh_layers/inflation_layer.h"
 
 #include <queue>
-#include <lvr2/util/Meap.hpp>
 #include <pluginlib/class_list_macros.h>
 #include <mesh_map/util.h>
 
@@ -50,12 +49,9 @@ bool InflationLayer::readLayer()
 {
   // riskiness
   ROS_INFO_STREAM("Try to read riskiness from map file...");
-  auto riskiness_opt = mesh_io_ptr->getDenseAttributeMap<lvr2::DenseVertexMap<float>>("riskiness");
-
-  if (riskiness_opt)
+  if (mesh_map::readLayerCache(*mesh_io_ptr, "riskiness", cacheKey(), riskiness))
   {
     ROS_INFO_STREAM("Riskiness has been read successfully.");
-    riskiness = riskiness_opt.get();
     return true;
   }
   else
@@ -68,7 +64,7 @@ bool InflationLayer::writeLayer()
 {
   ROS_INFO_STREAM("Saving " << riskiness.numValues() << " riskiness values to map file...");
 
-  if (mesh_io_ptr->addDenseAttributeMap(riskiness, "riskiness"))
+  if (mesh_map::writeLayerCache(*mesh_io_ptr, "riskiness", cacheKey(), riskiness))
   {
     ROS_INFO_STREAM("Saved riskiness to map file.");
     return true;
@@ -80,6 +76,19 @@ bool InflationLayer::writeLayer()
   }
 }
 
+uint64_t InflationLayer::cacheKey()
+{
+  // the riskiness depends on the lethal vertices of the previous layers
+  uint64_t hash = map_ptr->meshHash();
+  for (const auto& vH : lethal_vertices)
+  {
+    const lvr2::Index index = vH.idx();
+    hash = mesh_map::fnv1a(&index, sizeof(index), hash);
+  }
+  return mesh_map::layerCacheKey(hash, { config.inscribed_radius, config.inflation_radius,
+                                 config.inscribed_value, config.lethal_value });
+}
+
 float InflationLayer::threshold()
 {
   return std::numeric_limits<float>::quiet_NaN();
@@ -94,6 +103,9 @@ void InflationLayer::updateLethal(std::set<lvr2::VertexHandle>& added_lethal,
   waveCostInflation(lethal_vertices, config.inflation_radius, config.inscribed_radius, config.inscribed_value,
                     std::numeric_limits<float>::infinity());
 
+  // the riskiness only changes around the added and removed lethal vertices
+  reportChangedVertices(riskiness_changes);
+
   /*lethalCostInflation(lethal_vertices, config.inflation_radius,
                       config.inscribed_radius, config.inscribed_value,
                       config.lethal_value == -1
@@ -156,13 +168,11 @@ inline float InflationLayer::computeUpdateSethianMethod(const float& d1, const f
 
 inline bool InflationLayer::waveFrontUpdate(lvr2::DenseVertexMap<float>& distances,
                                             lvr2::DenseVertexMap<lvr2::VertexHandle>& predecessors,
-                                            const float& max_distance, const lvr2::DenseEdgeMap<float>& edge_weights,
+                                            const float& max_distance, const mesh_map::TriangleCorner& corner,
                                             const lvr2::FaceHandle& fh, const lvr2::BaseVector<float>& normal,
                                             const lvr2::VertexHandle& v1h, const lvr2::VertexHandle& v2h,
                                             const lvr2::VertexHandle& v3h)
 {
-  const auto& mesh = map_ptr->mesh();
-
   const double u1 = distances[v1h];
   const double u2 = distances[v2h];
   const double u3 = distances[v3h];
@@ -170,20 +180,7 @@ inline bool InflationLayer::waveFrontUpdate(lvr2::DenseVertexMap<float>& distanc
   if (u3 == 0)
     return false;
 
-  const lvr2::OptionalEdgeHandle e12h = mesh.getEdgeBetween(v1h, v2h);
-  const float c = edge_weights[e12h.unwrap()];
-  const float c_sq = c * c;
-
-  const lvr2::OptionalEdgeHandle e13h = mesh.getEdgeBetween(v1h, v3h);
-  const float b = edge_weights[e13h.unwrap()];
-  const float b_sq = b * b;
-
-  const lvr2::OptionalEdgeHandle e23h = mesh.getEdgeBetween(v2h, v3h);
-  const float a = edge_weights[e23h.unwrap()];
-  const float a_sq = a * a;
-
-  float dot = (a_sq + b_sq - c_sq) / (2 * a * b);
-  float u3tmp = computeUpdateSethianMethod(u1, u2, a, b, dot, 1.0);
+  float u3tmp = computeUpdateSethianMethod(u1, u2, corner.a, corner.b, corner.cos_theta0, 1.0);
 
   if (!std::isfinite(u3tmp))
     return false;
@@ -272,7 +269,7 @@ void InflationLayer::waveCostInflation(const std::set<lvr2::VertexHandle>& letha
 
     direction = lvr2::DenseVertexMap<float>();
 
-    const auto& edge_distances = map_ptr->edgeDistances();
+    const auto& face_geometry = map_ptr->compactMesh().faceDistanceGeometry();
     const auto& face_normals = map_ptr->faceNormals();
 
     lvr2::DenseVertexMap<bool> fixed(mesh.nextVertexIndex(), false);
@@ -284,7 +281,9 @@ void InflationLayer::waveCostInflation(const std::set<lvr2::VertexHandle>& letha
       predecessors.insert(vH, vH);
     }
 
-    lvr2::Meap<lvr2::VertexHandle, float> pq;
+    mesh_map::VertexPriorityQueue::Ptr pq_ptr =
+        mesh_map::createVertexPriorityQueue(priority_queue_type, mesh.nextVertexIndex());
+    mesh_map::VertexPriorityQueue& pq = *pq_ptr;
     // Set start distance to zero
     // add start vertex to priority queue
     for (auto vH : lethals)
@@ -298,7 +297,7 @@ void InflationLayer::waveCostInflation(const std::set<lvr2::VertexHandle>& letha
 
     while (!pq.isEmpty())
     {
-      lvr2::VertexHandle current_vh = pq.popMin().key();
+      lvr2::VertexHandle current_vh = pq.popMin();
 
       if (current_vh.idx() >= mesh.nextVertexIndex())
       {
@@ -358,8 +357,8 @@ void InflationLayer::waveCostInflation(const std::set<lvr2::VertexHandle>& letha
             else if (fixed[a] && fixed[b] && !fixed[c])
             {
               // c is free
-              if (waveFrontUpdate(distances, predecessors, inflation_radius, edge_distances, fh, face_normals[fh], a, b,
-                                  c))
+              if (waveFrontUpdate(distances, predecessors, inflation_radius, face_geometry.corner(fh, 2), fh,
+                                  face_normals[fh], a, b, c))
               {
                 pq.insert(c, distances[c]);
               }
@@ -368,8 +367,8 @@ void InflationLayer::waveCostInflation(const std::set<lvr2::VertexHandle>& letha
             else if (fixed[a] && !fixed[b] && fixed[c])
             {
               // b is free
-              if (waveFrontUpdate(distances, predecessors, inflation_radius, edge_distances, fh, face_normals[fh], c, a,
-                                  b))
+              if (waveFrontUpdate(distances, predecessors, inflation_radius, face_geometry.corner(fh, 1), fh,
+                                  face_normals[fh], c, a, b))
               {
                 pq.insert(b, distances[b]);
               }
@@ -378,8 +377,8 @@ void InflationLayer::waveCostInflation(const std::set<lvr2::VertexHandle>& letha
             else if (!fixed[a] && fixed[b] && fixed[c])
             {
               // a if free
-              if (waveFrontUpdate(distances, predecessors, inflation_radius, edge_distances, fh, face_normals[fh], b, c,
-                                  a))
+              if (waveFrontUpdate(distances, predecessors, inflation_radius, face_geometry.corner(fh, 0), fh,
+                                  face_normals[fh], b, c, a))
               {
                 pq.insert(a, distances[a]);
               }
@@ -406,9 +405,14 @@ void InflationLayer::waveCostInflation(const std::set<lvr2::VertexHandle>& letha
 
     ROS_INFO_STREAM("Finished inflation wave front propagation.");
 
+    riskiness_changes.clear();
     for (auto vH : mesh_ptr->vertices())
     {
-      riskiness.insert(vH, fading(distances[vH]));
+      const float value = fading(distances[vH]);
+      const auto previous = riskiness.get(vH);
+      if (!previous || previous.get() != value)
+        riskiness_changes.push_back(vH);
+      riskiness.insert(vH, value);
     }
 
     map_ptr->publishVectorField("inflation", vector_map, distances,
@@ -667,6 +671,8 @@ void InflationLayer::reconfigureCallback(mesh_layers::InflationLayerConfig& cfg,
 bool InflationLayer::initialize(const std::string& name)
 {
   first_config = true;
+  priority_queue_type = mesh_map::readPriorityQueueType(private_nh);
+
   reconfigure_server_ptr = boost::shared_ptr<dynamic_reconfigure::Server<mesh_layers::InflationLayerConfig>>(
       new dynamic_reconfigure::Server<mesh_layers::InflationLayerConfig>(private_nh));
 
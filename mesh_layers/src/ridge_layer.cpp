@@ -40,6 +40,7 @@
 #include <lvr2/geometry/BaseVector.hpp>
 #include <lvr2/algorithm/GeometryAlgorithms.hpp>
 #include <lvr2/algorithm/NormalAlgorithms.hpp>
+#include <mesh_map/util.h>
 #include <pluginlib/class_list_macros.h>
 #include <math.h>
 
@@ -50,11 +51,9 @@ namespace mesh_layers
 bool RidgeLayer::readLayer()
 {
   ROS_INFO_STREAM("Try to read ridge from map file...");
-  auto ridge_opt = mesh_io_ptr->getDenseAttributeMap<lvr2::DenseVertexMap<float>>("ridge");
-  if (ridge_opt)
+  if (mesh_map::readLayerCache(*mesh_io_ptr, "ridge", cacheKey(), ridge))
   {
     ROS_INFO_STREAM("Successfully read ridge from map file.");
-    ridge = ridge_opt.get();
     return computeLethals();
   }
 
@@ -63,7 +62,7 @@ bool RidgeLayer::readLayer()
 
 bool RidgeLayer::writeLayer()
 {
-  if (mesh_io_ptr->addDenseAttributeMap(ridge, "ridge"))
+  if (mesh_map::writeLayerCache(*mesh_io_ptr, "ridge", cacheKey(), ridge))
   {
     ROS_INFO_STREAM("Saved ridge to map file.");
     return true;
@@ -75,6 +74,11 @@ bool RidgeLayer::writeLayer()
   }
 }
 
+uint64_t RidgeLayer::cacheKey()
+{
+  return mesh_map::layerCacheKey(map_ptr->meshHash(), { config.radius });
+}
+
 bool RidgeLayer::computeLethals()
 {
   ROS_INFO_STREAM("Compute lethals for \"" << layer_name << "\" (Ridge Layer) with threshold " << config.threshold);
@@ -97,53 +101,8 @@ bool RidgeLayer::computeLayer()
 {
   ROS_INFO_STREAM("Computing ridge...");
 
-  lvr2::DenseFaceMap<mesh_map::Normal> face_normals;
-
-  auto face_normals_opt = mesh_io_ptr->getDenseAttributeMap<lvr2::DenseFaceMap<mesh_map::Normal>>("face_normals");
-
-  if (face_normals_opt)
-  {
-    face_normals = face_normals_opt.get();
-    ROS_INFO_STREAM("Found " << face_normals.numValues() << " face normals in map file.");
-  }
-  else
-  {
-    ROS_INFO_STREAM("No face normals found in the given map file, computing them...");
-    face_normals = lvr2::calcFaceNormals(*mesh_ptr);
-    ROS_INFO_STREAM("Computed " << face_normals.numValues() << " face normals.");
-    if (mesh_io_ptr->addDenseAttributeMap(face_normals, "face_normals"))
-    {
-      ROS_INFO_STREAM("Saved face normals to map file.");
-    }
-    else
-    {
-      ROS_ERROR_STREAM("Could not save face normals to map file!");
-      return false;
-    }
-  }
-
-  lvr2::DenseVertexMap<mesh_map::Normal> vertex_normals;
-  auto vertex_normals_opt = mesh_io_ptr->getDenseAttributeMap<lvr2::DenseVertexMap<mesh_map::Normal>>("vertex_normals");
-
-  if (vertex_normals_opt)
-  {
-    vertex_normals = vertex_normals_opt.get();
-    ROS_INFO_STREAM("Found " << vertex_normals.numValues() << " vertex normals in map file!");
-  }
-  else
-  {
-    ROS_INFO_STREAM("No vertex normals found in the given map file, computing them...");
-    vertex_normals = lvr2::calcVertexNormals(*mesh_ptr, face_normals);
-    if (mesh_io_ptr->addDenseAttributeMap(vertex_normals, "vertex_normals"))
-    {
-      ROS_INFO_STREAM("Saved vertex normals to map file.");
-    }
-    else
-    {
-      ROS_ERROR_STREAM("Could not save vertex normals to map file!");
-      return false;
-    }
-  }
+  // the normals are read from the map file or computed by the mesh map before the layers are initialized
+  const auto& vertex_normals = map_ptr->vertexNormals();
 
   ridge.reserve(mesh_ptr->nextVertexIndex());
 
@@ -204,14 +163,18 @@ void RidgeLayer::reconfigureCallback(mesh_layers::RidgeLayerConfig& cfg, uint32_
     notify = true;
   }
 
+  bool costs_changed = false;
   if (config.radius != cfg.radius)
   {
     computeLayer();
-    notify = true;
+    costs_changed = true;
   }
 
-  if (notify)
+  // if only the lethal vertices changed, the mesh map derives the affected vertices from them
+  if (costs_changed)
     notifyChange();
+  else if (notify)
+    notifyChange(std::vector<lvr2::VertexHandle>());
 
   config = cfg;
 }
@@ -39,6 +39,7 @@
 
 #include <lvr2/algorithm/GeometryAlgorithms.hpp>
 #include <lvr2/algorithm/NormalAlgorithms.hpp>
+#include <mesh_map/util.h>
 #include <pluginlib/class_list_macros.h>
 
 PLUGINLIB_EXPORT_CLASS(mesh_layers::RoughnessLayer, mesh_map::AbstractLayer)
@@ -47,12 +48,8 @@ namespace mesh_layers {
 
 bool RoughnessLayer::readLayer() {
   ROS_INFO_STREAM("Try to read roughness from map file...");
-  auto roughness_opt =
-      mesh_io_ptr->getDenseAttributeMap<lvr2::DenseVertexMap<float>>(
-          "roughness");
-  if (roughness_opt) {
+  if (mesh_map::readLayerCache(*mesh_io_ptr, "roughness", cacheKey(), roughness)) {
     ROS_INFO_STREAM("Successfully read roughness from map file.");
-    roughness = roughness_opt.get();
     return computeLethals();
   }
 
@@ -60,7 +57,7 @@ bool RoughnessLayer::readLayer() {
 }
 
 bool RoughnessLayer::writeLayer() {
-  if (mesh_io_ptr->addDenseAttributeMap(roughness, "roughness")) {
+  if (mesh_map::writeLayerCache(*mesh_io_ptr, "roughness", cacheKey(), roughness)) {
     ROS_INFO_STREAM("Saved roughness to map file.");
     return true;
   } else {
@@ -69,6 +66,11 @@ bool RoughnessLayer::writeLayer() {
   }
 }
 
+uint64_t RoughnessLayer::cacheKey()
+{
+  return mesh_map::layerCacheKey(map_ptr->meshHash(), { config.radius });
+}
+
 bool RoughnessLayer::computeLethals()
 {
   ROS_INFO_STREAM("Compute lethals for \"" << layer_name << "\" (Roughness Layer) with threshold " << config.threshold );
@@ -86,50 +88,8 @@ float RoughnessLayer::threshold() { return config.threshold; }
 bool RoughnessLayer::computeLayer() {
   ROS_INFO_STREAM("Computing roughness...");
 
-  lvr2::DenseFaceMap<mesh_map::Normal> face_normals;
-
-  auto face_normals_opt =
-      mesh_io_ptr->getDenseAttributeMap<lvr2::DenseFaceMap<mesh_map::Normal>>(
-          "face_normals");
-
-  if (face_normals_opt) {
-    face_normals = face_normals_opt.get();
-    ROS_INFO_STREAM("Found " << face_normals.numValues()
-                             << " face normals in map file.");
-  } else {
-    ROS_INFO_STREAM(
-        "No face normals found in the given map file, computing them...");
-    face_normals = lvr2::calcFaceNormals(*mesh_ptr);
-    ROS_INFO_STREAM("Computed " << face_normals.numValues()
-                                << " face normals.");
-    if (mesh_io_ptr->addDenseAttributeMap(face_normals, "face_normals")) {
-      ROS_INFO_STREAM("Saved face normals to map file.");
-    } else {
-      ROS_ERROR_STREAM("Could not save face normals to map file!");
-      return false;
-    }
-  }
-
-  lvr2::DenseVertexMap<mesh_map::Normal> vertex_normals;
-  auto vertex_normals_opt =
-      mesh_io_ptr->getDenseAttributeMap<lvr2::DenseVertexMap<mesh_map::Normal>>(
-          "vertex_normals");
-
-  if (vertex_normals_opt) {
-    vertex_normals = vertex_normals_opt.get();
-    ROS_INFO_STREAM("Found " << vertex_normals.numValues()
-                             << " vertex normals in map file!");
-  } else {
-    ROS_INFO_STREAM(
-        "No vertex normals found in the given map file, computing them...");
-    vertex_normals = lvr2::calcVertexNormals(*mesh_ptr, face_normals);
-    if (mesh_io_ptr->addDenseAttributeMap(vertex_normals, "vertex_normals")) {
-      ROS_INFO_STREAM("Saved vertex normals to map file.");
-    } else {
-      ROS_ERROR_STREAM("Could not save vertex normals to map file!");
-      return false;
-    }
-  }
+  // the normals are read from the map file or computed by the mesh map before the layers are initialized
+  const auto& vertex_normals = map_ptr->vertexNormals();
 
   roughness =
       lvr2::calcVertexRoughness(*mesh_ptr, config.radius, vertex_normals);
@@ -155,7 +115,8 @@ void RoughnessLayer::reconfigureCallback(mesh_layers::RoughnessLayerConfig &cfg,
     notify = true;
   }
 
-  if(notify) notifyChange();
+  // only the lethal vertices changed, the mesh map derives the affected vertices from them
+  if(notify) notifyChange(std::vector<lvr2::VertexHandle>());
 
   config = cfg;
 }
@@ -39,6 +39,7 @@
 
 #include <lvr2/algorithm/GeometryAlgorithms.hpp>
 #include <lvr2/algorithm/NormalAlgorithms.hpp>
+#include <mesh_map/util.h>
 #include <pluginlib/class_list_macros.h>
 #include <math.h>
 
@@ -49,11 +50,9 @@ namespace mesh_layers
 bool SteepnessLayer::readLayer()
 {
   ROS_INFO_STREAM("Try to read steepness from map file...");
-  auto steepness_opt = mesh_io_ptr->getDenseAttributeMap<lvr2::DenseVertexMap<float>>("steepness");
-  if (steepness_opt)
+  if (mesh_map::readLayerCache(*mesh_io_ptr, "steepness", cacheKey(), steepness))
   {
     ROS_INFO_STREAM("Successfully read steepness from map file.");
-    steepness = steepness_opt.get();
     return computeLethals();
   }
 
@@ -62,7 +61,7 @@ bool SteepnessLayer::readLayer()
 
 bool SteepnessLayer::writeLayer()
 {
-  if (mesh_io_ptr->addDenseAttributeMap(steepness, "steepness"))
+  if (mesh_map::writeLayerCache(*mesh_io_ptr, "steepness", cacheKey(), steepness))
   {
     ROS_INFO_STREAM("Saved steepness to map file.");
     return true;
@@ -74,6 +73,11 @@ bool SteepnessLayer::writeLayer()
   }
 }
 
+uint64_t SteepnessLayer::cacheKey()
+{
+  return mesh_map::layerCacheKey(map_ptr->meshHash(), {});
+}
+
 bool SteepnessLayer::computeLethals()
 {
   ROS_INFO_STREAM("Compute lethals for \"" << layer_name << "\" (Steepness Layer) with threshold " << config.threshold);
@@ -96,53 +100,8 @@ bool SteepnessLayer::computeLayer()
 {
   ROS_INFO_STREAM("Computing steepness...");
 
-  lvr2::DenseFaceMap<mesh_map::Normal> face_normals;
-
-  auto face_normals_opt = mesh_io_ptr->getDenseAttributeMap<lvr2::DenseFaceMap<mesh_map::Normal>>("face_normals");
-
-  if (face_normals_opt)
-  {
-    face_normals = face_normals_opt.get();
-    ROS_INFO_STREAM("Found " << face_normals.numValues() << " face normals in map file.");
-  }
-  else
-  {
-    ROS_INFO_STREAM("No face normals found in the given map file, computing them...");
-    face_normals = lvr2::calcFaceNormals(*mesh_ptr);
-    ROS_INFO_STREAM("Computed " << face_normals.numValues() << " face normals.");
-    if (mesh_io_ptr->addDenseAttributeMap(face_normals, "face_normals"))
-    {
-      ROS_INFO_STREAM("Saved face normals to map file.");
-    }
-    else
-    {
-      ROS_ERROR_STREAM("Could not save face normals to map file!");
-      return false;
-    }
-  }
-
-  lvr2::DenseVertexMap<mesh_map::Normal> vertex_normals;
-  auto vertex_normals_opt = mesh_io_ptr->getDenseAttributeMap<lvr2::DenseVertexMap<mesh_map::Normal>>("vertex_normals");
-
-  if (vertex_normals_opt)
-  {
-    vertex_normals = vertex_normals_opt.get();
-    ROS_INFO_STREAM("Found " << vertex_normals.numValues() << " vertex normals in map file!");
-  }
-  else
-  {
-    ROS_INFO_STREAM("No vertex normals found in the given map file, computing them...");
-    vertex_normals = lvr2::calcVertexNormals(*mesh_ptr, face_normals);
-    if (mesh_io_ptr->addDenseAttributeMap(vertex_normals, "vertex_normals"))
-    {
-      ROS_INFO_STREAM("Saved vertex normals to map file.");
-    }
-    else
-    {
-      ROS_ERROR_STREAM("Could not save vertex normals to map file!");
-      return false;
-    }
-  }
+  // the normals are read from the map file or computed by the mesh map before the layers are initialized
+  const auto& vertex_normals = map_ptr->vertexNormals();
 
   steepness.reserve(mesh_ptr->nextVertexIndex());
 
@@ -183,8 +142,9 @@ void SteepnessLayer::reconfigureCallback(mesh_layers::SteepnessLayerConfig& cfg,
     notify = true;
   }
 
+  // only the lethal vertices changed, the mesh map derives the affected vertices from them
   if (notify)
-    notifyChange();
+    notifyChange(std::vector<lvr2::VertexHandle>());
 
   config = cfg;
 }
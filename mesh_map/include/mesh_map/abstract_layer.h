@@ -40,6 +40,7 @@
 #include <mesh_map/MeshMapConfig.h>
 #include <mesh_map/mesh_map.h>
 #include <boost/optional.hpp>
+#include <mutex>
 
 #ifndef MESH_MAP__ABSTRACT_LAYER_H
 #define MESH_MAP__ABSTRACT_LAYER_H
@@ -113,6 +114,18 @@ public:
   virtual void updateLethal(std::set<lvr2::VertexHandle>& added_lethal,
                             std::set<lvr2::VertexHandle>& removed_lethal) = 0;
 
+  /**
+   * @brief Defines whether the layer costs depend on the "lethal" obstacles of the previously processed layers, which
+   * are passed with updateLethal(). Layers which do not depend on them are computed in parallel by the mesh map and
+   * must therefore not access the map file in computeLayer(). Layers which depend on them are always computed from the
+   * current lethals and not cached in the map file.
+   * @return true, if the layer has to be computed after the previous layers; default is false.
+   */
+  virtual bool dependsOnLethals()
+  {
+    return false;
+  }
+
   /**
    * @brief Optional method if the layer computes vectors. Computes a vector within a triangle using barycentric coordinates.
    * @param vertices The three triangle vertices.
@@ -166,11 +179,72 @@ public:
     return initialize(name);
   }
 
+  /**
+   * @brief Notifies the mesh map that the costs of the layer changed, possibly at all vertices.
+   */
   void notifyChange()
   {
+    {
+      std::lock_guard<std::mutex> lock(dirty_mtx);
+      all_dirty = true;
+      dirty_vertices.clear();
+    }
     this->notify(layer_name);
   }
 
+  /**
+   * @brief Notifies the mesh map that the costs of the layer changed only at the given vertices, such that the mesh
+   * map can restrict the update of the combined costs and edge weights to these vertices.
+   * @param vertices The vertices whose costs or lethal state changed.
+   */
+  void notifyChange(const std::vector<lvr2::VertexHandle>& vertices)
+  {
+    {
+      std::lock_guard<std::mutex> lock(dirty_mtx);
+      if (!all_dirty)
+        dirty_vertices.insert(dirty_vertices.end(), vertices.begin(), vertices.end());
+    }
+    this->notify(layer_name);
+  }
+
+  /**
+   * @brief Calls updateLethal() and hands over the vertices whose costs the layer reported as changed by it.
+   * @param added_lethal    The "lethal" obstacle vertex handles which are new with respect to the previous call.
+   * @param removed_lethal  Old "lethal" obstacle vertex handles, i.e. vertices which are no "lethal" obstacles anymore.
+   * @param vertices The changed vertices, may contain duplicates.
+   * @return false, if the layer did not report its changed vertices with reportChangedVertices(); else true.
+   */
+  bool updateLethalTracked(std::set<lvr2::VertexHandle>& added_lethal, std::set<lvr2::VertexHandle>& removed_lethal,
+                           std::vector<lvr2::VertexHandle>& vertices)
+  {
+    {
+      std::lock_guard<std::mutex> lock(dirty_mtx);
+      changed_reported = false;
+      changed_vertices.clear();
+    }
+    updateLethal(added_lethal, removed_lethal);
+
+    std::lock_guard<std::mutex> lock(dirty_mtx);
+    vertices.clear();
+    vertices.swap(changed_vertices);
+    return changed_reported;
+  }
+
+  /**
+   * @brief Hands over the vertices reported as changed since the previous call and resets them.
+   * @param vertices The changed vertices, may contain duplicates.
+   * @return false, if the layer reported a change without restricting it to vertices; else true.
+   */
+  bool takeDirtyVertices(std::vector<lvr2::VertexHandle>& vertices)
+  {
+    std::lock_guard<std::mutex> lock(dirty_mtx);
+    const bool partial = !all_dirty;
+    vertices.clear();
+    vertices.swap(dirty_vertices);
+    all_dirty = false;
+    return partial;
+  }
+
 protected:
   std::string layer_name;
   std::shared_ptr<lvr2::AttributeMeshIOBase> mesh_io_ptr;
@@ -179,8 +253,28 @@ protected:
 
   ros::NodeHandle private_nh;
 
+  /**
+   * @brief Restricts the changes of the current updateLethal() call to the given vertices, without notifying the mesh
+   * map. Otherwise the costs of the layer are considered to have changed at all vertices.
+   * @param vertices The vertices whose costs changed.
+   */
+  void reportChangedVertices(const std::vector<lvr2::VertexHandle>& vertices)
+  {
+    std::lock_guard<std::mutex> lock(dirty_mtx);
+    changed_reported = true;
+    changed_vertices.insert(changed_vertices.end(), vertices.begin(), vertices.end());
+  }
+
 private:
   notify_func notify;
+
+  std::mutex dirty_mtx;
+  std::vector<lvr2::VertexHandle> dirty_vertices;
+  bool all_dirty = false;
+
+  //! vertices reported as changed by the current updateLethal() call
+  std::vector<lvr2::VertexHandle> changed_vertices;
+  bool changed_reported = false;
 };
 
 } /* namespace mesh_map */
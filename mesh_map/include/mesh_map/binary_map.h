@@ -0,0 +1,265 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+#ifndef MESH_MAP__BINARY_MAP_H
+#define MESH_MAP__BINARY_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mesh_map
+{
+/**
+ * @brief Flat, versioned map file which is mapped into memory to start the mesh map without parsing the map file.
+ *
+ * The file starts with a fixed size header, followed by a section table and the 8 byte aligned section payloads.
+ * Every section is a plain array of fixed size elements, e.g. the vertex positions, the face vertex indices, the
+ * normals or the arrays of the compact mesh snapshot. The header stores the mesh hash as well as the size and the
+ * modification time of the source map file, so that an outdated binary map file is detected and rewritten.
+ */
+class BinaryMapFile
+{
+public:
+  //! magic bytes at the beginning of each binary map file
+  static constexpr char MAGIC[8] = { 'M', 'E', 'S', 'H', 'M', 'A', 'P', '\0' };
+
+  //! format version, has to be increased with every incompatible change of the layout
+  static constexpr uint32_t VERSION = 2;
+
+  //! identifiers of the sections
+  enum Section : uint32_t
+  {
+    MESH_PART = 0,
+    VERTEX_POSITIONS,
+    FACE_NORMALS,
+    VERTEX_NORMALS,
+    VALID_VERTICES,
+    INVALID_VERTICES,
+    NEIGHBOUR_OFFSETS,
+    NEIGHBOUR_VERTICES,
+    NEIGHBOUR_EDGES,
+    FACE_OFFSETS,
+    VERTEX_FACES,
+    FACE_VERTICES,
+    FACE_EDGES,
+    EDGE_VERTICES,
+    EDGE_DISTANCES,
+    HIERARCHY_PASSABLE,
+    HIERARCHY_RANKS,
+    HIERARCHY_UPWARD_OFFSETS,
+    HIERARCHY_UPWARD_TARGETS,
+    HIERARCHY_UPWARD_WEIGHTS,
+    HIERARCHY_UPWARD_MIDDLES,
+    FACE_INDICES
+  };
+
+  //! fixed size header at the beginning of the file
+  struct Header
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_sections;
+    uint64_t mesh_hash;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t num_vertices;
+    uint64_t num_faces;
+    uint64_t num_edges;
+  };
+
+  //! entry of the section table, the offset is relative to the beginning of the file
+  struct SectionEntry
+  {
+    uint32_t id;
+    uint32_t element_size;
+    uint64_t offset;
+    uint64_t count;
+  };
+
+  /**
+   * @brief Collects the sections of a binary map file and writes them to disk
+   */
+  class Writer
+  {
+  public:
+    /**
+     * @brief Constructs a writer for the given mesh
+     * @param mesh_hash The hash of the mesh geometry
+     * @param source_size The size of the source map file
+     * @param source_mtime The modification time of the source map file
+     * @param num_vertices The size of the vertex index range
+     * @param num_faces The size of the face index range
+     * @param num_edges The size of the edge index range
+     */
+    Writer(const uint64_t mesh_hash, const uint64_t source_size, const int64_t source_mtime,
+           const uint64_t num_vertices, const uint64_t num_faces, const uint64_t num_edges);
+
+    /**
+     * @brief Copies the given array into a new section
+     * @param id The section identifier
+     * @param values Pointer to the first element
+     * @param count The number of elements
+     */
+    template <typename T>
+    void addSection(const Section id, const T* values, const size_t count)
+    {
+      entries.push_back({ id, sizeof(T), 0, count });
+      payloads.emplace_back(reinterpret_cast<const char*>(values),
+                            reinterpret_cast<const char*>(values) + count * sizeof(T));
+    }
+
+    /**
+     * @brief Writes the header and all sections to a temporary file and moves it to the given path
+     * @param path The path of the binary map file
+     * @return true if the file has been written successfully
+     */
+    bool write(const std::string& path);
+
+  private:
+    //! file header
+    Header header;
+
+    //! section table
+    std::vector<SectionEntry> entries;
+
+    //! section payloads, in the order of the section table
+    std::vector<std::vector<char>> payloads;
+  };
+
+  BinaryMapFile();
+
+  ~BinaryMapFile();
+
+  BinaryMapFile(const BinaryMapFile&) = delete;
+
+  BinaryMapFile& operator=(const BinaryMapFile&) = delete;
+
+  /**
+   * @brief Maps the given file read-only into memory and validates its header and section table
+   * @param path The path of the binary map file
+   * @return true if the file exists and has a valid layout of the current version
+   */
+  bool open(const std::string& path);
+
+  /**
+   * @brief Unmaps the file
+   */
+  void close();
+
+  /**
+   * @brief Returns the header of the mapped file
+   */
+  const Header& header() const
+  {
+    return *reinterpret_cast<const Header*>(data);
+  }
+
+  /**
+   * @brief Returns a pointer into the mapped section with the given identifier
+   * @param id The section identifier
+   * @param count The number of elements of the section
+   * @return The pointer to the first element, or a nullptr if the section does not exist or the element size differs
+   */
+  template <typename T>
+  const T* section(const Section id, size_t& count) const
+  {
+    const SectionEntry* entry = findSection(id);
+    if (!entry || entry->element_size != sizeof(T))
+    {
+      count = 0;
+      return nullptr;
+    }
+    count = entry->count;
+    return reinterpret_cast<const T*>(data + entry->offset);
+  }
+
+  /**
+   * @brief Copies a section into the given vector
+   * @param id The section identifier
+   * @param expected_count The number of elements the section has to hold
+   * @param values The copied elements
+   * @return true if the section exists and holds the expected number of elements
+   */
+  template <typename T>
+  bool readSection(const Section id, const size_t expected_count, std::vector<T>& values) const
+  {
+    size_t count;
+    const T* values_ptr = section<T>(id, count);
+    if (!values_ptr || count != expected_count)
+      return false;
+
+    values.assign(values_ptr, values_ptr + count);
+    return true;
+  }
+
+  /**
+   * @brief Reads the size and the modification time of a file, which identify the source map file
+   * @param path The file path
+   * @param size The file size in bytes
+   * @param mtime The modification time in nanoseconds
+   * @return true if the file exists
+   */
+  static bool fileStamp(const std::string& path, uint64_t& size, int64_t& mtime);
+
+  /**
+   * @brief Replaces the stamp of the source map file in the header of an existing binary map file, e.g. after the
+   * process itself wrote data to the source map file which is not part of the binary map file
+   * @param path The path of the binary map file
+   * @param source_size The new size of the source map file
+   * @param source_mtime The new modification time of the source map file
+   * @return true if the header has been updated
+   */
+  static bool restamp(const std::string& path, const uint64_t source_size, const int64_t source_mtime);
+
+private:
+  /**
+   * @brief Searches the section table for the given identifier
+   */
+  const SectionEntry* findSection(const Section id) const;
+
+  //! start of the mapping
+  const char* data;
+
+  //! size of the mapping
+  size_t size;
+};
+
+} /* namespace mesh_map */
+
+#endif  // MESH_MAP__BINARY_MAP_H
@@ -0,0 +1,375 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+#ifndef MESH_MAP__COMPACT_MESH_H
+#define MESH_MAP__COMPACT_MESH_H
+
+#include <array>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include <lvr2/attrmaps/AttrMaps.hpp>
+#include <lvr2/geometry/BaseVector.hpp>
+#include <lvr2/geometry/HalfEdgeMesh.hpp>
+#include <lvr2/geometry/Handles.hpp>
+#include <mesh_map/binary_map.h>
+#include <mesh_map/face_geometry.h>
+
+namespace mesh_map
+{
+/**
+ * @brief Immutable, index based snapshot of the half-edge mesh connectivity in compressed sparse row (CSR) layout.
+ *
+ * The half-edge mesh requires pointer chasing and allocates a new std::vector for every adjacency query. This
+ * snapshot stores the vertex to neighbour, vertex to face, face to vertex and face to edge relations in flat arrays
+ * indexed by the raw handle indices, with the corresponding edge distances and edge weights stored next to them.
+ * It is built once after the map has been loaded. Only the edge weights are refreshed when the costs are recombined.
+ * The per face geometry of the edge distances is precomputed for the wave front updates.
+ */
+class CompactMesh
+{
+public:
+  typedef std::shared_ptr<CompactMesh> Ptr;
+
+  //! index value marking a missing vertex, face or edge
+  static constexpr lvr2::Index INVALID_INDEX = std::numeric_limits<lvr2::Index>::max();
+
+  /**
+   * @brief Constructs an empty snapshot
+   */
+  CompactMesh();
+
+  /**
+   * @brief Builds the snapshot of the given mesh
+   * @param mesh The half-edge mesh to take the snapshot from
+   * @param edge_distances The vertex distance for each edge
+   */
+  CompactMesh(const lvr2::HalfEdgeMesh<lvr2::BaseVector<float>>& mesh, const lvr2::DenseEdgeMap<float>& edge_distances);
+
+  /**
+   * @brief Restores the snapshot from the sections of a binary map file. The edge weights are reset to the edge
+   * distances.
+   * @param map_file The opened binary map file
+   * @return true if all sections exist and are consistent with the index ranges in the file header
+   */
+  bool read(const BinaryMapFile& map_file);
+
+  /**
+   * @brief Adds the connectivity and edge distance arrays of the snapshot as sections to the binary map file
+   * @param writer The writer of the binary map file
+   */
+  void write(BinaryMapFile::Writer& writer) const;
+
+  /**
+   * @brief Copies the given edge weights into the neighbour and face edge weight arrays
+   * @param edge_weights The edge weights, e.g. the combined edge weights of the mesh map
+   */
+  void updateEdgeWeights(const lvr2::DenseEdgeMap<float>& edge_weights);
+
+  /**
+   * @brief Copies the given edge weights into the edge, neighbour and face edge weight arrays
+   * @param edge_weights The edge weights indexed by the edge index, laid out like edgeDistances()
+   */
+  void updateEdgeWeights(const std::vector<float>& edge_weights);
+
+  /**
+   * @brief Sets the weight of a single edge in the edge, neighbour and face edge weight arrays
+   * @param eH The edge to update
+   * @param weight The new edge weight
+   */
+  void updateEdgeWeight(const lvr2::EdgeHandle& eH, const float weight);
+
+  /**
+   * @brief Returns the size of the vertex index range, i.e. the next vertex index of the mesh
+   */
+  inline lvr2::Index numVertices() const
+  {
+    return num_vertices;
+  }
+
+  /**
+   * @brief Returns the size of the face index range, i.e. the next face index of the mesh
+   */
+  inline lvr2::Index numFaces() const
+  {
+    return num_faces;
+  }
+
+  /**
+   * @brief Returns the size of the edge index range, i.e. the next edge index of the mesh
+   */
+  inline lvr2::Index numEdges() const
+  {
+    return num_edges;
+  }
+
+  /**
+   * @brief Returns true if the vertex exists and its neighbourhood could be resolved while building the snapshot
+   */
+  inline bool isValid(const lvr2::VertexHandle& vH) const
+  {
+    return vH.idx() < num_vertices && valid_vertices[vH.idx()];
+  }
+
+  /**
+   * @brief Returns the vertices whose neighbourhood could not be resolved while building the snapshot
+   */
+  const std::vector<lvr2::VertexHandle>& invalidVertices() const
+  {
+    return invalid_vertices;
+  }
+
+  /**
+   * @brief Returns the first position of the vertex' neighbours in the neighbour arrays
+   */
+  inline lvr2::Index neighboursBegin(const lvr2::VertexHandle& vH) const
+  {
+    return neighbour_offsets[vH.idx()];
+  }
+
+  /**
+   * @brief Returns the position behind the last neighbour of the vertex in the neighbour arrays
+   */
+  inline lvr2::Index neighboursEnd(const lvr2::VertexHandle& vH) const
+  {
+    return neighbour_offsets[vH.idx() + 1];
+  }
+
+  /**
+   * @brief Returns the neighbour vertex indices, ranged by neighboursBegin() and neighboursEnd()
+   */
+  const std::vector<lvr2::Index>& neighbourVertices() const
+  {
+    return neighbour_vertices;
+  }
+
+  /**
+   * @brief Returns the edge indices connecting to the neighbours, laid out like neighbourVertices()
+   */
+  const std::vector<lvr2::Index>& neighbourEdges() const
+  {
+    return neighbour_edges;
+  }
+
+  /**
+   * @brief Returns the edge distances to the neighbours, laid out like neighbourVertices()
+   */
+  const std::vector<float>& neighbourDistances() const
+  {
+    return neighbour_distances;
+  }
+
+  /**
+   * @brief Returns the edge weights to the neighbours, laid out like neighbourVertices()
+   */
+  const std::vector<float>& neighbourWeights() const
+  {
+    return neighbour_weights;
+  }
+
+  /**
+   * @brief Returns the first position of the vertex' incident faces in the vertex face array
+   */
+  inline lvr2::Index facesBegin(const lvr2::VertexHandle& vH) const
+  {
+    return face_offsets[vH.idx()];
+  }
+
+  /**
+   * @brief Returns the position behind the last incident face of the vertex in the vertex face array
+   */
+  inline lvr2::Index facesEnd(const lvr2::VertexHandle& vH) const
+  {
+    return face_offsets[vH.idx() + 1];
+  }
+
+  /**
+   * @brief Returns the incident face indices of all vertices, ranged by facesBegin() and facesEnd()
+   */
+  const std::vector<lvr2::Index>& vertexFaces() const
+  {
+    return vertex_faces;
+  }
+
+  /**
+   * @brief Returns the three vertices of the given face in the mesh's order
+   */
+  inline std::array<lvr2::VertexHandle, 3> verticesOfFace(const lvr2::FaceHandle& fH) const
+  {
+    const lvr2::Index* v = &face_vertices[3 * fH.idx()];
+    return { lvr2::VertexHandle(v[0]), lvr2::VertexHandle(v[1]), lvr2::VertexHandle(v[2]) };
+  }
+
+  /**
+   * @brief Returns the vertex indices of all faces, three consecutive entries per face
+   */
+  const std::vector<lvr2::Index>& faceVertices() const
+  {
+    return face_vertices;
+  }
+
+  /**
+   * @brief Returns the edge indices of all faces, three consecutive entries per face. The k-th edge of a face
+   * connects its k-th and its (k+1 mod 3)-th vertex.
+   */
+  const std::vector<lvr2::Index>& faceEdges() const
+  {
+    return face_edges;
+  }
+
+  /**
+   * @brief Returns the edge distances of all faces, laid out like faceEdges()
+   */
+  const std::vector<float>& faceEdgeDistances() const
+  {
+    return face_edge_distances;
+  }
+
+  /**
+   * @brief Returns the edge weights of all faces, laid out like faceEdges()
+   */
+  const std::vector<float>& faceEdgeWeights() const
+  {
+    return face_edge_weights;
+  }
+
+  /**
+   * @brief Returns the per face geometry built from the face edge distances
+   */
+  const FaceGeometry& faceDistanceGeometry() const
+  {
+    return face_distance_geometry;
+  }
+
+  /**
+   * @brief Returns both vertices of the given edge
+   */
+  inline std::array<lvr2::VertexHandle, 2> verticesOfEdge(const lvr2::EdgeHandle& eH) const
+  {
+    return { lvr2::VertexHandle(edge_vertices[2 * eH.idx()]), lvr2::VertexHandle(edge_vertices[2 * eH.idx() + 1]) };
+  }
+
+  /**
+   * @brief Returns the vertex indices of all edges, two consecutive entries per edge
+   */
+  const std::vector<lvr2::Index>& edgeVertices() const
+  {
+    return edge_vertices;
+  }
+
+  /**
+   * @brief Returns the distances of all edges, indexed by the edge index
+   */
+  const std::vector<float>& edgeDistances() const
+  {
+    return edge_distances;
+  }
+
+  /**
+   * @brief Returns the weights of all edges, indexed by the edge index
+   */
+  const std::vector<float>& edgeWeights() const
+  {
+    return edge_weights;
+  }
+
+private:
+  //! size of the vertex index range
+  lvr2::Index num_vertices;
+
+  //! size of the face index range
+  lvr2::Index num_faces;
+
+  //! size of the edge index range
+  lvr2::Index num_edges;
+
+  //! per vertex flag, false for deleted vertices or broken neighbourhoods
+  std::vector<bool> valid_vertices;
+
+  //! vertices whose neighbourhood could not be resolved
+  std::vector<lvr2::VertexHandle> invalid_vertices;
+
+  //! CSR offsets into the neighbour arrays, one entry more than vertices
+  std::vector<lvr2::Index> neighbour_offsets;
+
+  //! neighbour vertex indices
+  std::vector<lvr2::Index> neighbour_vertices;
+
+  //! edge indices to the neighbours
+  std::vector<lvr2::Index> neighbour_edges;
+
+  //! edge distances to the neighbours
+  std::vector<float> neighbour_distances;
+
+  //! edge weights to the neighbours
+  std::vector<float> neighbour_weights;
+
+  //! CSR offsets into the vertex face array, one entry more than vertices
+  std::vector<lvr2::Index> face_offsets;
+
+  //! incident face indices
+  std::vector<lvr2::Index> vertex_faces;
+
+  //! three vertex indices per face
+  std::vector<lvr2::Index> face_vertices;
+
+  //! three edge indices per face
+  std::vector<lvr2::Index> face_edges;
+
+  //! three edge distances per face
+  std::vector<float> face_edge_distances;
+
+  //! three edge weights per face
+  std::vector<float> face_edge_weights;
+
+  //! triangle corners of the face edge distances
+  FaceGeometry face_distance_geometry;
+
+  //! two vertex indices per edge
+  std::vector<lvr2::Index> edge_vertices;
+
+  //! distance per edge
+  std::vector<float> edge_distances;
+
+  //! weight per edge
+  std::vector<float> edge_weights;
+};
+
+} /* namespace mesh_map */
+
+#endif  // MESH_MAP__COMPACT_MESH_H
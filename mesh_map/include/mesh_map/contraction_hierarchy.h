@@ -0,0 +1,255 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+#ifndef MESH_MAP__CONTRACTION_HIERARCHY_H
+#define MESH_MAP__CONTRACTION_HIERARCHY_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <lvr2/geometry/Handles.hpp>
+#include <mesh_map/compact_mesh.h>
+
+namespace mesh_map
+{
+/**
+ * @brief Contraction hierarchy over the passable vertices of the mesh graph, which answers shortest path queries with
+ * two small upward searches instead of a search over the whole mesh.
+ *
+ * The passable vertices are contracted one after another in the order of their edge difference. Contracting a vertex
+ * adds a shortcut between two of its remaining neighbours if no witness path of at most the same length avoids the
+ * vertex. Each vertex keeps the edges and shortcuts to its neighbours of a higher rank in compressed sparse row (CSR)
+ * layout. Since the mesh graph is undirected, the forward and the backward search share these upward edges. A
+ * shortcut stores the contracted vertex it bypasses, such that a path of the hierarchy is unpacked into the original
+ * mesh edges. The hierarchy depends only on the edge weights and on the set of passable vertices it has been built
+ * from and has to be rebuilt if a vertex becomes passable or impassable.
+ */
+class ContractionHierarchy
+{
+public:
+  typedef std::shared_ptr<const ContractionHierarchy> ConstPtr;
+
+  //! index value marking a vertex outside of the hierarchy or an original edge without a middle vertex
+  static constexpr lvr2::Index INVALID_INDEX = CompactMesh::INVALID_INDEX;
+
+  //! maximum number of vertices settled by a witness search, a missed witness only adds a superfluous shortcut
+  static constexpr size_t MAX_WITNESS_SETTLED = 500;
+
+  /**
+   * @brief Constructs an empty hierarchy
+   */
+  ContractionHierarchy();
+
+  /**
+   * @brief Contracts the passable vertices of the given graph
+   * @param graph The compact mesh providing the vertex neighbourhoods
+   * @param weights The edge weights, laid out like the neighbour arrays of the compact mesh
+   * @param passable Per vertex flag, only the passable vertices and the edges between them are part of the hierarchy
+   */
+  void build(const CompactMesh& graph, const std::vector<float>& weights, const std::vector<uint8_t>& passable);
+
+  /**
+   * @brief Restores the hierarchy from the given file
+   * @param path The path of the hierarchy file
+   * @param mesh_hash The hash of the mesh geometry, the file has to belong to the same mesh
+   * @return true if the file exists, belongs to the mesh and contains a complete hierarchy
+   */
+  bool read(const std::string& path, const uint64_t mesh_hash);
+
+  /**
+   * @brief Writes the hierarchy to the given file, using the layout of the binary map file
+   * @param path The path of the hierarchy file
+   * @param mesh_hash The hash of the mesh geometry
+   * @return true if the file has been written successfully
+   */
+  bool write(const std::string& path, const uint64_t mesh_hash) const;
+
+  /**
+   * @brief Unpacks the shortcuts of a path found by the upward searches into the original edges
+   * @param hierarchy_path The vertices of the path, two consecutive vertices are connected by an upward edge
+   * @param path The vertices of the unpacked path, starting with the first vertex of the hierarchy path
+   * @param lengths The length of the unpacked path up to each of its vertices
+   * @return false if two consecutive vertices are not connected by an edge of the hierarchy
+   */
+  bool unpackPath(const std::vector<lvr2::VertexHandle>& hierarchy_path, std::vector<lvr2::VertexHandle>& path,
+                  std::vector<float>& lengths) const;
+
+  /**
+   * @brief Returns true if the vertex is passable and thereby part of the hierarchy
+   */
+  inline bool contains(const lvr2::VertexHandle& vH) const
+  {
+    return vH.idx() < passable.size() && passable[vH.idx()];
+  }
+
+  /**
+   * @brief Returns the index of the first upward edge of the given vertex
+   */
+  inline lvr2::Index upwardBegin(const lvr2::VertexHandle& vH) const
+  {
+    return upward_offsets[vH.idx()];
+  }
+
+  /**
+   * @brief Returns the index after the last upward edge of the given vertex
+   */
+  inline lvr2::Index upwardEnd(const lvr2::VertexHandle& vH) const
+  {
+    return upward_offsets[vH.idx() + 1];
+  }
+
+  /**
+   * @brief Returns the higher ranked end vertex of all upward edges, ranged by upwardBegin() and upwardEnd()
+   */
+  const std::vector<lvr2::Index>& upwardTargets() const
+  {
+    return upward_targets;
+  }
+
+  /**
+   * @brief Returns the weights of all upward edges, laid out like upwardTargets()
+   */
+  const std::vector<float>& upwardWeights() const
+  {
+    return upward_weights;
+  }
+
+  /**
+   * @brief Returns the per vertex flags of the passable vertices the hierarchy has been built from
+   */
+  const std::vector<uint8_t>& passableVertices() const
+  {
+    return passable;
+  }
+
+  /**
+   * @brief Returns the number of shortcuts added by the contraction
+   */
+  size_t numShortcuts() const
+  {
+    return num_shortcuts;
+  }
+
+private:
+  //! edge of the remaining graph during the contraction
+  struct Arc
+  {
+    //! other end vertex of the edge
+    lvr2::Index target;
+
+    //! edge weight
+    float weight;
+
+    //! vertex bypassed by a shortcut, INVALID_INDEX for an original edge
+    lvr2::Index middle;
+  };
+
+  //! shortcut between two neighbours of a contracted vertex
+  struct Shortcut
+  {
+    //! first neighbour
+    lvr2::Index from;
+
+    //! second neighbour
+    lvr2::Index to;
+
+    //! length of the path over the contracted vertex
+    float weight;
+  };
+
+  //! reusable state of the witness searches
+  struct WitnessSearch
+  {
+    //! tentative distance of each vertex to the source of the search
+    std::vector<float> distances;
+
+    //! vertices whose distance has been written by the current search
+    std::vector<lvr2::Index> touched;
+
+    //! per vertex flag of the neighbours the current search has to settle
+    std::vector<uint8_t> targets;
+  };
+
+  /**
+   * @brief Collects the shortcuts required to contract the given vertex
+   * @param vH The vertex to contract
+   * @param arcs The edges of the remaining graph
+   * @param search The state of the witness searches
+   * @param shortcuts The required shortcuts, each pair of neighbours is contained once
+   */
+  static void findShortcuts(const lvr2::Index vH, const std::vector<std::vector<Arc>>& arcs, WitnessSearch& search,
+                            std::vector<Shortcut>& shortcuts);
+
+  /**
+   * @brief Adds an edge to the remaining graph or shortens the existing one
+   */
+  static void addArc(std::vector<Arc>& vertex_arcs, const lvr2::Index target, const float weight,
+                     const lvr2::Index middle);
+
+  /**
+   * @brief Searches the upward edge connecting the given vertices
+   * @return the index of the upward edge or INVALID_INDEX if the vertices are not connected
+   */
+  lvr2::Index findUpwardEdge(const lvr2::Index a, const lvr2::Index b) const;
+
+  //! per vertex flag of the passable vertices
+  std::vector<uint8_t> passable;
+
+  //! contraction order of each vertex, INVALID_INDEX for impassable vertices
+  std::vector<lvr2::Index> ranks;
+
+  //! CSR offsets into the upward edge arrays, one entry more than vertices
+  std::vector<lvr2::Index> upward_offsets;
+
+  //! higher ranked end vertex of each upward edge
+  std::vector<lvr2::Index> upward_targets;
+
+  //! weight of each upward edge
+  std::vector<float> upward_weights;
+
+  //! vertex bypassed by each upward edge, INVALID_INDEX for the original edges
+  std::vector<lvr2::Index> upward_middles;
+
+  //! number of shortcuts added by the contraction
+  size_t num_shortcuts;
+};
+
+} /* namespace mesh_map */
+
+#endif  // MESH_MAP__CONTRACTION_HIERARCHY_H
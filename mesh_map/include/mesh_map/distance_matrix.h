@@ -0,0 +1,156 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+#ifndef MESH_MAP__DISTANCE_MATRIX_H
+#define MESH_MAP__DISTANCE_MATRIX_H
+
+#include <array>
+#include <mutex>
+#include <vector>
+
+#include <lvr2/attrmaps/AttrMaps.hpp>
+#include <lvr2/geometry/Handles.hpp>
+#include <mesh_map/mesh_map.h>
+#include <mesh_map/planner_workspace.h>
+#include <mesh_map/vertex_priority_queue.h>
+
+namespace mesh_map
+{
+/**
+ * @brief Computes the geodesic distances between many sources and many targets on the mesh map, e.g. the cost matrix
+ * of a task allocation over a set of sites.
+ *
+ * Each source seeds one Fast Marching propagation over the precomputed face geometry, the propagations of different
+ * sources run in parallel on their own per thread workspaces. A propagation stops as soon as the vertices of all
+ * target faces are fixed, the distance of a target is interpolated from the distances of its face vertices with the
+ * barycentric coordinates of the target. Vertices whose costs exceed the cost limit are not expanded, like in the wave
+ * front planner.
+ */
+class DistanceMatrix
+{
+public:
+  /**
+   * @brief Constructs the engine for the given mesh map
+   * @param mesh_map The mesh map to compute the distances on, has to outlive the engine
+   * @param queue_type The priority queue implementation of the propagations
+   */
+  DistanceMatrix(MeshMap& mesh_map, const PriorityQueueType& queue_type = DARY_HEAP);
+
+  /**
+   * @brief Computes the distances from each source to each target. All propagations use the same pinned costs of the
+   * map. Concurrent calls are serialized, since the per thread workspaces are shared between the calls.
+   * @param sources The source positions
+   * @param targets The target positions
+   * @param max_dist The maximum distance of a source or target to its containing face
+   * @param cost_limit Vertices with higher costs are not expanded
+   * @param num_threads The number of parallel propagations, zero to use all cores
+   * @param distances The row major matrix of the distances, with one row per source and one column per target. The
+   * distance is infinity if the target is not reachable or if the source or the target is not located on the mesh.
+   * @return The number of sources located on the mesh
+   */
+  size_t compute(const std::vector<Vector>& sources, const std::vector<Vector>& targets, const float max_dist,
+                 const float cost_limit, const int num_threads, std::vector<float>& distances);
+
+private:
+  //! reusable state of the propagations of one thread
+  struct Workspace
+  {
+    //! distances of the vertices to the current source
+    lvr2::DenseVertexMap<float> distances;
+
+    //! predecessor of each vertex, only kept to let the planner workspace restore the touched vertices
+    lvr2::DenseVertexMap<lvr2::VertexHandle> predecessors;
+
+    //! touched and fixed vertices of the current propagation
+    PlannerWorkspace workspace;
+
+    //! vertices of the target faces which are not fixed yet
+    StampedVertexFlags target_flags;
+
+    //! priority queue of the propagation
+    VertexPriorityQueue::Ptr queue;
+
+    //! size of the vertex index range the priority queue has been created for
+    lvr2::Index queue_size = 0;
+  };
+
+  /**
+   * @brief Propagates the distances from one source until the vertices of all target faces are fixed
+   * @param source The source position, projected onto its face
+   * @param source_face The face containing the source
+   * @param target_vertices The vertices of the faces containing the targets
+   * @param vertex_costs The pinned vertex costs
+   * @param cost_limit Vertices with higher costs are not expanded
+   * @param ws The workspace of the calling thread
+   */
+  void propagate(const Vector& source, const lvr2::FaceHandle& source_face,
+                 const std::vector<lvr2::VertexHandle>& target_vertices,
+                 const SharedVertexCosts& vertex_costs, const float cost_limit, Workspace& ws);
+
+  /**
+   * @brief Interpolates the distance of a target from the distances of its face vertices
+   * @param target The target position, projected onto its face
+   * @param target_face The face containing the target
+   * @param barycentric_coords The barycentric coordinates of the target within its face
+   * @param distances The distances of the vertices to the source
+   * @return The distance of the target, infinity if none of the face vertices has been reached
+   */
+  float targetDistance(const Vector& target, const lvr2::FaceHandle& target_face,
+                       const std::array<float, 3>& barycentric_coords,
+                       const lvr2::DenseVertexMap<float>& distances) const;
+
+  /**
+   * @brief Projects the located positions onto their faces
+   */
+  Vector projectedPosition(const lvr2::FaceHandle& face, const std::array<float, 3>& barycentric_coords) const;
+
+  //! mesh map to compute the distances on
+  MeshMap& mesh_map;
+
+  //! priority queue implementation of the propagations
+  PriorityQueueType queue_type;
+
+  //! one workspace per thread, reused by the following calls
+  std::vector<Workspace> workspaces;
+
+  //! serializes the calls sharing the workspaces
+  std::mutex mutex;
+};
+
+} /* namespace mesh_map */
+
+#endif  // MESH_MAP__DISTANCE_MATRIX_H
@@ -0,0 +1,176 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+#ifndef MESH_MAP__FACE_BVH_H
+#define MESH_MAP__FACE_BVH_H
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <lvr2/geometry/HalfEdgeMesh.hpp>
+#include <lvr2/geometry/Handles.hpp>
+#include <mesh_map/util.h>
+
+namespace mesh_map
+{
+/**
+ * @brief Bounding volume hierarchy over all faces of the mesh, built with the surface area heuristic (SAH).
+ *
+ * The nodes are stored depth first in a flat array, the left child of an inner node directly follows its parent.
+ * The triangle vertices are copied in leaf order, so that a leaf references a contiguous range of triangles. The
+ * hierarchy answers exact closest face and ray intersection queries in logarithmic time.
+ */
+class FaceBVH
+{
+public:
+  //! maximum number of triangles in a leaf
+  static constexpr uint32_t MAX_LEAF_SIZE = 4;
+
+  //! number of bins used to evaluate the surface area heuristic
+  static constexpr size_t NUM_BINS = 16;
+
+  /**
+   * @brief Constructs an empty hierarchy
+   */
+  FaceBVH();
+
+  /**
+   * @brief Builds the hierarchy over all faces of the given mesh
+   * @param mesh The mesh to build the hierarchy for
+   */
+  void build(const lvr2::HalfEdgeMesh<Vector>& mesh);
+
+  /**
+   * @brief Searches for the face closest to the given point
+   * @param point The query point
+   * @param max_dist The maximum distance between the point and the face
+   * @param face The closest face
+   * @param barycentric_coords The barycentric coordinates of the closest point on the face
+   * @param dist The distance between the query point and the closest point on the face
+   * @return true if a face has been found within the maximum distance
+   */
+  bool closestFace(const Vector& point, const float max_dist, lvr2::FaceHandle& face,
+                   std::array<float, 3>& barycentric_coords, float& dist) const;
+
+  /**
+   * @brief Searches for the closest faces of many points at once. The points are processed in Morton order by
+   * multiple threads. Each thread reuses its traversal stack and bounds the search of a point by the distance to the
+   * closest face of the previous point.
+   * @param points The query points
+   * @param max_dist The maximum distance between a point and its face
+   * @param faces The closest face of each point, invalid if no face is within the maximum distance
+   * @param barycentric_coords The barycentric coordinates of the closest point on the face of each point
+   * @param dists The distance of each point to its closest face, infinity if no face has been found
+   */
+  void closestFaces(const std::vector<Vector>& points, const float max_dist,
+                    std::vector<lvr2::OptionalFaceHandle>& faces, std::vector<std::array<float, 3>>& barycentric_coords,
+                    std::vector<float>& dists) const;
+
+  /**
+   * @brief Searches for the first face hit by the given ray
+   * @param origin The ray origin
+   * @param direction The ray direction
+   * @param max_dist The maximum ray parameter, in multiples of the direction
+   * @param face The first face hit by the ray
+   * @param barycentric_coords The barycentric coordinates of the intersection point
+   * @param t The ray parameter of the intersection point
+   * @return true if the ray hits a face within the maximum distance
+   */
+  bool intersectRay(const Vector& origin, const Vector& direction, const float max_dist, lvr2::FaceHandle& face,
+                    std::array<float, 3>& barycentric_coords, float& t) const;
+
+  /**
+   * @brief Returns the number of nodes of the hierarchy
+   */
+  size_t numNodes() const
+  {
+    return nodes.size();
+  }
+
+private:
+  //! node of the hierarchy, an inner node if count is zero and a leaf otherwise
+  struct Node
+  {
+    std::array<float, 3> bb_min;
+    std::array<float, 3> bb_max;
+    //! index of the right child for inner nodes, index of the first triangle for leafs
+    uint32_t offset;
+    //! number of triangles of a leaf
+    uint32_t count;
+  };
+
+  //! marks that no triangle has been found
+  static constexpr uint32_t INVALID_TRIANGLE = std::numeric_limits<uint32_t>::max();
+
+  /**
+   * @brief Searches for a triangle closer to the point than the current best triangle
+   * @param point The query point
+   * @param stack The traversal stack, which is reused between queries
+   * @param best_triangle The index of the closest triangle in leaf order, updated if a closer triangle is found
+   * @param best_dist2 The squared distance to the closest triangle, or the squared search radius
+   * @param barycentric_coords The barycentric coordinates of the closest point on the closest triangle
+   */
+  void closestTriangle(const Vector& point, std::vector<uint32_t>& stack, uint32_t& best_triangle, float& best_dist2,
+                       std::array<float, 3>& barycentric_coords) const;
+
+  /**
+   * @brief Builds the subtree over the given range of the triangle order
+   * @param begin The first position in the triangle order
+   * @param end The position behind the last triangle
+   * @param centroids The triangle centroids
+   * @param bounds The triangle bounding boxes, minimum and maximum per triangle
+   * @param order The triangle order, which is partitioned by this method
+   * @return The index of the subtree's root node
+   */
+  uint32_t buildNode(const uint32_t begin, const uint32_t end, const std::vector<Vector>& centroids,
+                     const std::vector<std::array<Vector, 2>>& bounds, std::vector<uint32_t>& order);
+
+  //! flat node array in depth first order
+  std::vector<Node> nodes;
+
+  //! triangle vertices in leaf order
+  std::vector<std::array<Vector, 3>> triangles;
+
+  //! face index of each triangle
+  std::vector<lvr2::Index> face_indices;
+};
+
+} /* namespace mesh_map */
+
+#endif  // MESH_MAP__FACE_BVH_H
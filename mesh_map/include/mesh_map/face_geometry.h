@@ -0,0 +1,118 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+#ifndef MESH_MAP__FACE_GEOMETRY_H
+#define MESH_MAP__FACE_GEOMETRY_H
+
+#include <vector>
+
+#include <lvr2/geometry/Handles.hpp>
+
+namespace mesh_map
+{
+/**
+ * @brief Geometry of a triangle seen from one of its corners, i.e. the third vertex, which is updated from the first
+ * and the second vertex by the wave front update. The triangle is unfolded into the plane with the first vertex at
+ * the origin and the second vertex on the positive x axis.
+ */
+struct TriangleCorner
+{
+  //! edge weight between the second and the third vertex
+  float a;
+
+  //! edge weight between the first and the third vertex
+  float b;
+
+  //! edge weight between the first and the second vertex
+  float c;
+
+  //! reciprocal of twice the edge weight c
+  float inv_two_c;
+
+  //! x coordinate of the unfolded third vertex
+  float p;
+
+  //! y coordinate of the unfolded third vertex
+  float hc;
+
+  //! cosine of the inner angle at the third vertex
+  float cos_theta0;
+};
+
+/**
+ * @brief Precomputed per face geometry for the wave front updates. Each face stores three corners, the k-th corner
+ * updates the k-th vertex of the face from its (k+1 mod 3)-th and (k+2 mod 3)-th vertex. The table depends only on
+ * the edge weights it has been built from and has to be rebuilt if they change.
+ */
+class FaceGeometry
+{
+public:
+  /**
+   * @brief Constructs an empty table
+   */
+  FaceGeometry();
+
+  /**
+   * @brief Builds the corners of all faces
+   * @param face_edge_weights The edge weights of all faces, laid out like CompactMesh::faceEdges()
+   */
+  void build(const std::vector<float>& face_edge_weights);
+
+  /**
+   * @brief Returns the corner of the given face, which updates the face's k-th vertex
+   */
+  inline const TriangleCorner& corner(const lvr2::FaceHandle& fH, const size_t k) const
+  {
+    return corners[3 * fH.idx() + k];
+  }
+
+  /**
+   * @brief Returns the number of faces of the table
+   */
+  inline size_t numFaces() const
+  {
+    return corners.size() / 3;
+  }
+
+private:
+  //! three corners per face
+  std::vector<TriangleCorner> corners;
+};
+
+} /* namespace mesh_map */
+
+#endif  // MESH_MAP__FACE_GEOMETRY_H
@@ -0,0 +1,199 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+#ifndef MESH_MAP__MAP_SNAPSHOT_H
+#define MESH_MAP__MAP_SNAPSHOT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <lvr2/attrmaps/AttrMaps.hpp>
+#include <lvr2/geometry/BaseVector.hpp>
+
+namespace mesh_map
+{
+/**
+ * @brief Read only attribute map of a snapshot, stored in blocks which are shared between consecutive snapshots.
+ *
+ * Copying the map only copies the block pointers, an update only copies the blocks containing changed handles.
+ */
+template <typename HandleT, typename ValueT>
+class SharedBlockMap
+{
+public:
+  //! number of values per block, given as power of two
+  static constexpr size_t BLOCK_BITS = 12;
+  static constexpr size_t BLOCK_SIZE = size_t(1) << BLOCK_BITS;
+
+  SharedBlockMap() : num_values(0)
+  {
+  }
+
+  /**
+   * @brief Copies all values of the given map
+   * @param values The map to copy, which has to contain all handles in [0, num_values)
+   * @param num_values The number of values to copy
+   */
+  template <typename MapT>
+  void assign(const MapT& values, const size_t num_values)
+  {
+    this->num_values = num_values;
+    blocks.resize((num_values + BLOCK_SIZE - 1) >> BLOCK_BITS);
+    for (size_t b = 0; b < blocks.size(); b++)
+    {
+      blocks[b] = copyBlock(values, b);
+    }
+  }
+
+  /**
+   * @brief Copies the blocks containing the given handles, all other blocks stay shared with the previous snapshots
+   * @param values The map to copy the values from, which has the same number of values
+   * @param handles The handles whose values changed
+   */
+  template <typename MapT>
+  void update(const MapT& values, const std::vector<HandleT>& handles)
+  {
+    std::vector<bool> copied(blocks.size(), false);
+    for (const auto& handle : handles)
+    {
+      const size_t b = handle.idx() >> BLOCK_BITS;
+      if (!copied[b])
+      {
+        blocks[b] = copyBlock(values, b);
+        copied[b] = true;
+      }
+    }
+  }
+
+  const ValueT& operator[](const HandleT& handle) const
+  {
+    return (*blocks[handle.idx() >> BLOCK_BITS])[handle.idx() & (BLOCK_SIZE - 1)];
+  }
+
+  boost::optional<const ValueT&> get(const HandleT& handle) const
+  {
+    if (handle.idx() >= num_values)
+      return boost::none;
+    return (*this)[handle];
+  }
+
+  size_t numValues() const
+  {
+    return num_values;
+  }
+
+private:
+  typedef std::vector<ValueT> Block;
+
+  /**
+   * @brief Copies the values of the block with the given index
+   */
+  template <typename MapT>
+  std::shared_ptr<const Block> copyBlock(const MapT& values, const size_t b) const
+  {
+    const size_t begin = b << BLOCK_BITS;
+    const size_t end = std::min(begin + BLOCK_SIZE, num_values);
+    auto block = std::make_shared<Block>(end - begin);
+    for (size_t i = begin; i < end; i++)
+    {
+      (*block)[i - begin] = values[HandleT(i)];
+    }
+    return block;
+  }
+
+  //! shared blocks of values
+  std::vector<std::shared_ptr<const Block>> blocks;
+
+  //! number of values
+  size_t num_values;
+};
+
+template <typename HandleT, typename ValueT>
+constexpr size_t SharedBlockMap<HandleT, ValueT>::BLOCK_BITS;
+template <typename HandleT, typename ValueT>
+constexpr size_t SharedBlockMap<HandleT, ValueT>::BLOCK_SIZE;
+
+//! vertex costs of a cost snapshot
+typedef SharedBlockMap<lvr2::VertexHandle, float> SharedVertexCosts;
+
+//! edge weights of a cost snapshot
+typedef SharedBlockMap<lvr2::EdgeHandle, float> SharedEdgeWeights;
+
+/**
+ * @brief Immutable snapshot of the combined costs of the mesh map.
+ *
+ * A new snapshot is published each time the layer costs are combined and replaces the previous one with an atomic
+ * pointer swap. Readers pin the snapshot they obtained for as long as they hold the pointer, e.g. for one planning or
+ * control cycle, and are never blocked by or exposed to a concurrent combination of the layer costs.
+ */
+struct CostSnapshot
+{
+  typedef std::shared_ptr<const CostSnapshot> ConstPtr;
+
+  //! costs version of the snapshot, see MeshMap::costsVersion()
+  uint64_t version;
+
+  //! combined layer costs
+  SharedVertexCosts vertex_costs;
+
+  //! edge weights
+  SharedEdgeWeights edge_weights;
+};
+
+/**
+ * @brief Immutable snapshot of the vector field stored in the mesh map by the planners to share it with the controller
+ */
+struct VectorFieldSnapshot
+{
+  typedef std::shared_ptr<const VectorFieldSnapshot> ConstPtr;
+
+  //! version of the vector field, incremented each time a planner stores a new vector field
+  uint64_t version;
+
+  //! vector for each vertex pointing along the planned path
+  lvr2::DenseVertexMap<lvr2::BaseVector<float>> vector_map;
+
+  //! vertices which hold a vector, only these are reset when the vector map is recycled for a new vector field
+  std::vector<lvr2::VertexHandle> vertices;
+};
+
+} /* namespace mesh_map */
+
+#endif  // MESH_MAP__MAP_SNAPSHOT_H
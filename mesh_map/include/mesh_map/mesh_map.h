@@ -39,12 +39,16 @@
 #define MESH_MAP__MESH_MAP_H
 
 #include <atomic>
+#include <deque>
 #include <dynamic_reconfigure/server.h>
 #include <geometry_msgs/Point.h>
 #include <lvr2/geometry/BaseVector.hpp>
 #include <lvr2/io/HDF5IO.hpp>
 #include <mesh_map/MeshMapConfig.h>
 #include <mesh_map/abstract_layer.h>
+#include <mesh_map/compact_mesh.h>
+#include <mesh_map/face_bvh.h>
+#include <mesh_map/map_snapshot.h>
 #include <mesh_msgs/MeshVertexCosts.h>
 #include <mesh_msgs/MeshVertexColors.h>
 #include <mutex>
@@ -70,6 +74,38 @@ public:
    */
   bool readMap();
 
+  /**
+   * @brief Maps the binary map file into memory and restores the mesh, the normals, the edge distances and the compact
+   * mesh from it, instead of reading and processing the map file
+   * @return true if the binary map file exists, belongs to the current map file and mesh part and the rebuilt mesh has
+   * the original vertex, face and edge indices
+   */
+  bool readBinaryMap();
+
+  /**
+   * @brief Stores the mesh, the normals, the edge distances and the compact mesh in the binary map file
+   * @return true if the binary map file has been written successfully
+   */
+  bool writeBinaryMap();
+
+  /**
+   * @brief Updates the stamp of the map file in the loaded binary map file after the layers have been written to the
+   * map file, such that the binary map file stays valid for the next start
+   */
+  void restampBinaryMap();
+
+  /**
+   * @brief Loads the k-d tree index from the k-d tree file, if the file has been written for the current mesh
+   * @return true if the index has been loaded successfully
+   */
+  bool readKDTree();
+
+  /**
+   * @brief Stores the k-d tree index together with the mesh hash in the k-d tree file
+   * @return true if the k-d tree file has been written successfully
+   */
+  bool writeKDTree();
+
   /**
    * @brief Loads all configures layer plugins
    * @return true if the layer plugins have been load successfully.
@@ -89,6 +125,15 @@ public:
    */
   lvr2::OptionalVertexHandle getNearestVertexHandle(const mesh_map::Vector& pos);
 
+  /**
+   * @brief Searches the closest vertices of many positions at once. The positions are sorted spatially and the k-d
+   * tree is queried in parallel.
+   * @param positions The query positions
+   * @param vertices The closest vertex of each position
+   */
+  void getNearestVertexHandles(const std::vector<mesh_map::Vector>& positions,
+                               std::vector<lvr2::OptionalVertexHandle>& vertices);
+
   /**
    * @brief return true if the given position lies inside the triangle with respect to the given maximum distance.
    * @param pos The query position
@@ -107,14 +152,37 @@ public:
   lvr2::OptionalFaceHandle getContainingFace(Vector& position, const float& max_dist);
 
   /**
-   * @brief Searches for a triangle which contains the given position with respect to the maximum distance
+   * @brief Searches for the triangle closest to the given position with respect to the maximum distance
    * @param position The query position
    * @param max_dist The maximum distance to the triangle
-   * @return optional tuple of the corresponding triangle, the triangle's vertices, and barycentric coordinates, if a corresponding triangle has been found.
+   * @return optional tuple of the corresponding triangle, the triangle's vertices, and barycentric coordinates of the closest point on the triangle, if a corresponding triangle has been found.
    */
   boost::optional<std::tuple<lvr2::FaceHandle, std::array<mesh_map::Vector, 3>,
     std::array<float, 3>>> searchContainingFace(Vector& position, const float& max_dist);
 
+  /**
+   * @brief Searches for the triangles closest to many positions at once, e.g. for all poses of a path. The positions
+   * are sorted spatially and processed in parallel.
+   * @param positions The query positions
+   * @param max_dist The maximum distance to the triangles
+   * @param faces The closest triangle of each position, invalid if no triangle is within the maximum distance
+   * @param barycentric_coords The barycentric coordinates of the closest point on the triangle of each position
+   * @param distances The distance of each position to its closest triangle
+   */
+  void searchContainingFaces(const std::vector<Vector>& positions, const float& max_dist,
+                             std::vector<lvr2::OptionalFaceHandle>& faces,
+                             std::vector<std::array<float, 3>>& barycentric_coords, std::vector<float>& distances);
+
+  /**
+   * @brief Searches for the first triangle hit by the given ray
+   * @param origin The ray origin
+   * @param direction The ray direction
+   * @param max_dist The maximum ray parameter, in multiples of the direction
+   * @return optional tuple of the hit triangle, the triangle's vertices, and barycentric coordinates of the intersection point, if the ray hits the mesh.
+   */
+  boost::optional<std::tuple<lvr2::FaceHandle, std::array<mesh_map::Vector, 3>,
+    std::array<float, 3>>> searchRayIntersection(const Vector& origin, const Vector& direction, const float& max_dist);
+
   /**
    * @brief reconfigure callback function which is called if a dynamic reconfiguration were triggered.
    */
@@ -125,6 +193,12 @@ public:
    */
   void combineVertexCosts();
 
+  /**
+   * @brief Updates the combined costs of the given vertices and the weights of their incident edges
+   * @param dirty_vertices The vertices whose layer costs or lethal state changed
+   */
+  void combineVertexCosts(std::vector<lvr2::VertexHandle> dirty_vertices);
+
   /**
    * @brief Computes contours
    * @param contours the vector to bo filled with contours
@@ -223,7 +297,19 @@ public:
                        const std::array<float, 3>& barycentric_coords);
 
   /**
-   * Computes the cost value for the given triangle's vertices and barycentric coordinates while using the combined cost map
+   * Computes the cost value for the given triangle's vertices and barycentric coordinates while using the costs of a
+   * cost snapshot
+   * @param costs The vertex costs of the cost snapshot to use
+   * @param vertices The triangles vertices
+   * @param barycentric_coords The barycentric coordinates of the query position.
+   * @return A cost value for the given barycentric coordinates.
+   */
+  float costAtPosition(const SharedVertexCosts& costs, const std::array<lvr2::VertexHandle, 3>& vertices,
+                       const std::array<float, 3>& barycentric_coords);
+
+  /**
+   * Computes the cost value for the given triangle's vertices and barycentric coordinates while using the current cost
+   * snapshot
    * @param vertices The triangles vertices
    * @param barycentric_coords The barycentric coordinates of the query position.
    * @return A cost value for the given barycentric coordinates.
@@ -255,12 +341,13 @@ public:
   bool resetLayers();
 
   /**
-   * @brief Returns the stored vector map
+   * @brief Returns the current snapshot of the stored vector field. The snapshot stays valid and unchanged as long as
+   * the returned pointer is held, even if a planner stores a new vector field meanwhile.
    */
-  const lvr2::DenseVertexMap<mesh_map::Vector>& getVectorMap()
+  VectorFieldSnapshot::ConstPtr vectorField()
   {
-    return vector_map;
-  };
+    return std::atomic_load(&vector_field_ptr);
+  }
 
   /**
    * @brief Returns the stored mesh
@@ -271,7 +358,18 @@ public:
   }
 
   /**
-   * @brief Returns the stored combined costs
+   * @brief Returns the current snapshot of the combined costs and edge weights. The snapshot stays valid and
+   * unchanged as long as the returned pointer is held, even if the layer costs are combined meanwhile. Planners and
+   * controllers pin one snapshot per planning or control cycle.
+   */
+  CostSnapshot::ConstPtr costSnapshot()
+  {
+    return std::atomic_load(&cost_snapshot_ptr);
+  }
+
+  /**
+   * @brief Returns the stored combined costs, which are modified in place when the layers change. Only safe to use
+   * from the layer callbacks; other threads use costSnapshot().
    */
   const lvr2::DenseVertexMap<float>& vertexCosts()
   {
@@ -286,6 +384,14 @@ public:
     return global_frame;
   }
 
+  /**
+   * @brief Returns the path of the map file the mesh has been loaded from, next to which derived data is stored
+   */
+  const std::string& mapFile()
+  {
+    return mesh_file;
+  }
+
   /**
    * @brief Returns the mesh's triangle normals
    */
@@ -303,7 +409,8 @@ public:
   }
 
   /**
-   * @brief Returns the mesh's edge weights
+   * @brief Returns the mesh's edge weights, which are modified in place when the layers change. Only safe to use from
+   * the layer callbacks; other threads use costSnapshot().
    */
   const lvr2::DenseEdgeMap<float>& edgeWeights()
   {
@@ -318,6 +425,48 @@ public:
     return edge_distances;
   }
 
+  /**
+   * @brief Returns the compact CSR snapshot of the mesh connectivity, edge distances and edge weights
+   */
+  const CompactMesh& compactMesh()
+  {
+    return *compact_mesh_ptr;
+  }
+
+  /**
+   * @brief Returns the hash of the mesh geometry, which identifies cached layer data of this mesh
+   */
+  uint64_t meshHash()
+  {
+    return mesh_hash;
+  }
+
+  /**
+   * @brief Returns the version of the combined costs, which is incremented each time the layer costs are combined
+   */
+  uint64_t costsVersion();
+
+  /**
+   * @brief Collects the vertices whose combined costs changed after the given costs version
+   * @param version The costs version the caller is up to date with
+   * @param vertices The changed vertices, each vertex is contained once
+   * @param current_version The costs version up to which the changes have been collected
+   * @return false if the changes are no longer recorded or too many costs changed at once, i.e., all vertices have to
+   * be treated as changed; else true
+   */
+  bool changedVerticesSince(const uint64_t version, std::vector<lvr2::VertexHandle>& vertices,
+                            uint64_t& current_version);
+
+  /**
+   * @brief Collects the edges whose weights changed after the given costs version
+   * @param version The costs version the caller is up to date with
+   * @param edges The changed edges, each edge is contained once
+   * @param current_version The costs version up to which the changes have been collected
+   * @return false if the changes are no longer recorded or too many costs changed at once, i.e., all edges have to be
+   * treated as changed; else true
+   */
+  bool changedEdgesSince(const uint64_t version, std::vector<lvr2::EdgeHandle>& edges, uint64_t& current_version);
+
   /**
    * Searches in the surrounding triangles for the triangle in which the given
    * position lies.
@@ -343,9 +492,50 @@ public:
   bool meshAhead(Vector& vec, lvr2::FaceHandle& face, const float& step_width);
 
   /**
-   * @brief Stores the given vector map
+   * Finds the next position given a position vector and its corresponding face handle by following the given vector
+   * field instead of the latest one of the map, e.g. the vector field of a concurrent planning request
+   * @param vec   direction vector from which the next step vector is calculated
+   * @param face  face of the direction vector
+   * @param step_width The step length to go ahead on the mesh surface
+   * @param vector_field The vector field to follow
+   * @return      new vector (also updates the ahead_face handle to correspond
+   * to the new vector)
+   */
+  bool meshAhead(Vector& vec, lvr2::FaceHandle& face, const float& step_width,
+                 const VectorFieldSnapshot& vector_field);
+
+  /**
+   * @brief Delivers an empty vector map for a new vector field. The vector maps of released vector field snapshots are
+   * recycled with only their set vectors reset, so that a plan neither allocates nor initializes a map of mesh size.
+   * @return the empty vector map
+   */
+  lvr2::DenseVertexMap<mesh_map::Vector> acquireVectorMap();
+
+  /**
+   * @brief Stores the given vector map as a new vector field snapshot. The map is moved into the snapshot, such that
+   * handing a vector field from the planner to the controller does not copy it.
+   * @param vector_map The vector map, moved into the snapshot
+   * @param vertices The vertices which hold a vector in the vector map
+   * @return the new vector field snapshot
+   */
+  VectorFieldSnapshot::ConstPtr setVectorMap(lvr2::DenseVertexMap<mesh_map::Vector>&& vector_map,
+                                             std::vector<lvr2::VertexHandle>&& vertices);
+
+  /**
+   * @brief Creates a new vector field snapshot from the given vector map without storing it as the latest vector
+   * field of the map, e.g. for batch requests which must not change the vector field the controller follows.
+   * @param vector_map The vector map, moved into the snapshot
+   * @param vertices The vertices which hold a vector in the vector map
+   * @return the new vector field snapshot
    */
-  void setVectorMap(lvr2::DenseVertexMap<mesh_map::Vector>& vector_map);
+  VectorFieldSnapshot::ConstPtr createVectorField(lvr2::DenseVertexMap<mesh_map::Vector>&& vector_map,
+                                                  std::vector<lvr2::VertexHandle>&& vertices);
+
+  /**
+   * @brief Stores an existing vector field snapshot, e.g. the vector field of a cached potential field
+   * @param vector_field The vector field snapshot
+   */
+  void setVectorField(const VectorFieldSnapshot::ConstPtr& vector_field);
 
   /**
    * @brief Publishes a position as marker. Used for debug purposes.
@@ -444,11 +634,35 @@ private:
   std::string mesh_file;
   std::string mesh_part;
 
+  //! optional flat binary copy of the map file, which is mapped into memory for a fast startup
+  std::string binary_map_file;
+
+  //! file storing the k-d tree index of the mesh, empty to rebuild the index on every start
+  std::string kd_tree_file;
+
+  //! FNV-1a hash of the vertex positions and the face vertex indices
+  uint64_t mesh_hash;
+
   //! combined layer costs
   lvr2::DenseVertexMap<float> vertex_costs;
 
-  //! stored vector map to share between planner and controller
-  lvr2::DenseVertexMap<mesh_map::Vector> vector_map;
+  //! snapshot of the combined costs for the planners and controllers, only accessed with atomic loads and stores
+  CostSnapshot::ConstPtr cost_snapshot_ptr;
+
+  //! snapshot of the stored vector field to share between planner and controller, only accessed with atomic loads
+  //! and stores
+  VectorFieldSnapshot::ConstPtr vector_field_ptr;
+
+  //! version of the latest vector field stored by a planner
+  std::atomic<uint64_t> vector_field_version;
+
+  //! vector maps of released vector field snapshots, shared with the snapshots which return their maps on release
+  struct VectorMapPool
+  {
+    std::mutex mutex;
+    std::vector<lvr2::DenseVertexMap<Vector>> vector_maps;
+  };
+  std::shared_ptr<VectorMapPool> vector_map_pool;
 
   //! vertex distance for each edge
   lvr2::DenseEdgeMap<float> edge_distances;
@@ -456,6 +670,42 @@ private:
   //! edge weights
   lvr2::DenseEdgeMap<float> edge_weights;
 
+  //! compact CSR snapshot of the mesh connectivity for the planners
+  CompactMesh::Ptr compact_mesh_ptr;
+
+  //! vertices and edges whose costs changed with one combination of the layer costs
+  struct CostChanges
+  {
+    uint64_t version;
+    std::vector<lvr2::VertexHandle> vertices;
+    std::vector<lvr2::EdgeHandle> edges;
+  };
+
+  //! maximum number of cost changes kept for incremental updates
+  static constexpr size_t MAX_COST_CHANGES = 32;
+
+  //! recent cost changes ordered by ascending version
+  std::deque<CostChanges> cost_changes;
+
+  //! version of the combined costs
+  uint64_t costs_version;
+
+  //! mutex to guard the cost changes and the costs version
+  std::mutex cost_changes_mtx;
+
+  /**
+   * @brief Appends the given changes to the recorded cost changes and increments the costs version
+   * @param changes The changed vertices and edges of the latest combination of the layer costs, receives the version
+   */
+  void recordCostChanges(CostChanges& changes);
+
+  /**
+   * @brief Publishes the current combined costs and edge weights as new cost snapshot, copying only the blocks of the
+   * previous snapshot which contain changed vertices or edges
+   * @param changes The recorded changes of the latest combination of the layer costs
+   */
+  void publishCostSnapshot(const CostChanges& changes);
+
   //! triangle normals
   lvr2::DenseFaceMap<Normal> face_normals;
 
@@ -504,16 +754,19 @@ private:
   //! layer mutex to handle simultaneous layer changes
   std::mutex layer_mtx;
 
-  //! k-d tree type for 3D with a custom mesh adaptor
+  //! k-d tree type for 3D with a packed mesh adaptor
   typedef nanoflann::KDTreeSingleIndexAdaptor<
-      nanoflann::L2_Simple_Adaptor<float, NanoFlannMeshAdaptor>,
-      NanoFlannMeshAdaptor, 3> KDTree;
+      nanoflann::L2_Simple_Adaptor<float, NanoFlannPackedMeshAdaptor>,
+      NanoFlannPackedMeshAdaptor, 3> KDTree;
 
-  //! k-d tree nano flann mesh adaptor to access mesh data
-  std::unique_ptr<NanoFlannMeshAdaptor> adaptor_ptr;
+  //! k-d tree nano flann adaptor holding the packed vertex positions of the mesh
+  std::unique_ptr<NanoFlannPackedMeshAdaptor> adaptor_ptr;
 
   //! k-d tree to query mesh vertices in logarithmic time
   std::unique_ptr<KDTree> kd_tree_ptr;
+
+  //! bounding volume hierarchy to query the closest or intersected faces in logarithmic time
+  FaceBVH face_bvh;
 };
 
 } /* namespace mesh_map */
@@ -38,7 +38,11 @@
 #ifndef MESH_MAP__NANOFLANN_MESH_ADAPTOR_H
 #define MESH_MAP__NANOFLANN_MESH_ADAPTOR_H
 
+#include <algorithm>
+#include <array>
+#include <limits>
 #include <lvr2/geometry/HalfEdgeMesh.hpp>
+#include <vector>
 #include "nanoflann.hpp"
 
 namespace mesh_map{
@@ -68,6 +72,75 @@ struct NanoFlannMeshAdaptor
   bool kdtree_get_bbox(BBOX& /*bb*/) const { return false; }
 
 }; // end of PointCloudAdaptor
+
+/**
+ * @brief k-d tree adaptor over a packed copy of the positions of all existing vertices. The coordinates are stored
+ * in one contiguous array per dimension, deleted vertices are skipped, and the point index is mapped back to the
+ * vertex index. The bounding box is computed once, so nanoflann does not scan the points for it.
+ */
+struct NanoFlannPackedMeshAdaptor
+{
+  //! x, y and z coordinates of the packed points
+  std::array<std::vector<float>, 3> coordinates;
+
+  //! vertex index of each packed point
+  std::vector<lvr2::Index> vertex_indices;
+
+  //! minimum and maximum coordinate per dimension
+  std::array<float, 3> bb_min, bb_max;
+
+  /// The constructor that copies the vertex positions of the mesh
+  NanoFlannPackedMeshAdaptor(const lvr2::HalfEdgeMesh<lvr2::BaseVector<float>> &mesh)
+  {
+    bb_min.fill(std::numeric_limits<float>::max());
+    bb_max.fill(std::numeric_limits<float>::lowest());
+    for (auto& values : coordinates)
+    {
+      values.reserve(mesh.numVertices());
+    }
+    vertex_indices.reserve(mesh.numVertices());
+
+    for (auto vH : mesh.vertices())
+    {
+      const lvr2::BaseVector<float>& vertex = mesh.getVertexPosition(vH);
+      const std::array<float, 3> point = { vertex.x, vertex.y, vertex.z };
+      for (size_t dim = 0; dim < 3; dim++)
+      {
+        coordinates[dim].push_back(point[dim]);
+        bb_min[dim] = std::min(bb_min[dim], point[dim]);
+        bb_max[dim] = std::max(bb_max[dim], point[dim]);
+      }
+      vertex_indices.push_back(vH.idx());
+    }
+  }
+
+  inline size_t kdtree_get_point_count() const { return vertex_indices.size(); }
+
+  inline float kdtree_get_pt(const size_t idx, const size_t dim) const
+  {
+    return coordinates[dim][idx];
+  }
+
+  template <class BBOX>
+  bool kdtree_get_bbox(BBOX& bb) const
+  {
+    if (vertex_indices.empty())
+      return false;
+
+    for (size_t dim = 0; dim < 3; dim++)
+    {
+      bb[dim].low = bb_min[dim];
+      bb[dim].high = bb_max[dim];
+    }
+    return true;
+  }
+
+  /// Maps the index of a packed point back to its vertex handle
+  inline lvr2::VertexHandle vertexHandle(const size_t idx) const
+  {
+    return lvr2::VertexHandle(vertex_indices[idx]);
+  }
+};
 }
 
 #endif /* MESH_MAP__NANOFLANN_MESH_ADAPTOR_H */
@@ -0,0 +1,190 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+#ifndef MESH_MAP__PLANNER_WORKSPACE_H
+#define MESH_MAP__PLANNER_WORKSPACE_H
+
+#include <cstdint>
+#include <vector>
+
+#include <lvr2/attrmaps/AttrMaps.hpp>
+#include <lvr2/geometry/BaseVector.hpp>
+#include <lvr2/geometry/HalfEdgeMesh.hpp>
+#include <lvr2/geometry/Handles.hpp>
+
+namespace mesh_map
+{
+/**
+ * @brief Vertex flags which are cleared in constant time by incrementing a generation. A flag is set if its stamp
+ * equals the current generation. The stamps are only rewritten if the size changes or the generation wraps around.
+ */
+class StampedVertexFlags
+{
+public:
+  /**
+   * @brief Constructs an empty set of flags
+   */
+  StampedVertexFlags() : generation(1)
+  {
+  }
+
+  /**
+   * @brief Clears all flags and resizes them to the given number of vertices
+   * @param size The size of the vertex index range
+   */
+  void reset(const size_t size);
+
+  /**
+   * @brief Returns true if the flag of the vertex is set, false for vertices outside of the index range
+   */
+  inline bool operator[](const lvr2::VertexHandle& vH) const
+  {
+    return vH.idx() < stamps.size() && stamps[vH.idx()] == generation;
+  }
+
+  /**
+   * @brief Sets the flag of the vertex
+   */
+  inline void set(const lvr2::VertexHandle& vH)
+  {
+    stamps[vH.idx()] = generation;
+  }
+
+  /**
+   * @brief Clears the flag of the vertex
+   */
+  inline void unset(const lvr2::VertexHandle& vH)
+  {
+    stamps[vH.idx()] = 0;
+  }
+
+  /**
+   * @brief Returns the size of the vertex index range
+   */
+  inline size_t size() const
+  {
+    return stamps.size();
+  }
+
+private:
+  //! generation in which each flag has been set last
+  std::vector<uint32_t> stamps;
+
+  //! current generation, never zero
+  uint32_t generation;
+};
+
+/**
+ * @brief Reusable workspace of a graph search or wave front propagation. It records the vertices whose distance and
+ * predecessor are written during a plan, such that the next plan only restores those instead of initializing the
+ * maps of the whole mesh. The fixed set is cleared in constant time by its generation.
+ */
+class PlannerWorkspace
+{
+public:
+  /**
+   * @brief Constructs an empty workspace
+   */
+  PlannerWorkspace();
+
+  /**
+   * @brief Prepares the maps for a new plan. The distances of all vertices are infinity and each vertex is its own
+   * predecessor afterwards. Only the vertices touched since the last reset are restored, unless the maps are not the
+   * ones of the last reset, have been invalidated or do not cover the mesh.
+   * @param mesh The mesh to plan on
+   * @param distances The distance map of the plan
+   * @param predecessors The predecessor map of the plan
+   */
+  void reset(const lvr2::HalfEdgeMesh<lvr2::BaseVector<float>>& mesh, lvr2::DenseVertexMap<float>& distances,
+             lvr2::DenseVertexMap<lvr2::VertexHandle>& predecessors);
+
+  /**
+   * @brief Records that the distance or predecessor of the vertex is going to be written
+   */
+  inline void touch(const lvr2::VertexHandle& vH)
+  {
+    if (!touched_flags[vH])
+    {
+      touched_flags.set(vH);
+      touched.push_back(vH);
+    }
+  }
+
+  /**
+   * @brief Marks the maps as written outside of the workspace, the next reset initializes them completely
+   */
+  void invalidate();
+
+  /**
+   * @brief Returns the vertices touched since the last reset
+   */
+  const std::vector<lvr2::VertexHandle>& touchedVertices() const
+  {
+    return touched;
+  }
+
+  /**
+   * @brief Returns the vertices whose distance is final, cleared by each reset
+   */
+  StampedVertexFlags& fixed()
+  {
+    return fixed_flags;
+  }
+
+private:
+  //! true if only the touched vertices differ from the initial values
+  bool valid;
+
+  //! distance map of the last reset
+  const lvr2::DenseVertexMap<float>* last_distances;
+
+  //! predecessor map of the last reset
+  const lvr2::DenseVertexMap<lvr2::VertexHandle>* last_predecessors;
+
+  //! vertices touched since the last reset
+  std::vector<lvr2::VertexHandle> touched;
+
+  //! flags of the touched vertices
+  StampedVertexFlags touched_flags;
+
+  //! vertices whose distance is final
+  StampedVertexFlags fixed_flags;
+};
+
+} /* namespace mesh_map */
+
+#endif  // MESH_MAP__PLANNER_WORKSPACE_H
@@ -0,0 +1,197 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+#ifndef MESH_MAP__POTENTIAL_FIELD_CACHE_H
+#define MESH_MAP__POTENTIAL_FIELD_CACHE_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <lvr2/attrmaps/AttrMaps.hpp>
+#include <lvr2/geometry/Handles.hpp>
+#include <mesh_map/map_snapshot.h>
+#include <mesh_map/planner_workspace.h>
+#include <mesh_map/util.h>
+
+namespace mesh_map
+{
+/**
+ * @brief Potential field of a completed propagation seeded at a goal. The potential of every settled vertex is final,
+ * such that a plan to the same goal can be backtracked from any start whose vertices have been settled. Only the
+ * settled vertices are stored, the planners backtrack and publish directly from the cached field.
+ */
+struct PotentialField
+{
+  typedef std::shared_ptr<const PotentialField> ConstPtr;
+
+  //! seed position of the propagation, i.e. the goal of the plans
+  Vector seed;
+
+  //! index of the face or vertex the propagation has been seeded at
+  lvr2::Index seed_index;
+
+  //! costs version of the map the propagation used
+  uint64_t costs_version;
+
+  //! cost limit the propagation used
+  float cost_limit;
+
+  //! distances of the settled vertices to the seed
+  lvr2::SparseVertexMap<float> potential;
+
+  //! predecessor of each settled vertex towards the seed
+  lvr2::SparseVertexMap<lvr2::VertexHandle> predecessors;
+
+  //! vector field pointing towards the seed
+  VectorFieldSnapshot::ConstPtr vector_field;
+
+  /**
+   * @brief Stores the potential and the predecessors of the settled vertices of a propagation
+   * @param vertices The vertices touched by the propagation, which include all settled vertices
+   * @param distances The distances of the propagation to the seed
+   * @param predecessors The predecessors of the propagation towards the seed
+   * @param settled The vertices whose potential is final
+   */
+  void storeSettled(const std::vector<lvr2::VertexHandle>& vertices, const lvr2::DenseVertexMap<float>& distances,
+                    const lvr2::DenseVertexMap<lvr2::VertexHandle>& predecessors, const StampedVertexFlags& settled)
+  {
+    for (const lvr2::VertexHandle& vH : vertices)
+    {
+      if (settled[vH])
+      {
+        potential.insert(vH, distances[vH]);
+        this->predecessors.insert(vH, predecessors[vH]);
+      }
+    }
+  }
+
+  /**
+   * @brief Checks whether plans can be backtracked from all of the given vertices
+   * @param vertices The vertices of the start face or the start vertex
+   * @return true if all vertices have been settled
+   */
+  template <typename VertexContainer>
+  bool covers(const VertexContainer& vertices) const
+  {
+    for (const lvr2::VertexHandle& vH : vertices)
+    {
+      if (!potential.containsKey(vH))
+        return false;
+    }
+    return true;
+  }
+};
+
+/**
+ * @brief Least recently used cache of goal-rooted potential fields, keyed by the seed and the costs version of the
+ * map. Entries of outdated costs versions are dropped on lookup, since they can never be used again. All methods are
+ * thread safe, such that concurrent planning requests can share the cache.
+ */
+class PotentialFieldCache
+{
+public:
+  /**
+   * @brief Constructs an empty cache
+   * @param capacity The maximum number of potential fields, zero disables the cache
+   */
+  PotentialFieldCache(const size_t capacity = 0);
+
+  /**
+   * @brief Sets the maximum number of potential fields and evicts the least recently used ones exceeding it
+   * @param capacity The maximum number of potential fields, zero disables the cache
+   */
+  void setCapacity(const size_t capacity);
+
+  /**
+   * @brief Searches for a potential field with the given seed and marks it as most recently used
+   * @param seed_index The index of the face or vertex the propagation is seeded at
+   * @param seed The seed position
+   * @param seed_tolerance The maximum distance between the given and the cached seed position
+   * @param costs_version The costs version the request plans on, fields of other costs versions are not found
+   * @param cost_limit The current cost limit of the planner
+   * @return the cached potential field, or an empty pointer if there is none
+   */
+  PotentialField::ConstPtr find(const lvr2::Index seed_index, const Vector& seed, const float seed_tolerance,
+                                const uint64_t costs_version, const float cost_limit);
+
+  /**
+   * @brief Inserts the given potential field as most recently used, replacing a cached field with the same seed. Fields
+   * of costs older than the newest seen costs version are not inserted.
+   * @param field The potential field to insert
+   */
+  void insert(const PotentialField::ConstPtr& field);
+
+  /**
+   * @brief Removes all potential fields
+   */
+  void clear();
+
+  /**
+   * @brief Returns the number of cached potential fields
+   */
+  size_t size() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return fields.size();
+  }
+
+private:
+  /**
+   * @brief Updates the newest seen costs version and removes the fields of older costs
+   * @param costs_version The costs version of a request or an inserted field
+   */
+  void evictOutdated(const uint64_t costs_version);
+
+  //! guards the capacity and the cached fields
+  mutable std::mutex mutex;
+
+  //! maximum number of potential fields
+  size_t capacity;
+
+  //! cached potential fields, the most recently used one first
+  std::list<PotentialField::ConstPtr> fields;
+
+  //! newest costs version of a request or an inserted field
+  uint64_t newest_costs_version;
+};
+
+} /* namespace mesh_map */
+
+#endif  // MESH_MAP__POTENTIAL_FIELD_CACHE_H
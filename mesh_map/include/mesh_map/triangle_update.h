@@ -0,0 +1,135 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+#ifndef MESH_MAP__TRIANGLE_UPDATE_H
+#define MESH_MAP__TRIANGLE_UPDATE_H
+
+#include <algorithm>
+#include <cmath>
+
+#include <lvr2/geometry/Handles.hpp>
+#include <mesh_map/face_geometry.h>
+#include <ros/console.h>
+
+namespace mesh_map
+{
+/**
+ * @brief Result of a triangle update, the new distance of the updated vertex and the direction towards the seed
+ */
+struct TriangleUpdate
+{
+  //! new distance of the updated vertex
+  float distance;
+
+  //! vertex of the triangle whose edge is rotated to point towards the seed
+  lvr2::VertexHandle predecessor;
+
+  //! rotation angle of the predecessor edge
+  float direction;
+};
+
+/**
+ * Eikonal update step of the third vertex of a triangle using the Law of Cosines to determine if the direction vector
+ * is cutting the triangle. The triangle geometry is read from the precomputed corner and the inner angles are
+ * compared by their cosines, such that only a cutting update evaluates an arccosine. The update does not modify any
+ * map, such that it can be evaluated concurrently.
+ * @param u1 The distance of the first vertex
+ * @param u2 The distance of the second vertex
+ * @param u3 The current distance of the third vertex
+ * @param corner The geometry of the triangle seen from the third vertex
+ * @param v1 The first vertex of the triangle
+ * @param v2 The second vertex of the triangle
+ * @param update The new distance and direction of the third vertex
+ * @return true if the newly computed distance is shorter than u3
+ */
+inline bool triangleUpdate(const float u1, const float u2, const float u3, const TriangleCorner& corner,
+                           const lvr2::VertexHandle& v1, const lvr2::VertexHandle& v2, TriangleUpdate& update)
+{
+  const float a = corner.a;
+  const float b = corner.b;
+
+  const float u1_sq = u1 * u1;
+  const float u2_sq = u2 * u2;
+
+  const float sx = (corner.c * corner.c + u1_sq - u2_sq) * corner.inv_two_c;
+  const float sy = -std::sqrt(std::max(u1_sq - sx * sx, 0.0f));
+
+  const float dy = corner.hc - sy;
+  const float dx = corner.p - sx;
+
+  const float u3tmp_sq = dx * dx + dy * dy;
+  float u3tmp = std::sqrt(u3tmp_sq);
+
+  if (!std::isfinite(u3tmp))
+  {
+    ROS_ERROR_STREAM("u3 tmp is not finite!");
+  }
+  if (!(u3tmp < u3))
+    return false;
+
+  const float t1a = (u3tmp_sq + b * b - u1_sq) / (2 * u3tmp * b);
+  const float t2a = (a * a + u3tmp_sq - u2_sq) / (2 * a * u3tmp);
+
+  // corner cases: side b + u1 ~= u3 or side a + u2 ~= u3
+  const bool corner_case = std::fabs(t1a) > 1 || std::fabs(t2a) > 1;
+
+  // the arccosine is decreasing, a smaller angle has a larger cosine
+  if (!corner_case && t1a > corner.cos_theta0 && t2a > corner.cos_theta0)
+  {
+    // the direction vector cuts the triangle
+    update.distance = u3tmp;
+    update.predecessor = t1a > t2a ? v1 : v2;
+    update.direction = t1a > t2a ? std::acos(t1a) : -std::acos(t2a);
+    return true;
+  }
+
+  // the direction vector runs along one of the edges
+  const bool along_b = std::fabs(t1a) > 1 || (std::fabs(t2a) <= 1 && t1a > t2a);
+  u3tmp = along_b ? u1 + b : u2 + a;
+  if (u3tmp < u3)
+  {
+    update.distance = u3tmp;
+    update.predecessor = along_b ? v1 : v2;
+    update.direction = 0;
+    return true;
+  }
+  return false;
+}
+
+} /* namespace mesh_map */
+
+#endif  // MESH_MAP__TRIANGLE_UPDATE_H
@@ -42,6 +42,7 @@
 #include <geometry_msgs/Pose.h>
 #include <lvr2/geometry/Handles.hpp>
 #include <lvr2/attrmaps/AttrMaps.hpp>
+#include <lvr2/io/AttributeMeshIOBase.hpp>
 #include <lvr2/geometry/BaseVector.hpp>
 #include <lvr2/geometry/Normal.hpp>
 #include <std_msgs/ColorRGBA.h>
@@ -55,6 +56,57 @@ typedef lvr2::Normal<float> Normal;
 //! use vectors with datatype folat
 typedef lvr2::BaseVector<float> Vector;
 
+//! offset basis of the 64 bit FNV-1a hash
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+
+/**
+ * @brief Continues a 64 bit FNV-1a hash with the given bytes
+ * @param data The bytes to hash
+ * @param size The number of bytes
+ * @param hash The hash to continue, FNV_OFFSET_BASIS to start a new hash
+ * @return The updated hash
+ */
+uint64_t fnv1a(const void* data, const size_t size, uint64_t hash = FNV_OFFSET_BASIS);
+
+/**
+ * @brief Computes the key of a cached layer. Cached data is only used again for the same data hash and the same layer
+ * parameters.
+ * @param hash The hash of the data the layer is computed from, e.g. the mesh hash
+ * @param params The layer parameters which influence the layer costs
+ * @return The cache key
+ */
+uint64_t layerCacheKey(const uint64_t hash, const std::vector<double>& params);
+
+/**
+ * @brief Reads a cached layer from the map file. Each layer is cached under its attribute name together with the key
+ * it has been computed for, so the entry of a new key replaces the previous one.
+ * @param mesh_io The map file
+ * @param name The attribute name of the layer, e.g. "roughness"
+ * @param key The cache key of the requested layer
+ * @param values The read layer values
+ * @return true, if the layer has been cached with the given key
+ */
+bool readLayerCache(lvr2::AttributeMeshIOBase& mesh_io, const std::string& name, const uint64_t key,
+                    lvr2::DenseVertexMap<float>& values);
+
+/**
+ * @brief Writes a layer to the map file, replacing the previously cached values and key of the layer
+ * @param mesh_io The map file
+ * @param name The attribute name of the layer, e.g. "roughness"
+ * @param key The cache key of the layer values
+ * @param values The layer values
+ * @return true, if the layer has been written
+ */
+bool writeLayerCache(lvr2::AttributeMeshIOBase& mesh_io, const std::string& name, const uint64_t key,
+                     const lvr2::DenseVertexMap<float>& values);
+
+/**
+ * @brief Computes the order of the given points along the Morton (Z-order) curve over their bounding box, so that
+ * consecutive points of the order are close to each other
+ * @param points The points to order
+ * @param order The indices of the points in Morton order
+ */
+void mortonOrder(const std::vector<Vector>& points, std::vector<size_t>& order);
 
 /**
  * @brief Function to build std_msgs color instances
@@ -0,0 +1,303 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+#ifndef MESH_MAP__VERTEX_PRIORITY_QUEUE_H
+#define MESH_MAP__VERTEX_PRIORITY_QUEUE_H
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <lvr2/geometry/Handles.hpp>
+#include <lvr2/util/Meap.hpp>
+#include <ros/node_handle.h>
+
+namespace mesh_map
+{
+/**
+ * @brief Abstract min priority queue of vertex handles with float keys. It is used by the wave front propagations
+ * of the planners and layers. Inserting a vertex which is already queued updates its key.
+ */
+class VertexPriorityQueue
+{
+public:
+  typedef std::unique_ptr<VertexPriorityQueue> Ptr;
+
+  virtual ~VertexPriorityQueue(){};
+
+  /**
+   * @brief Inserts the vertex with the given key, or updates the key if the vertex is already queued
+   * @param vH The vertex to insert
+   * @param key The key, i.e. the distance of the vertex
+   */
+  virtual void insert(const lvr2::VertexHandle& vH, const float& key) = 0;
+
+  /**
+   * @brief Removes the vertex with the smallest key from the queue and returns it
+   */
+  virtual lvr2::VertexHandle popMin() = 0;
+
+  /**
+   * @brief Returns true if no vertex is queued
+   */
+  virtual bool isEmpty() const = 0;
+
+  /**
+   * @brief Returns true if the given vertex is currently queued
+   */
+  virtual bool containsKey(const lvr2::VertexHandle& vH) const = 0;
+
+  /**
+   * @brief Removes all queued vertices
+   */
+  virtual void clear() = 0;
+};
+
+/**
+ * @brief Index addressed 4-ary min heap. The position of each vertex within the heap is stored in a dense array which
+ * is indexed by the vertex index. This provides decrease-key without any hashing, and the four children of a node
+ * share one cache line.
+ */
+class DaryHeap : public VertexPriorityQueue
+{
+public:
+  /**
+   * @brief Creates a heap for vertex indices in [0, num_vertices)
+   */
+  DaryHeap(const lvr2::Index num_vertices);
+
+  virtual void insert(const lvr2::VertexHandle& vH, const float& key);
+
+  virtual lvr2::VertexHandle popMin();
+
+  virtual bool isEmpty() const
+  {
+    return heap.empty();
+  }
+
+  virtual bool containsKey(const lvr2::VertexHandle& vH) const
+  {
+    return positions[vH.idx()] != NOT_IN_HEAP;
+  }
+
+  virtual void clear();
+
+private:
+  //! number of children per heap node
+  static constexpr size_t ARITY = 4;
+
+  //! position value of vertices which are not in the heap
+  static constexpr lvr2::Index NOT_IN_HEAP = std::numeric_limits<lvr2::Index>::max();
+
+  /**
+   * @brief Moves the entry at the given position upwards until the heap property holds
+   */
+  inline void siftUp(size_t pos);
+
+  /**
+   * @brief Moves the entry at the given position downwards until the heap property holds
+   */
+  inline void siftDown(size_t pos);
+
+  //! heap entries of key and vertex index
+  std::vector<std::pair<float, lvr2::Index>> heap;
+
+  //! heap position for each vertex index
+  std::vector<lvr2::Index> positions;
+};
+
+/**
+ * @brief Monotone radix heap for non-negative float keys. The keys are mapped to their order preserving IEEE-754 bit
+ * patterns and distributed into 33 buckets by the highest bit in which they differ from the last extracted key. Each
+ * entry is moved to a lower bucket at most 32 times. Key updates insert a new entry, outdated entries are skipped
+ * lazily. The queue is monotone: keys smaller than the last extracted key are treated as equal to it.
+ */
+class RadixHeap : public VertexPriorityQueue
+{
+public:
+  /**
+   * @brief Creates a radix heap for vertex indices in [0, num_vertices)
+   */
+  RadixHeap(const lvr2::Index num_vertices);
+
+  virtual void insert(const lvr2::VertexHandle& vH, const float& key);
+
+  virtual lvr2::VertexHandle popMin();
+
+  virtual bool isEmpty() const
+  {
+    return num_queued == 0;
+  }
+
+  virtual bool containsKey(const lvr2::VertexHandle& vH) const
+  {
+    return queued[vH.idx()];
+  }
+
+  virtual void clear();
+
+private:
+  //! number of buckets, one for the last extracted key and one for each differing bit
+  static constexpr size_t NUM_BUCKETS = 33;
+
+  /**
+   * @brief Converts a non-negative float to its order preserving unsigned bit pattern
+   */
+  static inline uint32_t toBits(const float& key);
+
+  /**
+   * @brief Returns the bucket for the given key bit pattern with respect to the last extracted key
+   */
+  inline size_t bucketIndex(const uint32_t& bits) const;
+
+  //! bucket entry, outdated entries are dropped lazily
+  struct Entry
+  {
+    //! key bit pattern
+    uint32_t bits;
+    //! vertex index
+    lvr2::Index idx;
+    //! sequence number of the entry for its vertex
+    uint32_t sequence;
+  };
+
+  /**
+   * @brief Returns true if the entry is still the current entry of its vertex
+   */
+  inline bool isCurrent(const Entry& entry) const
+  {
+    // a vertex can be queued again with the key of one of its outdated entries, only the sequence number is unique
+    return queued[entry.idx] && sequences[entry.idx] == entry.sequence;
+  }
+
+  //! buckets of entries
+  std::array<std::vector<Entry>, NUM_BUCKETS> buckets;
+
+  //! current key bit pattern for each vertex index
+  std::vector<uint32_t> keys;
+
+  //! sequence number of the current entry for each vertex index
+  std::vector<uint32_t> sequences;
+
+  //! whether the vertex is currently queued for each vertex index
+  std::vector<bool> queued;
+
+  //! the last extracted key bit pattern
+  uint32_t last;
+
+  //! number of queued vertices
+  size_t num_queued;
+};
+
+/**
+ * @brief Priority queue backed by the hash map based lvr2::Meap, kept for comparison
+ */
+class MeapQueue : public VertexPriorityQueue
+{
+public:
+  MeapQueue(const lvr2::Index num_vertices){};
+
+  virtual void insert(const lvr2::VertexHandle& vH, const float& key)
+  {
+    meap.insert(vH, key);
+  }
+
+  virtual lvr2::VertexHandle popMin()
+  {
+    return meap.popMin().key();
+  }
+
+  virtual bool isEmpty() const
+  {
+    return meap.isEmpty();
+  }
+
+  virtual bool containsKey(const lvr2::VertexHandle& vH) const
+  {
+    return meap.containsKey(vH);
+  }
+
+  virtual void clear()
+  {
+    meap = lvr2::Meap<lvr2::VertexHandle, float>();
+  }
+
+private:
+  lvr2::Meap<lvr2::VertexHandle, float> meap;
+};
+
+/**
+ * @brief Available priority queue implementations
+ */
+enum PriorityQueueType
+{
+  DARY_HEAP,
+  RADIX_HEAP,
+  MEAP
+};
+
+/**
+ * @brief Parses the priority queue type from its parameter name, i.e. "dary_heap", "radix_heap" or "meap"
+ * @param name The parameter value
+ * @param type The parsed type
+ * @return true if the name corresponds to a priority queue type
+ */
+bool priorityQueueTypeFromString(const std::string& name, PriorityQueueType& type);
+
+/**
+ * @brief Reads the priority queue type from the "priority_queue" parameter of the given node handle. Unknown types
+ * are reported and replaced by the default type "dary_heap".
+ * @param private_nh The node handle of the planner or layer
+ * @return the configured priority queue type
+ */
+PriorityQueueType readPriorityQueueType(const ros::NodeHandle& private_nh);
+
+/**
+ * @brief Creates a vertex priority queue of the given type
+ * @param type The priority queue implementation to use
+ * @param num_vertices The size of the vertex index range, i.e. the mesh's next vertex index
+ * @return A pointer to the newly created priority queue
+ */
+VertexPriorityQueue::Ptr createVertexPriorityQueue(const PriorityQueueType& type, const lvr2::Index num_vertices);
+
+} /* namespace mesh_map */
+
+#endif  // MESH_MAP__VERTEX_PRIORITY_QUEUE_H
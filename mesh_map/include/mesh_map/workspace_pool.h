@@ -0,0 +1,138 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+#ifndef MESH_MAP__WORKSPACE_POOL_H
+#define MESH_MAP__WORKSPACE_POOL_H
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mesh_map
+{
+/**
+ * @brief Pool of per request planner workspaces. Each planning request checks out its own workspace, such that
+ * concurrent requests never share their search state, and returns it when the last reference is released, such that
+ * later requests reuse the allocated maps. The workspace type has to provide a std::atomic_bool member canceled, which
+ * is reset on checkout and set for all checked out workspaces by cancelAll(). The pool has to outlive its leases.
+ */
+template <typename Workspace>
+class WorkspacePool
+{
+public:
+  //! checked out workspace, which returns to the pool when the last reference is released
+  typedef std::shared_ptr<Workspace> Lease;
+
+  /**
+   * @brief Checks out an idle workspace or creates a new one if all workspaces are in use
+   * @return the workspace with a reset cancel token
+   */
+  Lease acquire()
+  {
+    std::unique_ptr<Workspace> workspace;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!idle.empty())
+    {
+      workspace = std::move(idle.back());
+      idle.pop_back();
+    }
+    else
+    {
+      workspace.reset(new Workspace());
+    }
+    workspace->canceled = false;
+    active.push_back(workspace.get());
+    return Lease(workspace.release(), [this](Workspace* released) { release(released); });
+  }
+
+  /**
+   * @brief Requests all checked out workspaces to cancel their planning request
+   * @return the number of canceled requests
+   */
+  size_t cancelAll()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Workspace* workspace : active)
+    {
+      workspace->canceled = true;
+    }
+    return active.size();
+  }
+
+  /**
+   * @brief Returns the number of checked out workspaces, i.e. the number of running requests
+   */
+  size_t numActive() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return active.size();
+  }
+
+  /**
+   * @brief Returns the number of workspaces waiting for the next request
+   */
+  size_t numIdle() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return idle.size();
+  }
+
+private:
+  /**
+   * @brief Returns a checked out workspace to the idle workspaces
+   */
+  void release(Workspace* workspace)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    active.erase(std::find(active.begin(), active.end(), workspace));
+    idle.emplace_back(workspace);
+  }
+
+  //! guards the idle and the checked out workspaces
+  mutable std::mutex mutex;
+
+  //! workspaces waiting for the next request
+  std::vector<std::unique_ptr<Workspace>> idle;
+
+  //! workspaces checked out by running requests
+  std::vector<Workspace*> active;
+};
+
+} /* namespace mesh_map */
+
+#endif  // MESH_MAP__WORKSPACE_POOL_H
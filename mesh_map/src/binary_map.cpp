@@ -0,0 +1,234 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+#include <mesh_map/binary_map.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mesh_map
+{
+constexpr char BinaryMapFile::MAGIC[8];
+constexpr uint32_t BinaryMapFile::VERSION;
+
+//! alignment of the section payloads in bytes
+static const uint64_t SECTION_ALIGNMENT = 8;
+
+static uint64_t alignOffset(const uint64_t offset)
+{
+  return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+}
+
+BinaryMapFile::Writer::Writer(const uint64_t mesh_hash, const uint64_t source_size, const int64_t source_mtime,
+                              const uint64_t num_vertices, const uint64_t num_faces, const uint64_t num_edges)
+{
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.num_sections = 0;
+  header.mesh_hash = mesh_hash;
+  header.source_size = source_size;
+  header.source_mtime = source_mtime;
+  header.num_vertices = num_vertices;
+  header.num_faces = num_faces;
+  header.num_edges = num_edges;
+}
+
+bool BinaryMapFile::Writer::write(const std::string& path)
+{
+  header.num_sections = entries.size();
+
+  uint64_t offset = alignOffset(sizeof(Header) + entries.size() * sizeof(SectionEntry));
+  for (size_t i = 0; i < entries.size(); i++)
+  {
+    entries[i].offset = offset;
+    offset = alignOffset(offset + payloads[i].size());
+  }
+
+  // write to a temporary file first, an interrupted write never leaves a broken binary map file behind
+  const std::string tmp_path = path + ".tmp";
+  std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+  if (!file)
+  {
+    return false;
+  }
+
+  const char padding[SECTION_ALIGNMENT] = {};
+  file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+  file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(SectionEntry));
+  uint64_t position = sizeof(Header) + entries.size() * sizeof(SectionEntry);
+  for (size_t i = 0; i < entries.size(); i++)
+  {
+    file.write(padding, entries[i].offset - position);
+    file.write(payloads[i].data(), payloads[i].size());
+    position = entries[i].offset + payloads[i].size();
+  }
+  file.write(padding, offset - position);
+  file.close();
+
+  if (!file)
+  {
+    std::remove(tmp_path.c_str());
+    return false;
+  }
+  return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+BinaryMapFile::BinaryMapFile() : data(nullptr), size(0)
+{
+}
+
+BinaryMapFile::~BinaryMapFile()
+{
+  close();
+}
+
+bool BinaryMapFile::open(const std::string& path)
+{
+  close();
+
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(Header))
+  {
+    ::close(fd);
+    return false;
+  }
+
+  void* mapping = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+  {
+    return false;
+  }
+  // the sections are read sequentially right after opening the file
+  madvise(mapping, file_stat.st_size, MADV_WILLNEED);
+
+  data = static_cast<const char*>(mapping);
+  size = file_stat.st_size;
+
+  const Header& file_header = header();
+  if (std::memcmp(file_header.magic, MAGIC, sizeof(MAGIC)) != 0 || file_header.version != VERSION ||
+      file_header.num_sections > (size - sizeof(Header)) / sizeof(SectionEntry))
+  {
+    close();
+    return false;
+  }
+
+  const SectionEntry* entries = reinterpret_cast<const SectionEntry*>(data + sizeof(Header));
+  for (uint32_t i = 0; i < file_header.num_sections; i++)
+  {
+    const SectionEntry& entry = entries[i];
+    if (entry.offset % SECTION_ALIGNMENT != 0 || entry.offset > size || entry.element_size == 0 ||
+        entry.count > (size - entry.offset) / entry.element_size)
+    {
+      close();
+      return false;
+    }
+  }
+  return true;
+}
+
+void BinaryMapFile::close()
+{
+  if (data)
+  {
+    munmap(const_cast<char*>(data), size);
+  }
+  data = nullptr;
+  size = 0;
+}
+
+const BinaryMapFile::SectionEntry* BinaryMapFile::findSection(const Section id) const
+{
+  if (!data)
+  {
+    return nullptr;
+  }
+
+  const SectionEntry* entries = reinterpret_cast<const SectionEntry*>(data + sizeof(Header));
+  for (uint32_t i = 0; i < header().num_sections; i++)
+  {
+    if (entries[i].id == id)
+    {
+      return &entries[i];
+    }
+  }
+  return nullptr;
+}
+
+bool BinaryMapFile::fileStamp(const std::string& path, uint64_t& size, int64_t& mtime)
+{
+  struct stat file_stat;
+  if (stat(path.c_str(), &file_stat) != 0)
+  {
+    return false;
+  }
+  size = file_stat.st_size;
+  mtime = static_cast<int64_t>(file_stat.st_mtim.tv_sec) * 1000000000 + file_stat.st_mtim.tv_nsec;
+  return true;
+}
+
+bool BinaryMapFile::restamp(const std::string& path, const uint64_t source_size, const int64_t source_mtime)
+{
+  std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+  Header file_header;
+  if (!file || !file.read(reinterpret_cast<char*>(&file_header), sizeof(Header)) ||
+      std::memcmp(file_header.magic, MAGIC, sizeof(MAGIC)) != 0 || file_header.version != VERSION)
+  {
+    return false;
+  }
+
+  // only the header is rewritten in place, the sections stay untouched
+  file_header.source_size = source_size;
+  file_header.source_mtime = source_mtime;
+  file.seekp(0);
+  file.write(reinterpret_cast<const char*>(&file_header), sizeof(Header));
+  file.close();
+  return static_cast<bool>(file);
+}
+
+} /* namespace mesh_map */
@@ -0,0 +1,295 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+#include <mesh_map/compact_mesh.h>
+
+namespace mesh_map
+{
+constexpr lvr2::Index CompactMesh::INVALID_INDEX;
+
+CompactMesh::CompactMesh()
+  : num_vertices(0), num_faces(0), num_edges(0), neighbour_offsets(1, 0), face_offsets(1, 0)
+{
+}
+
+CompactMesh::CompactMesh(const lvr2::HalfEdgeMesh<lvr2::BaseVector<float>>& mesh,
+                         const lvr2::DenseEdgeMap<float>& edge_distances_map)
+  : num_vertices(mesh.nextVertexIndex())
+  , num_faces(mesh.nextFaceIndex())
+  , num_edges(mesh.nextEdgeIndex())
+  , valid_vertices(num_vertices, false)
+  , neighbour_offsets(num_vertices + 1, 0)
+  , face_offsets(num_vertices + 1, 0)
+  , face_vertices(3 * num_faces, INVALID_INDEX)
+  , face_edges(3 * num_faces, INVALID_INDEX)
+  , face_edge_distances(3 * num_faces, std::numeric_limits<float>::infinity())
+  , edge_vertices(2 * num_edges, INVALID_INDEX)
+  , edge_distances(num_edges, std::numeric_limits<float>::infinity())
+{
+  for (auto eH : mesh.edges())
+  {
+    try
+    {
+      const std::array<lvr2::VertexHandle, 2> vertices = mesh.getVerticesOfEdge(eH);
+      edge_vertices[2 * eH.idx()] = vertices[0].idx();
+      edge_vertices[2 * eH.idx() + 1] = vertices[1].idx();
+      edge_distances[eH.idx()] = edge_distances_map[eH];
+    }
+    catch (lvr2::PanicException exception)
+    {
+      continue;
+    }
+  }
+
+  for (auto fH : mesh.faces())
+  {
+    const std::array<lvr2::VertexHandle, 3> vertices = mesh.getVerticesOfFace(fH);
+    for (size_t k = 0; k < 3; k++)
+    {
+      face_vertices[3 * fH.idx() + k] = vertices[k].idx();
+      const lvr2::OptionalEdgeHandle eH = mesh.getEdgeBetween(vertices[k], vertices[(k + 1) % 3]);
+      if (eH)
+      {
+        face_edges[3 * fH.idx() + k] = eH.unwrap().idx();
+        face_edge_distances[3 * fH.idx() + k] = edge_distances[eH.unwrap().idx()];
+      }
+    }
+  }
+
+  neighbour_vertices.reserve(2 * mesh.numEdges());
+  neighbour_edges.reserve(2 * mesh.numEdges());
+  neighbour_distances.reserve(2 * mesh.numEdges());
+  vertex_faces.reserve(3 * mesh.numFaces());
+
+  std::vector<lvr2::EdgeHandle> edges;
+  std::vector<lvr2::FaceHandle> faces;
+  for (lvr2::Index i = 0; i < num_vertices; i++)
+  {
+    const lvr2::VertexHandle vH(i);
+    if (mesh.containsVertex(vH))
+    {
+      edges.clear();
+      faces.clear();
+      try
+      {
+        mesh.getEdgesOfVertex(vH, edges);
+        mesh.getFacesOfVertex(vH, faces);
+        valid_vertices[i] = true;
+      }
+      catch (lvr2::PanicException exception)
+      {
+        edges.clear();
+        faces.clear();
+        invalid_vertices.push_back(vH);
+      }
+      catch (lvr2::VertexLoopException exception)
+      {
+        edges.clear();
+        faces.clear();
+        invalid_vertices.push_back(vH);
+      }
+
+      for (auto eH : edges)
+      {
+        const lvr2::Index v0 = edge_vertices[2 * eH.idx()];
+        const lvr2::Index v1 = edge_vertices[2 * eH.idx() + 1];
+        if (v0 == INVALID_INDEX || v1 == INVALID_INDEX)
+          continue;
+
+        neighbour_vertices.push_back(v0 == i ? v1 : v0);
+        neighbour_edges.push_back(eH.idx());
+        neighbour_distances.push_back(edge_distances[eH.idx()]);
+      }
+
+      for (auto fH : faces)
+      {
+        vertex_faces.push_back(fH.idx());
+      }
+    }
+    neighbour_offsets[i + 1] = neighbour_vertices.size();
+    face_offsets[i + 1] = vertex_faces.size();
+  }
+
+  neighbour_weights = neighbour_distances;
+  face_edge_weights = face_edge_distances;
+  edge_weights = edge_distances;
+  face_distance_geometry.build(face_edge_distances);
+}
+
+bool CompactMesh::read(const BinaryMapFile& map_file)
+{
+  const BinaryMapFile::Header& header = map_file.header();
+  num_vertices = header.num_vertices;
+  num_faces = header.num_faces;
+  num_edges = header.num_edges;
+
+  size_t num_invalid;
+  const lvr2::Index* invalid = map_file.section<lvr2::Index>(BinaryMapFile::INVALID_VERTICES, num_invalid);
+  std::vector<uint8_t> valid;
+  if (!invalid || !map_file.readSection(BinaryMapFile::VALID_VERTICES, num_vertices, valid) ||
+      !map_file.readSection(BinaryMapFile::NEIGHBOUR_OFFSETS, num_vertices + 1, neighbour_offsets) ||
+      !map_file.readSection(BinaryMapFile::NEIGHBOUR_VERTICES, neighbour_offsets.back(), neighbour_vertices) ||
+      !map_file.readSection(BinaryMapFile::NEIGHBOUR_EDGES, neighbour_offsets.back(), neighbour_edges) ||
+      !map_file.readSection(BinaryMapFile::FACE_OFFSETS, num_vertices + 1, face_offsets) ||
+      !map_file.readSection(BinaryMapFile::VERTEX_FACES, face_offsets.back(), vertex_faces) ||
+      !map_file.readSection(BinaryMapFile::FACE_VERTICES, 3 * num_faces, face_vertices) ||
+      !map_file.readSection(BinaryMapFile::FACE_EDGES, 3 * num_faces, face_edges) ||
+      !map_file.readSection(BinaryMapFile::EDGE_VERTICES, 2 * num_edges, edge_vertices) ||
+      !map_file.readSection(BinaryMapFile::EDGE_DISTANCES, num_edges, edge_distances))
+  {
+    *this = CompactMesh();
+    return false;
+  }
+
+  valid_vertices.assign(valid.begin(), valid.end());
+  invalid_vertices.clear();
+  invalid_vertices.reserve(num_invalid);
+  for (size_t i = 0; i < num_invalid; i++)
+  {
+    invalid_vertices.push_back(lvr2::VertexHandle(invalid[i]));
+  }
+
+  neighbour_distances.resize(neighbour_edges.size());
+  for (size_t i = 0; i < neighbour_edges.size(); i++)
+  {
+    neighbour_distances[i] = edge_distances[neighbour_edges[i]];
+  }
+
+  face_edge_distances.assign(face_edges.size(), std::numeric_limits<float>::infinity());
+  for (size_t i = 0; i < face_edges.size(); i++)
+  {
+    if (face_edges[i] != INVALID_INDEX)
+      face_edge_distances[i] = edge_distances[face_edges[i]];
+  }
+
+  neighbour_weights = neighbour_distances;
+  face_edge_weights = face_edge_distances;
+  edge_weights = edge_distances;
+  face_distance_geometry.build(face_edge_distances);
+  return true;
+}
+
+void CompactMesh::write(BinaryMapFile::Writer& writer) const
+{
+  const std::vector<uint8_t> valid(valid_vertices.begin(), valid_vertices.end());
+  std::vector<lvr2::Index> invalid;
+  invalid.reserve(invalid_vertices.size());
+  for (auto vH : invalid_vertices)
+  {
+    invalid.push_back(vH.idx());
+  }
+
+  writer.addSection(BinaryMapFile::VALID_VERTICES, valid.data(), valid.size());
+  writer.addSection(BinaryMapFile::INVALID_VERTICES, invalid.data(), invalid.size());
+  writer.addSection(BinaryMapFile::NEIGHBOUR_OFFSETS, neighbour_offsets.data(), neighbour_offsets.size());
+  writer.addSection(BinaryMapFile::NEIGHBOUR_VERTICES, neighbour_vertices.data(), neighbour_vertices.size());
+  writer.addSection(BinaryMapFile::NEIGHBOUR_EDGES, neighbour_edges.data(), neighbour_edges.size());
+  writer.addSection(BinaryMapFile::FACE_OFFSETS, face_offsets.data(), face_offsets.size());
+  writer.addSection(BinaryMapFile::VERTEX_FACES, vertex_faces.data(), vertex_faces.size());
+  writer.addSection(BinaryMapFile::FACE_VERTICES, face_vertices.data(), face_vertices.size());
+  writer.addSection(BinaryMapFile::FACE_EDGES, face_edges.data(), face_edges.size());
+  writer.addSection(BinaryMapFile::EDGE_VERTICES, edge_vertices.data(), edge_vertices.size());
+  writer.addSection(BinaryMapFile::EDGE_DISTANCES, edge_distances.data(), edge_distances.size());
+}
+
+void CompactMesh::updateEdgeWeights(const lvr2::DenseEdgeMap<float>& edge_weights_map)
+{
+  std::vector<float> weights(num_edges, std::numeric_limits<float>::infinity());
+
+#pragma omp parallel for
+  for (lvr2::Index i = 0; i < num_edges; i++)
+  {
+    if (edge_vertices[2 * i] != INVALID_INDEX)
+      weights[i] = edge_weights_map[lvr2::EdgeHandle(i)];
+  }
+
+  updateEdgeWeights(weights);
+}
+
+void CompactMesh::updateEdgeWeights(const std::vector<float>& weights)
+{
+  edge_weights = weights;
+
+#pragma omp parallel for
+  for (size_t i = 0; i < neighbour_edges.size(); i++)
+  {
+    neighbour_weights[i] = edge_weights[neighbour_edges[i]];
+  }
+
+#pragma omp parallel for
+  for (size_t i = 0; i < face_edges.size(); i++)
+  {
+    if (face_edges[i] != INVALID_INDEX)
+      face_edge_weights[i] = edge_weights[face_edges[i]];
+  }
+}
+
+void CompactMesh::updateEdgeWeight(const lvr2::EdgeHandle& eH, const float weight)
+{
+  const lvr2::Index e = eH.idx();
+  edge_weights[e] = weight;
+
+  // an edge occurs in the neighbour ranges of both of its vertices and in the faces around its first vertex
+  for (size_t k = 0; k < 2; k++)
+  {
+    const lvr2::Index v = edge_vertices[2 * e + k];
+    if (v == INVALID_INDEX)
+      continue;
+
+    for (lvr2::Index i = neighbour_offsets[v]; i < neighbour_offsets[v + 1]; i++)
+    {
+      if (neighbour_edges[i] == e)
+        neighbour_weights[i] = weight;
+    }
+  }
+
+  const lvr2::Index v = edge_vertices[2 * e];
+  if (v == INVALID_INDEX)
+    return;
+
+  for (lvr2::Index i = face_offsets[v]; i < face_offsets[v + 1]; i++)
+  {
+    const lvr2::Index f = vertex_faces[i];
+    for (size_t k = 0; k < 3; k++)
+    {
+      if (face_edges[3 * f + k] == e)
+        face_edge_weights[3 * f + k] = weight;
+    }
+  }
+}
+
+} /* namespace mesh_map */
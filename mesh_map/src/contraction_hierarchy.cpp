@@ -0,0 +1,373 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+#include <mesh_map/contraction_hierarchy.h>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+#include <mesh_map/binary_map.h>
+
+namespace mesh_map
+{
+constexpr lvr2::Index ContractionHierarchy::INVALID_INDEX;
+constexpr size_t ContractionHierarchy::MAX_WITNESS_SETTLED;
+
+ContractionHierarchy::ContractionHierarchy() : upward_offsets(1, 0), num_shortcuts(0)
+{
+}
+
+void ContractionHierarchy::build(const CompactMesh& graph, const std::vector<float>& weights,
+                                 const std::vector<uint8_t>& passable_vertices)
+{
+  const lvr2::Index num_vertices = graph.numVertices();
+  const auto& neighbours = graph.neighbourVertices();
+  passable = passable_vertices;
+  passable.resize(num_vertices, 0);
+  ranks.assign(num_vertices, INVALID_INDEX);
+  num_shortcuts = 0;
+
+  // the remaining graph only connects the passable vertices
+  std::vector<std::vector<Arc>> arcs(num_vertices);
+  for (lvr2::Index v = 0; v < num_vertices; v++)
+  {
+    if (!passable[v])
+      continue;
+
+    const lvr2::VertexHandle vH(v);
+    const lvr2::Index neighbours_end = graph.neighboursEnd(vH);
+    for (lvr2::Index i = graph.neighboursBegin(vH); i < neighbours_end; i++)
+    {
+      if (neighbours[i] != v && passable[neighbours[i]])
+        addArc(arcs[v], neighbours[i], weights[i], INVALID_INDEX);
+    }
+  }
+
+  WitnessSearch search;
+  search.distances.assign(num_vertices, std::numeric_limits<float>::infinity());
+  search.targets.assign(num_vertices, 0);
+  std::vector<Shortcut> shortcuts;
+  std::vector<uint32_t> contracted_neighbours(num_vertices, 0);
+
+  // the added shortcuts weighted twice against the removed edges, plus the number of contracted neighbours, which
+  // spreads the contraction uniformly over the mesh
+  auto priority = [&](const lvr2::Index v) {
+    findShortcuts(v, arcs, search, shortcuts);
+    return 2 * static_cast<int64_t>(shortcuts.size()) - static_cast<int64_t>(arcs[v].size()) +
+           static_cast<int64_t>(contracted_neighbours[v]);
+  };
+
+  typedef std::pair<int64_t, lvr2::Index> Entry;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+  for (lvr2::Index v = 0; v < num_vertices; v++)
+  {
+    if (passable[v])
+      queue.emplace(priority(v), v);
+  }
+
+  // the upward edges of a vertex are its remaining edges at the time of its contraction
+  std::vector<std::vector<Arc>> upward(num_vertices);
+  lvr2::Index next_rank = 0;
+  while (!queue.empty())
+  {
+    const lvr2::Index v = queue.top().second;
+    queue.pop();
+
+    // lazy update, the priority may have increased since the neighbours have been contracted
+    const int64_t current_priority = priority(v);
+    if (!queue.empty() && current_priority > queue.top().first)
+    {
+      queue.emplace(current_priority, v);
+      continue;
+    }
+
+    ranks[v] = next_rank++;
+    upward[v].swap(arcs[v]);
+    for (const Arc& arc : upward[v])
+    {
+      std::vector<Arc>& target_arcs = arcs[arc.target];
+      target_arcs.erase(std::remove_if(target_arcs.begin(), target_arcs.end(),
+                                       [v](const Arc& target_arc) { return target_arc.target == v; }),
+                        target_arcs.end());
+      contracted_neighbours[arc.target]++;
+    }
+    for (const Shortcut& shortcut : shortcuts)
+    {
+      addArc(arcs[shortcut.from], shortcut.to, shortcut.weight, v);
+      addArc(arcs[shortcut.to], shortcut.from, shortcut.weight, v);
+    }
+    num_shortcuts += shortcuts.size();
+  }
+
+  upward_offsets.assign(num_vertices + 1, 0);
+  for (lvr2::Index v = 0; v < num_vertices; v++)
+  {
+    upward_offsets[v + 1] = upward_offsets[v] + upward[v].size();
+  }
+
+  upward_targets.resize(upward_offsets.back());
+  upward_weights.resize(upward_offsets.back());
+  upward_middles.resize(upward_offsets.back());
+  for (lvr2::Index v = 0; v < num_vertices; v++)
+  {
+    lvr2::Index i = upward_offsets[v];
+    for (const Arc& arc : upward[v])
+    {
+      upward_targets[i] = arc.target;
+      upward_weights[i] = arc.weight;
+      upward_middles[i] = arc.middle;
+      i++;
+    }
+  }
+}
+
+void ContractionHierarchy::findShortcuts(const lvr2::Index vH, const std::vector<std::vector<Arc>>& arcs,
+                                         WitnessSearch& search, std::vector<Shortcut>& shortcuts)
+{
+  typedef std::pair<float, lvr2::Index> Entry;
+  const std::vector<Arc>& vertex_arcs = arcs[vH];
+  std::vector<float>& distances = search.distances;
+  std::vector<Entry> heap;
+  shortcuts.clear();
+
+  // the graph is undirected, each neighbour only searches witnesses to the neighbours following it
+  for (size_t i = 0; i + 1 < vertex_arcs.size(); i++)
+  {
+    const Arc& from = vertex_arcs[i];
+    float max_dist = 0;
+    for (size_t j = i + 1; j < vertex_arcs.size(); j++)
+    {
+      max_dist = std::max(max_dist, from.weight + vertex_arcs[j].weight);
+    }
+
+    size_t open_target_cnt = 0;
+    for (size_t j = i + 1; j < vertex_arcs.size(); j++)
+    {
+      search.targets[vertex_arcs[j].target] = 1;
+      open_target_cnt++;
+    }
+
+    // bounded Dijkstra search from the neighbour, which avoids the vertex to contract and stops as soon as all
+    // following neighbours are settled
+    distances[from.target] = 0;
+    search.touched.push_back(from.target);
+    heap.emplace_back(0, from.target);
+    size_t settled_cnt = 0;
+    while (!heap.empty() && settled_cnt < MAX_WITNESS_SETTLED)
+    {
+      std::pop_heap(heap.begin(), heap.end(), std::greater<Entry>());
+      const Entry current = heap.back();
+      heap.pop_back();
+      if (current.first > distances[current.second])
+        continue;
+      if (current.first > max_dist)
+        break;
+      settled_cnt++;
+      if (search.targets[current.second] && --open_target_cnt == 0)
+        break;
+
+      for (const Arc& arc : arcs[current.second])
+      {
+        if (arc.target == vH)
+          continue;
+
+        const float dist = current.first + arc.weight;
+        if (dist < distances[arc.target])
+        {
+          if (distances[arc.target] == std::numeric_limits<float>::infinity())
+            search.touched.push_back(arc.target);
+          distances[arc.target] = dist;
+          heap.emplace_back(dist, arc.target);
+          std::push_heap(heap.begin(), heap.end(), std::greater<Entry>());
+        }
+      }
+    }
+
+    // a shortcut is required if no witness path is at most as long as the path over the vertex
+    for (size_t j = i + 1; j < vertex_arcs.size(); j++)
+    {
+      const float dist = from.weight + vertex_arcs[j].weight;
+      if (distances[vertex_arcs[j].target] > dist)
+        shortcuts.push_back({ from.target, vertex_arcs[j].target, dist });
+      search.targets[vertex_arcs[j].target] = 0;
+    }
+
+    for (const lvr2::Index touched : search.touched)
+    {
+      distances[touched] = std::numeric_limits<float>::infinity();
+    }
+    search.touched.clear();
+    heap.clear();
+  }
+}
+
+void ContractionHierarchy::addArc(std::vector<Arc>& vertex_arcs, const lvr2::Index target, const float weight,
+                                  const lvr2::Index middle)
+{
+  for (Arc& arc : vertex_arcs)
+  {
+    if (arc.target == target)
+    {
+      if (weight < arc.weight)
+      {
+        arc.weight = weight;
+        arc.middle = middle;
+      }
+      return;
+    }
+  }
+  vertex_arcs.push_back({ target, weight, middle });
+}
+
+lvr2::Index ContractionHierarchy::findUpwardEdge(const lvr2::Index a, const lvr2::Index b) const
+{
+  if (a >= ranks.size() || b >= ranks.size() || ranks[a] == INVALID_INDEX || ranks[b] == INVALID_INDEX)
+    return INVALID_INDEX;
+
+  // the edge is stored at its lower ranked vertex
+  const lvr2::Index lower = ranks[a] < ranks[b] ? a : b;
+  const lvr2::Index higher = ranks[a] < ranks[b] ? b : a;
+  for (lvr2::Index i = upward_offsets[lower]; i < upward_offsets[lower + 1]; i++)
+  {
+    if (upward_targets[i] == higher)
+      return i;
+  }
+  return INVALID_INDEX;
+}
+
+bool ContractionHierarchy::unpackPath(const std::vector<lvr2::VertexHandle>& hierarchy_path,
+                                      std::vector<lvr2::VertexHandle>& path, std::vector<float>& lengths) const
+{
+  path.clear();
+  lengths.clear();
+  if (hierarchy_path.empty())
+    return true;
+
+  path.push_back(hierarchy_path.front());
+  lengths.push_back(0);
+
+  // edges still to unpack, the top of the stack is the next edge along the path
+  std::vector<std::pair<lvr2::Index, lvr2::Index>> stack;
+  for (size_t k = 1; k < hierarchy_path.size(); k++)
+  {
+    stack.emplace_back(hierarchy_path[k - 1].idx(), hierarchy_path[k].idx());
+    while (!stack.empty())
+    {
+      const std::pair<lvr2::Index, lvr2::Index> edge = stack.back();
+      stack.pop_back();
+
+      const lvr2::Index i = findUpwardEdge(edge.first, edge.second);
+      if (i == INVALID_INDEX)
+        return false;
+
+      if (upward_middles[i] == INVALID_INDEX)
+      {
+        path.push_back(lvr2::VertexHandle(edge.second));
+        lengths.push_back(lengths.back() + upward_weights[i]);
+      }
+      else
+      {
+        stack.emplace_back(upward_middles[i], edge.second);
+        stack.emplace_back(edge.first, upward_middles[i]);
+      }
+    }
+  }
+  return true;
+}
+
+bool ContractionHierarchy::read(const std::string& path, const uint64_t mesh_hash)
+{
+  BinaryMapFile file;
+  if (!file.open(path) || file.header().mesh_hash != mesh_hash)
+    return false;
+
+  const size_t num_vertices = file.header().num_vertices;
+  ContractionHierarchy hierarchy;
+  if (!file.readSection(BinaryMapFile::HIERARCHY_PASSABLE, num_vertices, hierarchy.passable) ||
+      !file.readSection(BinaryMapFile::HIERARCHY_RANKS, num_vertices, hierarchy.ranks) ||
+      !file.readSection(BinaryMapFile::HIERARCHY_UPWARD_OFFSETS, num_vertices + 1, hierarchy.upward_offsets) ||
+      !file.readSection(BinaryMapFile::HIERARCHY_UPWARD_TARGETS, hierarchy.upward_offsets.back(),
+                        hierarchy.upward_targets) ||
+      !file.readSection(BinaryMapFile::HIERARCHY_UPWARD_WEIGHTS, hierarchy.upward_offsets.back(),
+                        hierarchy.upward_weights) ||
+      !file.readSection(BinaryMapFile::HIERARCHY_UPWARD_MIDDLES, hierarchy.upward_offsets.back(),
+                        hierarchy.upward_middles))
+  {
+    return false;
+  }
+
+  // the searches index the vertex arrays with the stored values, a corrupt file must not make them read out of bounds
+  if (hierarchy.upward_offsets.front() != 0 ||
+      !std::is_sorted(hierarchy.upward_offsets.begin(), hierarchy.upward_offsets.end()))
+  {
+    return false;
+  }
+  const auto out_of_range = [num_vertices](const lvr2::Index index) { return index >= num_vertices; };
+  const auto invalid_or_out_of_range = [num_vertices](const lvr2::Index index) {
+    return index != INVALID_INDEX && index >= num_vertices;
+  };
+  if (std::any_of(hierarchy.ranks.begin(), hierarchy.ranks.end(), invalid_or_out_of_range) ||
+      std::any_of(hierarchy.upward_targets.begin(), hierarchy.upward_targets.end(), out_of_range) ||
+      std::any_of(hierarchy.upward_middles.begin(), hierarchy.upward_middles.end(), invalid_or_out_of_range))
+  {
+    return false;
+  }
+
+  hierarchy.num_shortcuts =
+      std::count_if(hierarchy.upward_middles.begin(), hierarchy.upward_middles.end(),
+                    [](const lvr2::Index middle) { return middle != INVALID_INDEX; });
+  *this = std::move(hierarchy);
+  return true;
+}
+
+bool ContractionHierarchy::write(const std::string& path, const uint64_t mesh_hash) const
+{
+  // the hierarchy is identified by the mesh hash and its passable vertices, not by the source map file
+  BinaryMapFile::Writer writer(mesh_hash, 0, 0, passable.size(), 0, 0);
+  writer.addSection(BinaryMapFile::HIERARCHY_PASSABLE, passable.data(), passable.size());
+  writer.addSection(BinaryMapFile::HIERARCHY_RANKS, ranks.data(), ranks.size());
+  writer.addSection(BinaryMapFile::HIERARCHY_UPWARD_OFFSETS, upward_offsets.data(), upward_offsets.size());
+  writer.addSection(BinaryMapFile::HIERARCHY_UPWARD_TARGETS, upward_targets.data(), upward_targets.size());
+  writer.addSection(BinaryMapFile::HIERARCHY_UPWARD_WEIGHTS, upward_weights.data(), upward_weights.size());
+  writer.addSection(BinaryMapFile::HIERARCHY_UPWARD_MIDDLES, upward_middles.data(), upward_middles.size());
+  return writer.write(path);
+}
+
+} /* namespace mesh_map */
@@ -0,0 +1,273 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+#include <mesh_map/distance_matrix.h>
+
+#include <cmath>
+#include <limits>
+
+#include <mesh_map/triangle_update.h>
+#include <omp.h>
+#include <ros/console.h>
+
+namespace mesh_map
+{
+DistanceMatrix::DistanceMatrix(MeshMap& mesh_map, const PriorityQueueType& queue_type)
+  : mesh_map(mesh_map), queue_type(queue_type)
+{
+}
+
+size_t DistanceMatrix::compute(const std::vector<Vector>& sources, const std::vector<Vector>& targets,
+                               const float max_dist, const float cost_limit, const int num_threads,
+                               std::vector<float>& distances)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  distances.assign(sources.size() * targets.size(), std::numeric_limits<float>::infinity());
+
+  // pin the current costs for all propagations, concurrent layer updates publish a new snapshot
+  const CostSnapshot::ConstPtr cost_snapshot = mesh_map.costSnapshot();
+  if (!cost_snapshot || sources.empty() || targets.empty())
+    return 0;
+
+  const auto& mesh = mesh_map.mesh();
+
+  // locate all sources and targets with one batch query
+  std::vector<Vector> positions(sources);
+  positions.insert(positions.end(), targets.begin(), targets.end());
+  std::vector<lvr2::OptionalFaceHandle> faces;
+  std::vector<std::array<float, 3>> barycentric_coords;
+  std::vector<float> face_dists;
+  mesh_map.searchContainingFaces(positions, max_dist, faces, barycentric_coords, face_dists);
+
+  std::vector<Vector> projected(positions.size());
+  for (size_t i = 0; i < positions.size(); i++)
+  {
+    if (faces[i])
+      projected[i] = projectedPosition(faces[i].unwrap(), barycentric_coords[i]);
+  }
+
+  // the propagations have to fix the vertices of all located target faces
+  std::vector<lvr2::VertexHandle> target_vertices;
+  target_vertices.reserve(3 * targets.size());
+  for (size_t j = sources.size(); j < positions.size(); j++)
+  {
+    if (!faces[j])
+    {
+      ROS_WARN_STREAM("Target " << j - sources.size() << " is not located on the mesh!");
+      continue;
+    }
+    const std::array<lvr2::VertexHandle, 3> face_vertices = mesh.getVerticesOfFace(faces[j].unwrap());
+    target_vertices.insert(target_vertices.end(), face_vertices.begin(), face_vertices.end());
+  }
+
+  const int threads = num_threads > 0 ? num_threads : omp_get_max_threads();
+  if (workspaces.size() < static_cast<size_t>(threads))
+    workspaces.resize(threads);
+
+  size_t located_cnt = 0;
+
+  // one propagation per source, the propagation lengths differ such that the sources are scheduled dynamically
+#pragma omp parallel for schedule(dynamic, 1) num_threads(threads) reduction(+ : located_cnt)
+  for (size_t i = 0; i < sources.size(); i++)
+  {
+    if (!faces[i])
+    {
+      ROS_WARN_STREAM("Source " << i << " is not located on the mesh!");
+      continue;
+    }
+    located_cnt++;
+
+    Workspace& ws = workspaces[omp_get_thread_num()];
+    const lvr2::FaceHandle source_face = faces[i].unwrap();
+    propagate(projected[i], source_face, target_vertices, cost_snapshot->vertex_costs, cost_limit, ws);
+
+    float* row = &distances[i * targets.size()];
+    for (size_t j = 0; j < targets.size(); j++)
+    {
+      const size_t k = sources.size() + j;
+      if (!faces[k])
+        continue;
+
+      const lvr2::FaceHandle target_face = faces[k].unwrap();
+      // a target within the source face is reached on a straight line
+      row[j] = target_face == source_face ?
+                   projected[i].distance(projected[k]) :
+                   targetDistance(projected[k], target_face, barycentric_coords[k], ws.distances);
+    }
+  }
+  return located_cnt;
+}
+
+void DistanceMatrix::propagate(const Vector& source, const lvr2::FaceHandle& source_face,
+                               const std::vector<lvr2::VertexHandle>& target_vertices,
+                               const SharedVertexCosts& vertex_costs, const float cost_limit, Workspace& ws)
+{
+  const auto& mesh = mesh_map.mesh();
+  const auto& graph = mesh_map.compactMesh();
+  const auto& face_geometry = graph.faceDistanceGeometry();
+  const auto& vertex_faces = graph.vertexFaces();
+  const auto& face_vertices = graph.faceVertices();
+  const auto& invalid = mesh_map.invalid;
+
+  // only restores the vertices touched by the previous propagation of this thread
+  ws.workspace.reset(mesh, ws.distances, ws.predecessors);
+  StampedVertexFlags& fixed = ws.workspace.fixed();
+  lvr2::DenseVertexMap<float>& distances = ws.distances;
+
+  if (!ws.queue || ws.queue_size != mesh.nextVertexIndex())
+  {
+    ws.queue = createVertexPriorityQueue(queue_type, mesh.nextVertexIndex());
+    ws.queue_size = mesh.nextVertexIndex();
+  }
+  VertexPriorityQueue& pq = *ws.queue;
+  pq.clear();
+
+  // flag the target vertices, the propagation stops as soon as all of them have been fixed
+  StampedVertexFlags& target_flags = ws.target_flags;
+  target_flags.reset(mesh.nextVertexIndex());
+  size_t open_target_cnt = 0;
+  for (const auto& vH : target_vertices)
+  {
+    if (!target_flags[vH])
+    {
+      target_flags.set(vH);
+      open_target_cnt++;
+    }
+  }
+
+  // seed the vertices of the source face with their distance to the source
+  for (auto vH : mesh.getVerticesOfFace(source_face))
+  {
+    distances[vH] = source.distance(mesh.getVertexPosition(vH));
+    ws.workspace.touch(vH);
+    fixed.set(vH);
+    pq.insert(vH, distances[vH]);
+  }
+
+  while (!pq.isEmpty() && open_target_cnt > 0)
+  {
+    const lvr2::VertexHandle current_vh = pq.popMin();
+    fixed.set(current_vh);
+
+    // impassable target vertices are fixed as well, the target face can still be reached over the other vertices
+    if (target_flags[current_vh])
+    {
+      target_flags.unset(current_vh);
+      open_target_cnt--;
+    }
+
+    if (vertex_costs[current_vh] > cost_limit || invalid[current_vh])
+      continue;
+
+    const lvr2::Index faces_end = graph.facesEnd(current_vh);
+    for (lvr2::Index i = graph.facesBegin(current_vh); i < faces_end; i++)
+    {
+      const lvr2::FaceHandle fh(vertex_faces[i]);
+      const lvr2::Index* vertices = &face_vertices[3 * fh.idx()];
+      const std::array<lvr2::VertexHandle, 3> face = { lvr2::VertexHandle(vertices[0]),
+                                                       lvr2::VertexHandle(vertices[1]),
+                                                       lvr2::VertexHandle(vertices[2]) };
+      if (invalid[face[0]] || invalid[face[1]] || invalid[face[2]])
+        continue;
+
+      // only a face with exactly one free vertex is updated
+      size_t free_cnt = 0;
+      size_t k = 0;
+      for (size_t n = 0; n < 3; n++)
+      {
+        if (!fixed[face[n]])
+        {
+          free_cnt++;
+          k = n;
+        }
+      }
+      if (free_cnt != 1)
+        continue;
+
+      // the k-th corner updates the k-th vertex from the (k+1 mod 3)-th and the (k+2 mod 3)-th vertex
+      const lvr2::VertexHandle& v1 = face[(k + 1) % 3];
+      const lvr2::VertexHandle& v2 = face[(k + 2) % 3];
+      const lvr2::VertexHandle& v3 = face[k];
+      TriangleUpdate update;
+      if (triangleUpdate(distances[v1], distances[v2], distances[v3], face_geometry.corner(fh, k), v1, v2, update))
+      {
+        ws.workspace.touch(v3);
+        distances[v3] = update.distance;
+        ws.predecessors[v3] = update.predecessor;
+        pq.insert(v3, update.distance);
+      }
+    }
+  }
+}
+
+float DistanceMatrix::targetDistance(const Vector& target, const lvr2::FaceHandle& target_face,
+                                     const std::array<float, 3>& barycentric_coords,
+                                     const lvr2::DenseVertexMap<float>& distances) const
+{
+  const auto& mesh = mesh_map.mesh();
+  const std::array<lvr2::VertexHandle, 3> face_vertices = mesh.getVerticesOfFace(target_face);
+
+  float interpolated = 0;
+  bool all_reached = true;
+  for (size_t k = 0; k < 3; k++)
+  {
+    const float dist = distances[face_vertices[k]];
+    all_reached &= std::isfinite(dist);
+    interpolated += barycentric_coords[k] * dist;
+  }
+  if (all_reached)
+    return interpolated;
+
+  // the face is only partially reached, e.g. at a lethal vertex, take the shortest straight line from a reached vertex
+  float shortest = std::numeric_limits<float>::infinity();
+  for (const auto& vH : face_vertices)
+  {
+    if (std::isfinite(distances[vH]))
+      shortest = std::min(shortest, distances[vH] + target.distance(mesh.getVertexPosition(vH)));
+  }
+  return shortest;
+}
+
+Vector DistanceMatrix::projectedPosition(const lvr2::FaceHandle& face,
+                                         const std::array<float, 3>& barycentric_coords) const
+{
+  const std::array<Vector, 3> vertices = mesh_map.mesh().getVertexPositionsOfFace(face);
+  return vertices[0] * barycentric_coords[0] + vertices[1] * barycentric_coords[1] +
+         vertices[2] * barycentric_coords[2];
+}
+
+} /* namespace mesh_map */
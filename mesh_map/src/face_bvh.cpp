@@ -0,0 +1,554 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+#include <mesh_map/face_bvh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace mesh_map
+{
+constexpr uint32_t FaceBVH::MAX_LEAF_SIZE;
+constexpr size_t FaceBVH::NUM_BINS;
+constexpr uint32_t FaceBVH::INVALID_TRIANGLE;
+
+static inline float coordinate(const Vector& vec, const size_t axis)
+{
+  return axis == 0 ? vec.x : (axis == 1 ? vec.y : vec.z);
+}
+
+static inline Vector componentMin(const Vector& a, const Vector& b)
+{
+  return Vector(std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z));
+}
+
+static inline Vector componentMax(const Vector& a, const Vector& b)
+{
+  return Vector(std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z));
+}
+
+static inline float surfaceArea(const Vector& bb_min, const Vector& bb_max)
+{
+  const Vector extent = bb_max - bb_min;
+  return 2 * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+/**
+ * @brief Computes the squared distance between a point and an axis aligned box, zero if the point is inside
+ */
+static inline float boxDistance2(const std::array<float, 3>& bb_min, const std::array<float, 3>& bb_max,
+                                 const Vector& point)
+{
+  float dist2 = 0;
+  for (size_t axis = 0; axis < 3; axis++)
+  {
+    const float value = coordinate(point, axis);
+    const float delta = std::max(std::max(bb_min[axis] - value, value - bb_max[axis]), 0.0f);
+    dist2 += delta * delta;
+  }
+  return dist2;
+}
+
+/**
+ * @brief Computes the ray parameter at which the ray enters the box, using the slab test
+ * @return true if the ray hits the box within [0, max_t]
+ */
+static inline bool intersectBox(const std::array<float, 3>& bb_min, const std::array<float, 3>& bb_max,
+                                const Vector& origin, const Vector& inv_direction, const float max_t, float& t_enter)
+{
+  float t_min = 0;
+  float t_max = max_t;
+  for (size_t axis = 0; axis < 3; axis++)
+  {
+    const float o = coordinate(origin, axis);
+    const float inv = coordinate(inv_direction, axis);
+    const float t0 = (bb_min[axis] - o) * inv;
+    const float t1 = (bb_max[axis] - o) * inv;
+    t_min = std::max(t_min, std::min(t0, t1));
+    t_max = std::min(t_max, std::max(t0, t1));
+  }
+  t_enter = t_min;
+  return t_min <= t_max;
+}
+
+/**
+ * @brief Computes the point on the triangle (a, b, c) closest to p by classifying p against the Voronoi regions of
+ * the triangle's vertices, edges and face, see Ericson, Real-Time Collision Detection, 5.1.5
+ */
+static Vector closestPointOnTriangle(const Vector& p, const Vector& a, const Vector& b, const Vector& c,
+                                     std::array<float, 3>& barycentric_coords)
+{
+  const Vector ab = b - a;
+  const Vector ac = c - a;
+  const Vector ap = p - a;
+  const float d1 = ab.dot(ap);
+  const float d2 = ac.dot(ap);
+  if (d1 <= 0 && d2 <= 0)
+  {
+    barycentric_coords = { 1, 0, 0 };
+    return a;
+  }
+
+  const Vector bp = p - b;
+  const float d3 = ab.dot(bp);
+  const float d4 = ac.dot(bp);
+  if (d3 >= 0 && d4 <= d3)
+  {
+    barycentric_coords = { 0, 1, 0 };
+    return b;
+  }
+
+  const float vc = d1 * d4 - d3 * d2;
+  if (vc <= 0 && d1 >= 0 && d3 <= 0)
+  {
+    const float v = d1 / (d1 - d3);
+    barycentric_coords = { 1 - v, v, 0 };
+    return a + ab * v;
+  }
+
+  const Vector cp = p - c;
+  const float d5 = ab.dot(cp);
+  const float d6 = ac.dot(cp);
+  if (d6 >= 0 && d5 <= d6)
+  {
+    barycentric_coords = { 0, 0, 1 };
+    return c;
+  }
+
+  const float vb = d5 * d2 - d1 * d6;
+  if (vb <= 0 && d2 >= 0 && d6 <= 0)
+  {
+    const float w = d2 / (d2 - d6);
+    barycentric_coords = { 1 - w, 0, w };
+    return a + ac * w;
+  }
+
+  const float va = d3 * d6 - d5 * d4;
+  if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+  {
+    const float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    barycentric_coords = { 0, 1 - w, w };
+    return b + (c - b) * w;
+  }
+
+  const float denom = 1 / (va + vb + vc);
+  const float v = vb * denom;
+  const float w = vc * denom;
+  barycentric_coords = { 1 - v - w, v, w };
+  return a + ab * v + ac * w;
+}
+
+FaceBVH::FaceBVH()
+{
+}
+
+void FaceBVH::build(const lvr2::HalfEdgeMesh<Vector>& mesh)
+{
+  nodes.clear();
+  triangles.clear();
+  face_indices.clear();
+
+  std::vector<std::array<Vector, 3>> mesh_triangles;
+  std::vector<lvr2::Index> mesh_faces;
+  mesh_triangles.reserve(mesh.numFaces());
+  mesh_faces.reserve(mesh.numFaces());
+  for (auto fH : mesh.faces())
+  {
+    mesh_triangles.push_back(mesh.getVertexPositionsOfFace(fH));
+    mesh_faces.push_back(fH.idx());
+  }
+
+  if (mesh_triangles.empty())
+    return;
+
+  std::vector<Vector> centroids(mesh_triangles.size());
+  std::vector<std::array<Vector, 2>> bounds(mesh_triangles.size());
+  for (size_t i = 0; i < mesh_triangles.size(); i++)
+  {
+    const std::array<Vector, 3>& t = mesh_triangles[i];
+    centroids[i] = (t[0] + t[1] + t[2]) / 3;
+    bounds[i] = { componentMin(componentMin(t[0], t[1]), t[2]), componentMax(componentMax(t[0], t[1]), t[2]) };
+  }
+
+  std::vector<uint32_t> order(mesh_triangles.size());
+  std::iota(order.begin(), order.end(), 0);
+
+  nodes.reserve(2 * mesh_triangles.size() / MAX_LEAF_SIZE + 1);
+  buildNode(0, order.size(), centroids, bounds, order);
+
+  // store the triangles in leaf order
+  triangles.reserve(order.size());
+  face_indices.reserve(order.size());
+  for (auto i : order)
+  {
+    triangles.push_back(mesh_triangles[i]);
+    face_indices.push_back(mesh_faces[i]);
+  }
+}
+
+uint32_t FaceBVH::buildNode(const uint32_t begin, const uint32_t end, const std::vector<Vector>& centroids,
+                            const std::vector<std::array<Vector, 2>>& bounds, std::vector<uint32_t>& order)
+{
+  const uint32_t node_index = nodes.size();
+  nodes.emplace_back();
+
+  const float max = std::numeric_limits<float>::max();
+  const float lowest = std::numeric_limits<float>::lowest();
+  Vector bb_min(max, max, max), bb_max(lowest, lowest, lowest);
+  Vector centroid_min(max, max, max), centroid_max(lowest, lowest, lowest);
+  for (uint32_t i = begin; i < end; i++)
+  {
+    const uint32_t t = order[i];
+    bb_min = componentMin(bb_min, bounds[t][0]);
+    bb_max = componentMax(bb_max, bounds[t][1]);
+    centroid_min = componentMin(centroid_min, centroids[t]);
+    centroid_max = componentMax(centroid_max, centroids[t]);
+  }
+  nodes[node_index].bb_min = { bb_min.x, bb_min.y, bb_min.z };
+  nodes[node_index].bb_max = { bb_max.x, bb_max.y, bb_max.z };
+
+  const uint32_t count = end - begin;
+  if (count <= MAX_LEAF_SIZE)
+  {
+    nodes[node_index].offset = begin;
+    nodes[node_index].count = count;
+    return node_index;
+  }
+
+  // evaluate the surface area heuristic for the bin borders along each axis
+  float best_cost = std::numeric_limits<float>::infinity();
+  size_t best_axis = 0;
+  size_t best_split = 0;
+  for (size_t axis = 0; axis < 3; axis++)
+  {
+    const float axis_min = coordinate(centroid_min, axis);
+    const float extent = coordinate(centroid_max, axis) - axis_min;
+    if (extent <= 0)
+      continue;
+
+    std::array<uint32_t, NUM_BINS> bin_counts;
+    std::array<Vector, NUM_BINS> bin_min, bin_max;
+    bin_counts.fill(0);
+    bin_min.fill(Vector(max, max, max));
+    bin_max.fill(Vector(lowest, lowest, lowest));
+
+    const float scale = NUM_BINS / extent;
+    for (uint32_t i = begin; i < end; i++)
+    {
+      const uint32_t t = order[i];
+      const size_t bin =
+          std::min(NUM_BINS - 1, static_cast<size_t>((coordinate(centroids[t], axis) - axis_min) * scale));
+      bin_counts[bin]++;
+      bin_min[bin] = componentMin(bin_min[bin], bounds[t][0]);
+      bin_max[bin] = componentMax(bin_max[bin], bounds[t][1]);
+    }
+
+    // sweep from the right to get the area and the number of triangles right of each bin border
+    std::array<float, NUM_BINS> right_area;
+    std::array<uint32_t, NUM_BINS> right_count;
+    Vector right_min(max, max, max), right_max(lowest, lowest, lowest);
+    uint32_t num_right = 0;
+    for (size_t bin = NUM_BINS - 1; bin > 0; bin--)
+    {
+      num_right += bin_counts[bin];
+      right_min = componentMin(right_min, bin_min[bin]);
+      right_max = componentMax(right_max, bin_max[bin]);
+      right_count[bin] = num_right;
+      right_area[bin] = num_right > 0 ? surfaceArea(right_min, right_max) : 0;
+    }
+
+    Vector left_min(max, max, max), left_max(lowest, lowest, lowest);
+    uint32_t num_left = 0;
+    for (size_t split = 1; split < NUM_BINS; split++)
+    {
+      num_left += bin_counts[split - 1];
+      left_min = componentMin(left_min, bin_min[split - 1]);
+      left_max = componentMax(left_max, bin_max[split - 1]);
+      if (num_left == 0 || right_count[split] == 0)
+        continue;
+
+      const float cost = num_left * surfaceArea(left_min, left_max) + right_count[split] * right_area[split];
+      if (cost < best_cost)
+      {
+        best_cost = cost;
+        best_axis = axis;
+        best_split = split;
+      }
+    }
+  }
+
+  uint32_t mid = begin + count / 2;
+  if (std::isfinite(best_cost))
+  {
+    // keep small nodes as leafs if no split is cheaper than intersecting all triangles
+    if (count <= 4 * MAX_LEAF_SIZE && best_cost >= count * surfaceArea(bb_min, bb_max))
+    {
+      nodes[node_index].offset = begin;
+      nodes[node_index].count = count;
+      return node_index;
+    }
+
+    const float axis_min = coordinate(centroid_min, best_axis);
+    const float scale = NUM_BINS / (coordinate(centroid_max, best_axis) - axis_min);
+    auto split_iter = std::partition(order.begin() + begin, order.begin() + end, [&](const uint32_t t) {
+      return std::min(NUM_BINS - 1, static_cast<size_t>((coordinate(centroids[t], best_axis) - axis_min) * scale)) <
+             best_split;
+    });
+    mid = split_iter - order.begin();
+  }
+  // else all centroids coincide and the range is split in the middle
+
+  buildNode(begin, mid, centroids, bounds, order);
+  const uint32_t right_child = buildNode(mid, end, centroids, bounds, order);
+  nodes[node_index].offset = right_child;
+  nodes[node_index].count = 0;
+  return node_index;
+}
+
+bool FaceBVH::closestFace(const Vector& point, const float max_dist, lvr2::FaceHandle& face,
+                          std::array<float, 3>& barycentric_coords, float& dist) const
+{
+  std::vector<uint32_t> stack;
+  stack.reserve(64);
+  uint32_t best_triangle = INVALID_TRIANGLE;
+  float best_dist2 = max_dist * max_dist;
+  closestTriangle(point, stack, best_triangle, best_dist2, barycentric_coords);
+  if (best_triangle == INVALID_TRIANGLE)
+    return false;
+
+  face = lvr2::FaceHandle(face_indices[best_triangle]);
+  dist = std::sqrt(best_dist2);
+  return true;
+}
+
+void FaceBVH::closestFaces(const std::vector<Vector>& points, const float max_dist,
+                           std::vector<lvr2::OptionalFaceHandle>& faces,
+                           std::vector<std::array<float, 3>>& barycentric_coords, std::vector<float>& dists) const
+{
+  faces.assign(points.size(), lvr2::OptionalFaceHandle());
+  barycentric_coords.assign(points.size(), { 0, 0, 0 });
+  dists.assign(points.size(), std::numeric_limits<float>::infinity());
+  if (nodes.empty())
+    return;
+
+  std::vector<size_t> order;
+  mortonOrder(points, order);
+  const float max_dist2 = max_dist * max_dist;
+
+#pragma omp parallel
+  {
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    uint32_t previous_triangle = INVALID_TRIANGLE;
+
+    // static scheduling hands each thread a contiguous, spatially coherent part of the Morton order
+#pragma omp for schedule(static)
+    for (size_t k = 0; k < order.size(); k++)
+    {
+      const size_t i = order[k];
+      const Vector& point = points[i];
+      uint32_t best_triangle = INVALID_TRIANGLE;
+      float best_dist2 = max_dist2;
+      std::array<float, 3> coords;
+
+      if (previous_triangle != INVALID_TRIANGLE)
+      {
+        const std::array<Vector, 3>& t = triangles[previous_triangle];
+        const float dist2 = (closestPointOnTriangle(point, t[0], t[1], t[2], coords) - point).length2();
+        if (dist2 <= best_dist2)
+        {
+          best_triangle = previous_triangle;
+          best_dist2 = dist2;
+        }
+      }
+
+      closestTriangle(point, stack, best_triangle, best_dist2, coords);
+      if (best_triangle != INVALID_TRIANGLE)
+      {
+        faces[i] = lvr2::FaceHandle(face_indices[best_triangle]);
+        barycentric_coords[i] = coords;
+        dists[i] = std::sqrt(best_dist2);
+        previous_triangle = best_triangle;
+      }
+    }
+  }
+}
+
+void FaceBVH::closestTriangle(const Vector& point, std::vector<uint32_t>& stack, uint32_t& best_triangle,
+                              float& best_dist2, std::array<float, 3>& barycentric_coords) const
+{
+  if (nodes.empty())
+    return;
+
+  stack.clear();
+  stack.push_back(0);
+  while (!stack.empty())
+  {
+    const uint32_t node_index = stack.back();
+    const Node& node = nodes[node_index];
+    stack.pop_back();
+    if (boxDistance2(node.bb_min, node.bb_max, point) > best_dist2)
+      continue;
+
+    if (node.count > 0)
+    {
+      for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+      {
+        const std::array<Vector, 3>& t = triangles[i];
+        std::array<float, 3> coords;
+        const float dist2 = (closestPointOnTriangle(point, t[0], t[1], t[2], coords) - point).length2();
+        if (dist2 <= best_dist2 && (dist2 < best_dist2 || best_triangle == INVALID_TRIANGLE))
+        {
+          best_dist2 = dist2;
+          best_triangle = i;
+          barycentric_coords = coords;
+        }
+      }
+      continue;
+    }
+
+    // visit the nearer child first
+    const uint32_t left = node_index + 1;
+    const uint32_t right = node.offset;
+    const float left_dist2 = boxDistance2(nodes[left].bb_min, nodes[left].bb_max, point);
+    const float right_dist2 = boxDistance2(nodes[right].bb_min, nodes[right].bb_max, point);
+    if (left_dist2 <= right_dist2)
+    {
+      if (right_dist2 <= best_dist2)
+        stack.push_back(right);
+      if (left_dist2 <= best_dist2)
+        stack.push_back(left);
+    }
+    else
+    {
+      if (left_dist2 <= best_dist2)
+        stack.push_back(left);
+      if (right_dist2 <= best_dist2)
+        stack.push_back(right);
+    }
+  }
+}
+
+bool FaceBVH::intersectRay(const Vector& origin, const Vector& direction, const float max_dist,
+                           lvr2::FaceHandle& face, std::array<float, 3>& barycentric_coords, float& t) const
+{
+  if (nodes.empty())
+    return false;
+
+  const float epsilon = 1e-8;
+  const Vector inv_direction(1 / direction.x, 1 / direction.y, 1 / direction.z);
+  float best_t = max_dist;
+  bool found = false;
+
+  std::vector<uint32_t> stack;
+  stack.reserve(64);
+  float t_enter;
+  if (intersectBox(nodes[0].bb_min, nodes[0].bb_max, origin, inv_direction, best_t, t_enter))
+    stack.push_back(0);
+
+  while (!stack.empty())
+  {
+    const uint32_t node_index = stack.back();
+    const Node& node = nodes[node_index];
+    stack.pop_back();
+
+    if (node.count > 0)
+    {
+      // Moeller-Trumbore ray triangle intersection
+      for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+      {
+        const std::array<Vector, 3>& v = triangles[i];
+        const Vector e1 = v[1] - v[0];
+        const Vector e2 = v[2] - v[0];
+        const Vector p = direction.cross(e2);
+        const float det = e1.dot(p);
+        if (std::fabs(det) < epsilon)
+          continue;
+
+        const float inv_det = 1 / det;
+        const Vector s = origin - v[0];
+        const float u = s.dot(p) * inv_det;
+        if (u < 0 || u > 1)
+          continue;
+
+        const Vector q = s.cross(e1);
+        const float w = direction.dot(q) * inv_det;
+        if (w < 0 || u + w > 1)
+          continue;
+
+        const float hit_t = e2.dot(q) * inv_det;
+        if (hit_t >= 0 && hit_t <= best_t)
+        {
+          best_t = hit_t;
+          face = lvr2::FaceHandle(face_indices[i]);
+          barycentric_coords = { 1 - u - w, u, w };
+          found = true;
+        }
+      }
+      continue;
+    }
+
+    // visit the child which is entered first, first
+    const uint32_t left = node_index + 1;
+    const uint32_t right = node.offset;
+    float left_t, right_t;
+    const bool left_hit = intersectBox(nodes[left].bb_min, nodes[left].bb_max, origin, inv_direction, best_t, left_t);
+    const bool right_hit =
+        intersectBox(nodes[right].bb_min, nodes[right].bb_max, origin, inv_direction, best_t, right_t);
+    if (left_hit && right_hit)
+    {
+      stack.push_back(left_t <= right_t ? right : left);
+      stack.push_back(left_t <= right_t ? left : right);
+    }
+    else if (left_hit)
+    {
+      stack.push_back(left);
+    }
+    else if (right_hit)
+    {
+      stack.push_back(right);
+    }
+  }
+
+  if (found)
+    t = best_t;
+  return found;
+}
+
+} /* namespace mesh_map */
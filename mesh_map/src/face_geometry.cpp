@@ -0,0 +1,75 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+#include <mesh_map/face_geometry.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace mesh_map
+{
+FaceGeometry::FaceGeometry()
+{
+}
+
+void FaceGeometry::build(const std::vector<float>& face_edge_weights)
+{
+  corners.resize(face_edge_weights.size());
+
+#pragma omp parallel for
+  for (size_t i = 0; i < face_edge_weights.size(); i++)
+  {
+    // the k-th face edge connects the k-th and the (k+1 mod 3)-th vertex
+    const size_t f = i - i % 3;
+    const size_t k = i % 3;
+    const double a = face_edge_weights[f + (k + 2) % 3];
+    const double b = face_edge_weights[f + k];
+    const double c = face_edge_weights[f + (k + 1) % 3];
+    const double p = (b * b + c * c - a * a) / (2 * c);
+
+    TriangleCorner& corner = corners[i];
+    corner.a = a;
+    corner.b = b;
+    corner.c = c;
+    corner.inv_two_c = 1 / (2 * c);
+    corner.p = p;
+    corner.hc = std::sqrt(std::max(b * b - p * p, 0.0));
+    corner.cos_theta0 = (a * a + b * b - c * c) / (2 * a * b);
+  }
+}
+
+} /* namespace mesh_map */
@@ -39,7 +39,11 @@
 #include <boost/uuid/random_generator.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_io.hpp>
+#include <cstdio>
+#include <cstring>
 #include <functional>
+#include <future>
+#include <iterator>
 #include <geometry_msgs/PointStamped.h>
 #include <geometry_msgs/Vector3.h>
 #include <visualization_msgs/MarkerArray.h>
@@ -49,6 +53,7 @@
 #include <lvr2/algorithm/GeometryAlgorithms.hpp>
 #include <lvr2/algorithm/NormalAlgorithms.hpp>
 #include <lvr2/io/hdf5/MeshIO.hpp>
+#include <mesh_map/binary_map.h>
 #include <mesh_map/mesh_map.h>
 #include <mesh_map/util.h>
 #include <mesh_msgs/MeshGeometryStamped.h>
@@ -62,6 +67,28 @@ namespace mesh_map
 using HDF5MeshIO = lvr2::Hdf5IO<lvr2::hdf5features::ArrayIO, lvr2::hdf5features::ChannelIO,
                                 lvr2::hdf5features::VariantChannelIO, lvr2::hdf5features::MeshIO>;
 
+//! maximum number of released vector maps which are kept to be recycled for new vector fields
+static const size_t MAX_RECYCLED_VECTOR_MAPS = 4;
+
+//! maximum number of points in a leaf of the k-d tree
+static const size_t KD_TREE_LEAF_SIZE = 10;
+
+//! magic bytes at the beginning of each k-d tree file
+static const char KD_TREE_FILE_MAGIC[8] = { 'M', 'E', 'S', 'H', 'K', 'D', 'T', '\0' };
+
+//! format version of the k-d tree file, has to be increased if the indexed points or the nanoflann layout change
+static const uint32_t KD_TREE_FILE_VERSION = 2;
+
+//! header of the k-d tree file, followed by the index written by nanoflann
+struct KDTreeFileHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t leaf_size;
+  uint64_t mesh_hash;
+  uint64_t num_points;
+};
+
 MeshMap::MeshMap(tf2_ros::Buffer& tf_listener)
   : tf_buffer(tf_buffer)
   , private_nh("~/mesh_map/")
@@ -69,6 +96,11 @@ MeshMap::MeshMap(tf2_ros::Buffer& tf_listener)
   , map_loaded(false)
   , layer_loader("mesh_map", "mesh_map::AbstractLayer")
   , mesh_ptr(new lvr2::HalfEdgeMesh<Vector>())
+  , compact_mesh_ptr(new CompactMesh())
+  , costs_version(0)
+  , vector_field_version(0)
+  , vector_map_pool(std::make_shared<VectorMapPool>())
+  , mesh_hash(FNV_OFFSET_BASIS)
 {
   private_nh.param<std::string>("server_url", srv_url, "");
   private_nh.param<std::string>("server_username", srv_username, "");
@@ -87,6 +119,8 @@ MeshMap::MeshMap(tf2_ros::Buffer& tf_listener)
 
   private_nh.param<std::string>("mesh_file", mesh_file, "");
   private_nh.param<std::string>("mesh_part", mesh_part, "");
+  private_nh.param<std::string>("binary_map_file", binary_map_file, "");
+  private_nh.param<std::string>("kd_tree_file", kd_tree_file, mesh_file.empty() ? "" : mesh_file + ".kdtree");
   private_nh.param<std::string>("global_frame", global_frame, "map");
   ROS_INFO_STREAM("mesh file is set to: " << mesh_file);
 
@@ -142,26 +176,66 @@ bool MeshMap::readMap()
     ROS_INFO_STREAM("Start reading the mesh part '" << mesh_part << "' from the map file '" << mesh_file << "'...");
   }
 
-  auto mesh_opt = mesh_io_ptr->getMesh();
+  // the binary map file mirrors a map file, it is not used with the mesh server
+  const bool use_binary_map = !server && !binary_map_file.empty();
+  const bool binary_map_loaded = use_binary_map && readBinaryMap();
 
-  if (mesh_opt)
+  if (!binary_map_loaded)
   {
-    *mesh_ptr = mesh_opt.get();
-    ROS_INFO_STREAM("The mesh has been loaded successfully with " << mesh_ptr->numVertices() << " vertices and "
-                                                                  << mesh_ptr->numFaces() << " faces and "
-                                                                  << mesh_ptr->numEdges() << " edges.");
+    auto mesh_opt = mesh_io_ptr->getMesh();
 
-    adaptor_ptr = std::make_unique<NanoFlannMeshAdaptor>(*mesh_ptr);
-    kd_tree_ptr = std::make_unique<KDTree>(3,*adaptor_ptr, nanoflann::KDTreeSingleIndexAdaptorParams(10));
-    kd_tree_ptr->buildIndex();
-    ROS_INFO_STREAM("The k-d tree has been build successfully!");
+    if (mesh_opt)
+    {
+      *mesh_ptr = mesh_opt.get();
+      ROS_INFO_STREAM("The mesh has been loaded successfully with " << mesh_ptr->numVertices() << " vertices and "
+                                                                    << mesh_ptr->numFaces() << " faces and "
+                                                                    << mesh_ptr->numEdges() << " edges.");
+
+      // hash the geometry to identify the cached layer data of this mesh
+      mesh_hash = FNV_OFFSET_BASIS;
+      for (auto vH : mesh_ptr->vertices())
+      {
+        const Vector& position = mesh_ptr->getVertexPosition(vH);
+        const std::array<float, 3> coordinates = { position.x, position.y, position.z };
+        const lvr2::Index index = vH.idx();
+        mesh_hash = fnv1a(&index, sizeof(index), mesh_hash);
+        mesh_hash = fnv1a(coordinates.data(), sizeof(coordinates), mesh_hash);
+      }
+      for (auto fH : mesh_ptr->faces())
+      {
+        const std::array<lvr2::VertexHandle, 3> vertices = mesh_ptr->getVerticesOfFace(fH);
+        const std::array<lvr2::Index, 3> indices = { vertices[0].idx(), vertices[1].idx(), vertices[2].idx() };
+        mesh_hash = fnv1a(indices.data(), sizeof(indices), mesh_hash);
+      }
+      ROS_INFO_STREAM("The mesh hash is " << std::hex << mesh_hash << std::dec << ".");
+    }
+    else
+    {
+      ROS_ERROR_STREAM("Could not load the mesh '" << mesh_part << "' from the map file '" << mesh_file << "' ");
+      return false;
+    }
   }
-  else
+
+  adaptor_ptr = std::make_unique<NanoFlannPackedMeshAdaptor>(*mesh_ptr);
+  kd_tree_ptr =
+      std::make_unique<KDTree>(3, *adaptor_ptr, nanoflann::KDTreeSingleIndexAdaptorParams(KD_TREE_LEAF_SIZE));
+  const bool use_kd_tree_file = !server && !kd_tree_file.empty();
+  if (!use_kd_tree_file || !readKDTree())
   {
-    ROS_ERROR_STREAM("Could not load the mesh '" << mesh_part << "' from the map file '" << mesh_file << "' ");
-    return false;
+    kd_tree_ptr->buildIndex();
+    ROS_INFO_STREAM("The k-d tree has been build successfully!");
+
+    if (use_kd_tree_file && writeKDTree())
+    {
+      ROS_INFO_STREAM("Saved the k-d tree to '" << kd_tree_file << "'.");
+    }
   }
 
+  ros::WallTime t_bvh_start = ros::WallTime::now();
+  face_bvh.build(*mesh_ptr);
+  ROS_INFO_STREAM("Built the face BVH with " << face_bvh.numNodes() << " nodes in "
+                                             << (ros::WallTime::now() - t_bvh_start).toNSec() * 1e-6 << " ms.");
+
   vertex_costs = lvr2::DenseVertexMap<float>(mesh_ptr->nextVertexIndex(), 0);
   edge_weights = lvr2::DenseEdgeMap<float>(mesh_ptr->nextEdgeIndex(), 0);
   invalid = lvr2::DenseVertexMap<bool>(mesh_ptr->nextVertexIndex(), false);
@@ -171,75 +245,93 @@ bool MeshMap::readMap()
   boost::uuids::uuid uuid = gen();
   uuid_str = boost::uuids::to_string(uuid);
 
-  auto face_normals_opt = mesh_io_ptr->getDenseAttributeMap<lvr2::DenseFaceMap<Normal>>("face_normals");
-
-  if (face_normals_opt)
+  if (!binary_map_loaded)
   {
-    face_normals = face_normals_opt.get();
-    ROS_INFO_STREAM("Found " << face_normals.numValues() << " face normals in map file.");
-  }
-  else
-  {
-    ROS_INFO_STREAM("No face normals found in the given map file, computing them...");
-    face_normals = lvr2::calcFaceNormals(*mesh_ptr);
-    ROS_INFO_STREAM("Computed " << face_normals.numValues() << " face normals.");
-    if (mesh_io_ptr->addDenseAttributeMap(face_normals, "face_normals"))
+    auto face_normals_opt = mesh_io_ptr->getDenseAttributeMap<lvr2::DenseFaceMap<Normal>>("face_normals");
+
+    if (face_normals_opt)
     {
-      ROS_INFO_STREAM("Saved face normals to map file.");
+      face_normals = face_normals_opt.get();
+      ROS_INFO_STREAM("Found " << face_normals.numValues() << " face normals in map file.");
     }
     else
     {
-      ROS_ERROR_STREAM("Could not save face normals to map file!");
+      ROS_INFO_STREAM("No face normals found in the given map file, computing them...");
+      face_normals = lvr2::calcFaceNormals(*mesh_ptr);
+      ROS_INFO_STREAM("Computed " << face_normals.numValues() << " face normals.");
+      if (mesh_io_ptr->addDenseAttributeMap(face_normals, "face_normals"))
+      {
+        ROS_INFO_STREAM("Saved face normals to map file.");
+      }
+      else
+      {
+        ROS_ERROR_STREAM("Could not save face normals to map file!");
+      }
     }
-  }
 
-  auto vertex_normals_opt = mesh_io_ptr->getDenseAttributeMap<lvr2::DenseVertexMap<Normal>>("vertex_normals");
+    auto vertex_normals_opt = mesh_io_ptr->getDenseAttributeMap<lvr2::DenseVertexMap<Normal>>("vertex_normals");
 
-  if (vertex_normals_opt)
-  {
-    vertex_normals = vertex_normals_opt.get();
-    ROS_INFO_STREAM("Found " << vertex_normals.numValues() << " vertex normals in map file!");
-  }
-  else
-  {
-    ROS_INFO_STREAM("No vertex normals found in the given map file, computing them...");
-    vertex_normals = lvr2::calcVertexNormals(*mesh_ptr, face_normals);
-    if (mesh_io_ptr->addDenseAttributeMap(vertex_normals, "vertex_normals"))
+    if (vertex_normals_opt)
     {
-      ROS_INFO_STREAM("Saved vertex normals to map file.");
+      vertex_normals = vertex_normals_opt.get();
+      ROS_INFO_STREAM("Found " << vertex_normals.numValues() << " vertex normals in map file!");
     }
     else
     {
-      ROS_ERROR_STREAM("Could not save vertex normals to map file!");
+      ROS_INFO_STREAM("No vertex normals found in the given map file, computing them...");
+      vertex_normals = lvr2::calcVertexNormals(*mesh_ptr, face_normals);
+      if (mesh_io_ptr->addDenseAttributeMap(vertex_normals, "vertex_normals"))
+      {
+        ROS_INFO_STREAM("Saved vertex normals to map file.");
+      }
+      else
+      {
+        ROS_ERROR_STREAM("Could not save vertex normals to map file!");
+      }
     }
   }
 
   mesh_geometry_pub.publish(mesh_msgs_conversions::toMeshGeometryStamped<float>(*mesh_ptr, global_frame, uuid_str, vertex_normals));
 
-  ROS_INFO_STREAM("Try to read edge distances from map file...");
-  auto edge_distances_opt = mesh_io_ptr->getAttributeMap<lvr2::DenseEdgeMap<float>>("edge_distances");
-
-  if (edge_distances_opt)
-  {
-    ROS_INFO_STREAM("Vertex distances have been read successfully.");
-    edge_distances = edge_distances_opt.get();
-  }
-  else
+  if (!binary_map_loaded)
   {
-    ROS_INFO_STREAM("Computing edge distances...");
-    edge_distances = lvr2::calcVertexDistances(*mesh_ptr);
-    ROS_INFO_STREAM("Saving " << edge_distances.numValues() << " edge distances to map file...");
+    ROS_INFO_STREAM("Try to read edge distances from map file...");
+    auto edge_distances_opt = mesh_io_ptr->getAttributeMap<lvr2::DenseEdgeMap<float>>("edge_distances");
 
-    if (mesh_io_ptr->addAttributeMap(edge_distances, "edge_distances"))
+    if (edge_distances_opt)
     {
-      ROS_INFO_STREAM("Saved edge distances to map file.");
+      ROS_INFO_STREAM("Vertex distances have been read successfully.");
+      edge_distances = edge_distances_opt.get();
     }
     else
     {
-      ROS_ERROR_STREAM("Could not save edge distances to map file!");
+      ROS_INFO_STREAM("Computing edge distances...");
+      edge_distances = lvr2::calcVertexDistances(*mesh_ptr);
+      ROS_INFO_STREAM("Saving " << edge_distances.numValues() << " edge distances to map file...");
+
+      if (mesh_io_ptr->addAttributeMap(edge_distances, "edge_distances"))
+      {
+        ROS_INFO_STREAM("Saved edge distances to map file.");
+      }
+      else
+      {
+        ROS_ERROR_STREAM("Could not save edge distances to map file!");
+      }
     }
+
+    ROS_INFO_STREAM("Build compact mesh snapshot...");
+    ros::WallTime t_compact_start = ros::WallTime::now();
+    compact_mesh_ptr = std::make_shared<CompactMesh>(*mesh_ptr, edge_distances);
+    ROS_INFO_STREAM("Built the compact mesh snapshot in " << (ros::WallTime::now() - t_compact_start).toNSec() * 1e-6
+                                                          << " ms.");
   }
 
+  for (auto vH : compact_mesh_ptr->invalidVertices())
+  {
+    invalid.insert(vH, true);
+  }
+  ROS_INFO_STREAM("Found " << compact_mesh_ptr->invalidVertices().size() << " invalid vertices.");
+
   ROS_INFO_STREAM("Load layer plugins...");
   if (!loadLayerPlugins())
   {
@@ -254,6 +346,16 @@ bool MeshMap::readMap()
     return false;
   }
 
+  // the layers may have been written to the map file, the binary map file is stamped with the resulting state of it
+  if (binary_map_loaded)
+  {
+    restampBinaryMap();
+  }
+  else if (use_binary_map && writeBinaryMap())
+  {
+    ROS_INFO_STREAM("Saved the binary map file '" << binary_map_file << "'.");
+  }
+
   sleep(1);
 
   combineVertexCosts();
@@ -264,6 +366,292 @@ bool MeshMap::readMap()
   return true;
 }
 
+bool MeshMap::readBinaryMap()
+{
+  ros::WallTime t_start = ros::WallTime::now();
+  BinaryMapFile map_file;
+  if (!map_file.open(binary_map_file))
+  {
+    ROS_INFO_STREAM("No valid binary map file found at '" << binary_map_file << "'.");
+    return false;
+  }
+
+  const BinaryMapFile::Header& header = map_file.header();
+  uint64_t source_size;
+  int64_t source_mtime;
+  size_t part_length;
+  const char* part = map_file.section<char>(BinaryMapFile::MESH_PART, part_length);
+  if (!BinaryMapFile::fileStamp(mesh_file, source_size, source_mtime) || header.source_size != source_size ||
+      header.source_mtime != source_mtime || !part || std::string(part, part_length) != mesh_part)
+  {
+    ROS_WARN_STREAM("The binary map file '" << binary_map_file << "' does not belong to the mesh part '" << mesh_part
+                                            << "' of the map file '" << mesh_file << "', ignoring it.");
+    return false;
+  }
+
+  size_t num_positions, num_face_indices, num_face_normals, num_vertex_normals;
+  const float* positions = map_file.section<float>(BinaryMapFile::VERTEX_POSITIONS, num_positions);
+  const lvr2::Index* face_indices = map_file.section<lvr2::Index>(BinaryMapFile::FACE_INDICES, num_face_indices);
+  const float* face_normal_values = map_file.section<float>(BinaryMapFile::FACE_NORMALS, num_face_normals);
+  const float* vertex_normal_values = map_file.section<float>(BinaryMapFile::VERTEX_NORMALS, num_vertex_normals);
+
+  CompactMesh::Ptr compact_mesh = std::make_shared<CompactMesh>();
+  if (!positions || !face_indices || !face_normal_values || !vertex_normal_values ||
+      num_positions != 3 * header.num_vertices || num_face_indices != 3 * header.num_faces ||
+      num_face_normals != 3 * header.num_faces || num_vertex_normals != 3 * header.num_vertices ||
+      !compact_mesh->read(map_file))
+  {
+    ROS_WARN_STREAM("The binary map file '" << binary_map_file << "' is incomplete, ignoring it.");
+    return false;
+  }
+
+  // the half-edge mesh is rebuilt from the vertices and face indices in the order of the map file, like lvr2 builds it
+  lvr2::HalfEdgeMesh<Vector> mesh;
+  try
+  {
+    for (size_t i = 0; i < header.num_vertices; i++)
+    {
+      mesh.addVertex(Vector(positions[3 * i], positions[3 * i + 1], positions[3 * i + 2]));
+    }
+    for (size_t i = 0; i < header.num_faces; i++)
+    {
+      if (face_indices[3 * i] >= header.num_vertices || face_indices[3 * i + 1] >= header.num_vertices ||
+          face_indices[3 * i + 2] >= header.num_vertices)
+      {
+        ROS_WARN_STREAM("The binary map file '" << binary_map_file << "' contains invalid faces, ignoring it.");
+        return false;
+      }
+      mesh.addFace(lvr2::VertexHandle(face_indices[3 * i]), lvr2::VertexHandle(face_indices[3 * i + 1]),
+                   lvr2::VertexHandle(face_indices[3 * i + 2]));
+    }
+  }
+  catch (lvr2::PanicException exception)
+  {
+    ROS_WARN_STREAM("Could not rebuild the mesh from the binary map file '" << binary_map_file << "', ignoring it.");
+    return false;
+  }
+
+  // the compact mesh and the stored maps are indexed by the handles of the original mesh, they are only valid if the
+  // rebuilt mesh reproduces every edge and face with the same vertices
+  bool same_topology = mesh.nextEdgeIndex() == header.num_edges && mesh.nextFaceIndex() == header.num_faces;
+  const std::vector<lvr2::Index>& edge_vertices = compact_mesh->edgeVertices();
+  for (auto eH : mesh.edges())
+  {
+    if (!same_topology)
+      break;
+    const auto vertices = mesh.getVerticesOfEdge(eH);
+    same_topology = vertices[0].idx() == edge_vertices[2 * eH.idx()] &&
+                    vertices[1].idx() == edge_vertices[2 * eH.idx() + 1];
+  }
+  const std::vector<lvr2::Index>& face_vertices = compact_mesh->faceVertices();
+  for (auto fH : mesh.faces())
+  {
+    if (!same_topology)
+      break;
+    const auto vertices = mesh.getVerticesOfFace(fH);
+    for (size_t k = 0; same_topology && k < 3; k++)
+    {
+      same_topology = vertices[k].idx() == face_vertices[3 * fH.idx() + k];
+    }
+  }
+  if (!same_topology)
+  {
+    ROS_WARN_STREAM("The mesh rebuilt from the binary map file '" << binary_map_file
+                                                                  << "' differs from the original one, ignoring it.");
+    return false;
+  }
+
+  face_normals = lvr2::DenseFaceMap<Normal>(header.num_faces, Normal());
+  for (auto fH : mesh.faces())
+  {
+    const float* n = &face_normal_values[3 * fH.idx()];
+    face_normals.insert(fH, Normal(n[0], n[1], n[2]));
+  }
+
+  vertex_normals = lvr2::DenseVertexMap<Normal>(header.num_vertices, Normal());
+  for (auto vH : mesh.vertices())
+  {
+    const float* n = &vertex_normal_values[3 * vH.idx()];
+    vertex_normals.insert(vH, Normal(n[0], n[1], n[2]));
+  }
+
+  edge_distances = lvr2::DenseEdgeMap<float>(header.num_edges, 0);
+  for (auto eH : mesh.edges())
+  {
+    edge_distances.insert(eH, compact_mesh->edgeDistances()[eH.idx()]);
+  }
+
+  *mesh_ptr = std::move(mesh);
+  compact_mesh_ptr = compact_mesh;
+  mesh_hash = header.mesh_hash;
+
+  ROS_INFO_STREAM("The mesh has been loaded from the binary map file in "
+                  << (ros::WallTime::now() - t_start).toNSec() * 1e-6 << " ms with " << mesh_ptr->numVertices()
+                  << " vertices and " << mesh_ptr->numFaces() << " faces and " << mesh_ptr->numEdges() << " edges.");
+  ROS_INFO_STREAM("The mesh hash is " << std::hex << mesh_hash << std::dec << ".");
+  return true;
+}
+
+bool MeshMap::writeBinaryMap()
+{
+  // deleted vertices or faces would shift the indices when the mesh is rebuilt from the binary map file
+  if (mesh_ptr->numVertices() != mesh_ptr->nextVertexIndex() || mesh_ptr->numFaces() != mesh_ptr->nextFaceIndex())
+  {
+    ROS_WARN_STREAM("The mesh contains deleted vertices or faces and can not be stored in a binary map file.");
+    return false;
+  }
+
+  uint64_t source_size;
+  int64_t source_mtime;
+  if (!BinaryMapFile::fileStamp(mesh_file, source_size, source_mtime))
+  {
+    ROS_ERROR_STREAM("Could not stat the map file '" << mesh_file << "'!");
+    return false;
+  }
+
+  std::vector<float> positions;
+  positions.reserve(3 * mesh_ptr->numVertices());
+  std::vector<float> vertex_normal_values;
+  vertex_normal_values.reserve(3 * mesh_ptr->numVertices());
+  for (auto vH : mesh_ptr->vertices())
+  {
+    const Vector& position = mesh_ptr->getVertexPosition(vH);
+    const Normal& normal = vertex_normals[vH];
+    positions.insert(positions.end(), { position.x, position.y, position.z });
+    vertex_normal_values.insert(vertex_normal_values.end(), { normal.x, normal.y, normal.z });
+  }
+
+  // the face indices are stored as in the map file, since the half-edge mesh returns the vertices of a face in another
+  // rotation, which would change the edge indices when the mesh is rebuilt
+  lvr2::IndexChannel face_indices;
+  if (!mesh_io_ptr->getIndices(face_indices) || face_indices.width() != 3 ||
+      face_indices.numElements() != mesh_ptr->numFaces())
+  {
+    ROS_WARN_STREAM("Could not read the face indices of the map file '" << mesh_file << "'.");
+    return false;
+  }
+
+  std::vector<float> face_normal_values;
+  face_normal_values.reserve(3 * mesh_ptr->numFaces());
+  for (auto fH : mesh_ptr->faces())
+  {
+    const Normal& normal = face_normals[fH];
+    face_normal_values.insert(face_normal_values.end(), { normal.x, normal.y, normal.z });
+  }
+
+  BinaryMapFile::Writer writer(mesh_hash, source_size, source_mtime, mesh_ptr->nextVertexIndex(),
+                               mesh_ptr->nextFaceIndex(), mesh_ptr->nextEdgeIndex());
+  writer.addSection(BinaryMapFile::MESH_PART, mesh_part.data(), mesh_part.size());
+  writer.addSection(BinaryMapFile::VERTEX_POSITIONS, positions.data(), positions.size());
+  writer.addSection(BinaryMapFile::FACE_INDICES, face_indices.dataPtr().get(), 3 * face_indices.numElements());
+  writer.addSection(BinaryMapFile::FACE_NORMALS, face_normal_values.data(), face_normal_values.size());
+  writer.addSection(BinaryMapFile::VERTEX_NORMALS, vertex_normal_values.data(), vertex_normal_values.size());
+  compact_mesh_ptr->write(writer);
+
+  if (!writer.write(binary_map_file))
+  {
+    ROS_ERROR_STREAM("Could not write the binary map file '" << binary_map_file << "'!");
+    return false;
+  }
+  return true;
+}
+
+void MeshMap::restampBinaryMap()
+{
+  // the mesh of the map file is not changed by the layers, only the stamp of the binary map file is outdated
+  uint64_t source_size;
+  int64_t source_mtime;
+  BinaryMapFile map_file;
+  if (!BinaryMapFile::fileStamp(mesh_file, source_size, source_mtime) || !map_file.open(binary_map_file))
+    return;
+
+  const BinaryMapFile::Header& header = map_file.header();
+  if (header.source_size == source_size && header.source_mtime == source_mtime)
+    return;
+  map_file.close();
+
+  if (BinaryMapFile::restamp(binary_map_file, source_size, source_mtime))
+    ROS_INFO_STREAM("Updated the map file stamp of the binary map file '" << binary_map_file << "'.");
+  else
+    ROS_WARN_STREAM("Could not update the binary map file '" << binary_map_file << "'!");
+}
+
+bool MeshMap::readKDTree()
+{
+  ros::WallTime t_start = ros::WallTime::now();
+  std::FILE* file = std::fopen(kd_tree_file.c_str(), "rb");
+  if (!file)
+  {
+    ROS_INFO_STREAM("No k-d tree file found at '" << kd_tree_file << "'.");
+    return false;
+  }
+
+  const size_t num_points = adaptor_ptr->kdtree_get_point_count();
+  KDTreeFileHeader header;
+  bool loaded = std::fread(&header, sizeof(header), 1, file) == 1 &&
+                std::memcmp(header.magic, KD_TREE_FILE_MAGIC, sizeof(KD_TREE_FILE_MAGIC)) == 0 &&
+                header.version == KD_TREE_FILE_VERSION && header.leaf_size == KD_TREE_LEAF_SIZE &&
+                header.mesh_hash == mesh_hash && header.num_points == num_points;
+
+  if (loaded)
+  {
+    try
+    {
+      kd_tree_ptr->loadIndex(file);
+      loaded = kd_tree_ptr->m_size == num_points && kd_tree_ptr->vind.size() == num_points &&
+               (num_points == 0 || kd_tree_ptr->root_node);
+    }
+    catch (std::exception& exception)
+    {
+      loaded = false;
+    }
+  }
+  std::fclose(file);
+
+  if (!loaded)
+  {
+    ROS_WARN_STREAM("The k-d tree file '" << kd_tree_file << "' does not belong to the current mesh, ignoring it.");
+    // drop the partially loaded index
+    kd_tree_ptr =
+      std::make_unique<KDTree>(3, *adaptor_ptr, nanoflann::KDTreeSingleIndexAdaptorParams(KD_TREE_LEAF_SIZE));
+    return false;
+  }
+
+  ROS_INFO_STREAM("The k-d tree has been loaded from '" << kd_tree_file << "' in "
+                                                        << (ros::WallTime::now() - t_start).toNSec() * 1e-6 << " ms.");
+  return true;
+}
+
+bool MeshMap::writeKDTree()
+{
+  // write to a temporary file first, an interrupted write never leaves a broken k-d tree file behind
+  const std::string tmp_path = kd_tree_file + ".tmp";
+  std::FILE* file = std::fopen(tmp_path.c_str(), "wb");
+  if (!file)
+  {
+    ROS_ERROR_STREAM("Could not open the k-d tree file '" << kd_tree_file << "' for writing!");
+    return false;
+  }
+
+  KDTreeFileHeader header;
+  std::memcpy(header.magic, KD_TREE_FILE_MAGIC, sizeof(KD_TREE_FILE_MAGIC));
+  header.version = KD_TREE_FILE_VERSION;
+  header.leaf_size = KD_TREE_LEAF_SIZE;
+  header.mesh_hash = mesh_hash;
+  header.num_points = adaptor_ptr->kdtree_get_point_count();
+
+  std::fwrite(&header, sizeof(header), 1, file);
+  kd_tree_ptr->saveIndex(file);
+  const bool written = !std::ferror(file);
+  if (std::fclose(file) != 0 || !written || std::rename(tmp_path.c_str(), kd_tree_file.c_str()) != 0)
+  {
+    std::remove(tmp_path.c_str());
+    ROS_ERROR_STREAM("Could not write the k-d tree file '" << kd_tree_file << "'!");
+    return false;
+  }
+  return true;
+}
+
 bool MeshMap::loadLayerPlugins()
 {
   XmlRpc::XmlRpcValue plugin_param_list;
@@ -338,7 +726,8 @@ void MeshMap::layerChanged(const std::string& layer_name)
 
   ROS_INFO_STREAM("Layer \"" << layer_name << "\" changed.");
 
-  lethals.clear();
+  std::set<lvr2::VertexHandle> previous_lethals;
+  previous_lethals.swap(lethals);
 
   ROS_INFO_STREAM("Combine underlining lethal sets...");
 
@@ -352,9 +741,22 @@ void MeshMap::layerChanged(const std::string& layer_name)
       break;
   }
 
-  vertex_costs_pub.publish(mesh_msgs_conversions::toVertexCostsStamped(layer_iter->second->costs(), mesh_ptr->numVertices(),
-                                                         layer_iter->second->defaultValue(), layer_iter->first,
-                                                         global_frame, uuid_str));
+  // the layer may restrict the change to a set of dirty vertices
+  std::vector<lvr2::VertexHandle> dirty_vertices;
+  bool partial = layer_iter->second->takeDirtyVertices(dirty_vertices);
+
+  // following layers depending on the lethals only have to be updated if the lethals of the changed layer changed
+  auto& layer_lethals = lethal_indices[layer_name];
+  const bool lethals_changed = layer_lethals != layer_iter->second->lethals();
+  if (lethals_changed)
+    layer_lethals = layer_iter->second->lethals();
+
+  // the cost messages always contain all vertices, they are only converted for subscribers
+  const bool publish_costs = vertex_costs_pub.getNumSubscribers() > 0;
+  if (publish_costs)
+    vertex_costs_pub.publish(mesh_msgs_conversions::toVertexCostsStamped(
+        layer_iter->second->costs(), mesh_ptr->numVertices(), layer_iter->second->defaultValue(), layer_iter->first,
+        global_frame, uuid_str));
 
   if (layer_iter != layers.end())
     layer_iter++;
@@ -363,19 +765,42 @@ void MeshMap::layerChanged(const std::string& layer_name)
 
   for (; layer_iter != layers.end(); layer_iter++)
   {
-    layer_iter->second->updateLethal(lethals, lethals);
+    if (lethals_changed)
+    {
+      // the layer recomputed its costs, which may have changed at any vertex unless it reports the changed ones
+      std::vector<lvr2::VertexHandle> changed_vertices;
+      const bool reported = layer_iter->second->updateLethalTracked(lethals, lethals, changed_vertices);
+      if (layer_iter->second->dependsOnLethals())
+      {
+        if (reported)
+          dirty_vertices.insert(dirty_vertices.end(), changed_vertices.begin(), changed_vertices.end());
+        else
+          partial = false;
+      }
+    }
 
     lethals.insert(layer_iter->second->lethals().begin(), layer_iter->second->lethals().end());
 
-    vertex_costs_pub.publish(mesh_msgs_conversions::toVertexCostsStamped(layer_iter->second->costs(), mesh_ptr->numVertices(),
-                                                           layer_iter->second->defaultValue(), layer_iter->first,
-                                                           global_frame, uuid_str));
+    if (publish_costs)
+      vertex_costs_pub.publish(mesh_msgs_conversions::toVertexCostsStamped(
+          layer_iter->second->costs(), mesh_ptr->numVertices(), layer_iter->second->defaultValue(), layer_iter->first,
+          global_frame, uuid_str));
   }
 
   ROS_INFO_STREAM("Found " << lethals.size() << " lethal vertices");
   ROS_INFO_STREAM("Combine layer costs...");
 
-  combineVertexCosts();
+  if (partial)
+  {
+    // vertices which became lethal or non-lethal change their costs as well
+    std::set_symmetric_difference(previous_lethals.begin(), previous_lethals.end(), lethals.begin(), lethals.end(),
+                                  std::back_inserter(dirty_vertices));
+    combineVertexCosts(std::move(dirty_vertices));
+  }
+  else
+  {
+    combineVertexCosts();
+  }
   // TODO new lethals old lethals -> renew potential field! around this areas
 }
 
@@ -398,12 +823,41 @@ bool MeshMap::initLayerPlugins()
       ROS_ERROR_STREAM("Could not initialize the layer plugin with the name \"" << layer_name << "\"!");
       return false;
     }
+  }
+
+  // Layers which do not depend on the lethals of the previous layers are computed in parallel, if they could not be
+  // read from the map file. The map file is only accessed from this thread.
+  std::vector<std::future<bool>> computations(layers.size());
+  for (size_t i = 0; i < layers.size(); i++)
+  {
+    auto& layer_plugin = layers[i].second;
+    if (layer_plugin->dependsOnLethals() || layer_plugin->readLayer())
+      continue;
 
-    std::set<lvr2::VertexHandle> empty;
-    layer_plugin->updateLethal(lethals, empty);
-    if (!layer_plugin->readLayer())
+    ROS_INFO_STREAM("Start computing the layer \"" << layers[i].first << "\" in parallel.");
+    computations[i] = std::async(std::launch::async, [&layer_plugin]() { return layer_plugin->computeLayer(); });
+  }
+
+  // process the layers in their configured order to merge the lethal sets deterministically
+  for (size_t i = 0; i < layers.size(); i++)
+  {
+    auto& layer_plugin = layers[i].second;
+    const auto& layer_name = layers[i].first;
+
+    if (layer_plugin->dependsOnLethals())
     {
-      layer_plugin->computeLayer();
+      // the layer computes its costs from the current lethals, it is neither read from nor written to the map file
+      std::set<lvr2::VertexHandle> empty;
+      layer_plugin->updateLethal(lethals, empty);
+      if (!layer_plugin->computeLayer())
+        ROS_WARN_STREAM("Could not compute the layer \"" << layer_name << "\"!");
+    }
+    else if (computations[i].valid())
+    {
+      if (computations[i].get())
+        layer_plugin->writeLayer();
+      else
+        ROS_WARN_STREAM("Could not compute the layer \"" << layer_name << "\"!");
     }
 
     lethal_indices[layer_name].insert(layer_plugin->lethals().begin(), layer_plugin->lethals().end());
@@ -415,87 +869,351 @@ bool MeshMap::initLayerPlugins()
 void MeshMap::combineVertexCosts()
 {
   ROS_INFO_STREAM("Combining costs...");
+  ros::WallTime t_start = ros::WallTime::now();
 
-  float combined_min = std::numeric_limits<float>::max();
-  float combined_max = std::numeric_limits<float>::min();
+  const lvr2::Index num_vertices = mesh_ptr->nextVertexIndex();
+  const lvr2::Index num_edges = compact_mesh_ptr->numEdges();
 
-  vertex_costs = lvr2::DenseVertexMap<float>(mesh_ptr->nextVertexIndex(), 0);
+  // the layer costs are summed up in contiguous arrays, skipping the deleted vertices of the mesh
+  std::vector<uint8_t> contained(num_vertices);
+  std::vector<float> combined_costs(num_vertices, 0);
+  std::vector<float> layer_costs(num_vertices);
+
+#pragma omp parallel for
+  for (lvr2::Index i = 0; i < num_vertices; i++)
+  {
+    contained[i] = mesh_ptr->containsVertex(lvr2::VertexHandle(i));
+  }
 
-  bool hasNaN = false;
   for (auto layer : layers)
   {
     const auto& costs = layer.second->costs();
-    float min, max;
-    mesh_map::getMinMax(costs, min, max);
-    const float norm = max - min;
     const float factor = private_nh.param<float>(layer.first + "/factor", 1.0);
-    const float norm_factor = factor / norm;
-    ROS_INFO_STREAM("Layer \"" << layer.first << "\" max value: " << max << " min value: " << min << " norm: " << norm
-                               << " factor: " << factor << " norm factor: " << norm_factor);
-
     const float default_value = layer.second->defaultValue();
-    hasNaN = false;
-    for (auto vH : mesh_ptr->vertices())
+
+    float min = std::numeric_limits<float>::max();
+    float max = std::numeric_limits<float>::min();
+    bool has_nan = false;
+
+    // the layer costs can only be accessed through the vertex handles, gather them into a contiguous array
+#pragma omp parallel for reduction(min : min) reduction(max : max) reduction(|| : has_nan)
+    for (lvr2::Index i = 0; i < num_vertices; i++)
     {
-      const float cost = costs.containsKey(vH) ? costs[vH] : default_value;
-      if (std::isnan(cost))
-        hasNaN = true;
-      vertex_costs[vH] += factor * cost;
-      if (std::isfinite(cost))
+      const lvr2::VertexHandle vH(i);
+      if (!contained[i])
+      {
+        layer_costs[i] = 0;
+        continue;
+      }
+
+      if (costs.containsKey(vH))
+      {
+        const float cost = costs[vH];
+        layer_costs[i] = cost;
+        if (std::isfinite(cost))
+        {
+          min = std::min(min, cost);
+          max = std::max(max, cost);
+        }
+      }
+      else
       {
-        combined_max = std::max(combined_max, vertex_costs[vH]);
-        combined_min = std::min(combined_min, vertex_costs[vH]);
+        layer_costs[i] = default_value;
       }
+      has_nan = has_nan || std::isnan(layer_costs[i]);
     }
-    if (hasNaN)
+
+    const float norm = max - min;
+    const float norm_factor = factor / norm;
+    ROS_INFO_STREAM("Layer \"" << layer.first << "\" max value: " << max << " min value: " << min << " norm: " << norm
+                               << " factor: " << factor << " norm factor: " << norm_factor);
+    if (has_nan)
       ROS_ERROR_STREAM("Layer \"" << layer.first << "\" contains NaN values!");
-  }
 
-  const float combined_norm = combined_max - combined_min;
+#pragma omp parallel for simd
+    for (lvr2::Index i = 0; i < num_vertices; i++)
+    {
+      combined_costs[i] += factor * layer_costs[i];
+    }
+  }
 
   for (auto vH : lethals)
   {
-    vertex_costs[vH] = std::numeric_limits<float>::infinity();
+    combined_costs[vH.idx()] = std::numeric_limits<float>::infinity();
   }
 
-  vertex_costs_pub.publish(mesh_msgs_conversions::toVertexCostsStamped(vertex_costs, "Combined Costs", global_frame, uuid_str));
+  // write back the combined costs and flag the vertices whose costs changed
+  std::vector<uint8_t> changed_vertices(num_vertices, 0);
+#pragma omp parallel for
+  for (lvr2::Index i = 0; i < num_vertices; i++)
+  {
+    if (!contained[i])
+      continue;
 
-  hasNaN = false;
+    const lvr2::VertexHandle vH(i);
+    const float previous = vertex_costs[vH];
+    const float current = combined_costs[i];
+    changed_vertices[i] = previous != current && !(std::isnan(previous) && std::isnan(current));
+    vertex_costs[vH] = current;
+  }
+
+  // the cost message always contains all vertices, it is only converted for subscribers
+  if (vertex_costs_pub.getNumSubscribers() > 0)
+    vertex_costs_pub.publish(
+        mesh_msgs_conversions::toVertexCostsStamped(vertex_costs, "Combined Costs", global_frame, uuid_str));
 
   ROS_INFO_STREAM("Layer weighting factor is: " << config.layer_factor);
-  for (auto eH : mesh_ptr->edges())
+
+  const float layer_factor = config.layer_factor;
+  const auto& edge_vertices = compact_mesh_ptr->edgeVertices();
+  const auto& distances = compact_mesh_ptr->edgeDistances();
+  std::vector<float> weights(num_edges, std::numeric_limits<float>::infinity());
+  std::vector<uint8_t> changed_edges(num_edges, 0);
+  size_t nan_weights = 0;
+
+#pragma omp parallel for reduction(+ : nan_weights)
+  for (lvr2::Index i = 0; i < num_edges; i++)
   {
     // Get both Vertices of the current Edge
-    std::array<lvr2::VertexHandle, 2> eH_vHs = mesh_ptr->getVerticesOfEdge(eH);
-    const lvr2::VertexHandle& vH1 = eH_vHs[0];
-    const lvr2::VertexHandle& vH2 = eH_vHs[1];
-    // Get the Riskiness for the current Edge (the maximum value from both
-    // Vertices)
-    if (config.layer_factor != 0)
+    const lvr2::Index v1 = edge_vertices[2 * i];
+    const lvr2::Index v2 = edge_vertices[2 * i + 1];
+    if (v1 == CompactMesh::INVALID_INDEX || v2 == CompactMesh::INVALID_INDEX)
+      continue;
+
+    // Weight the edge by the cost difference of both vertices, edges to lethal vertices keep their distance
+    float weight = distances[i];
+    if (layer_factor != 0 && !std::isinf(combined_costs[v1]) && !std::isinf(combined_costs[v2]))
     {
-      if (std::isinf(vertex_costs[vH1]) || std::isinf(vertex_costs[vH2]))
+      const float vertex_factor = layer_factor * std::fabs(combined_costs[v1] - combined_costs[v2]);
+      if (std::isnan(vertex_factor))
+        nan_weights++;
+      weight = distances[i] * (1 + vertex_factor);
+    }
+    weights[i] = weight;
+
+    const lvr2::EdgeHandle eH(i);
+    changed_edges[i] = weight != edge_weights[eH];
+    edge_weights[eH] = weight;
+  }
+
+  if (nan_weights > 0)
+    ROS_INFO_STREAM("Found " << nan_weights << " edges with NaN weights.");
+
+  compact_mesh_ptr->updateEdgeWeights(weights);
+
+  CostChanges changes;
+  for (lvr2::Index i = 0; i < num_vertices; i++)
+  {
+    if (changed_vertices[i])
+      changes.vertices.push_back(lvr2::VertexHandle(i));
+  }
+  for (lvr2::Index i = 0; i < num_edges; i++)
+  {
+    if (changed_edges[i])
+      changes.edges.push_back(lvr2::EdgeHandle(i));
+  }
+  recordCostChanges(changes);
+  publishCostSnapshot(changes);
+
+  ROS_INFO_STREAM("Successfully combined costs in " << (ros::WallTime::now() - t_start).toSec() * 1e3 << " ms!");
+}
+
+void MeshMap::combineVertexCosts(std::vector<lvr2::VertexHandle> dirty_vertices)
+{
+  ROS_INFO_STREAM("Combining costs of " << dirty_vertices.size() << " dirty vertices...");
+  ros::WallTime t_start = ros::WallTime::now();
+
+  std::sort(dirty_vertices.begin(), dirty_vertices.end(),
+            [](const lvr2::VertexHandle& a, const lvr2::VertexHandle& b) { return a.idx() < b.idx(); });
+  dirty_vertices.erase(std::unique(dirty_vertices.begin(), dirty_vertices.end()), dirty_vertices.end());
+
+  std::vector<float> factors;
+  for (auto layer : layers)
+  {
+    factors.push_back(private_nh.param<float>(layer.first + "/factor", 1.0));
+  }
+
+  // recompute the combined costs of the dirty vertices in the same order as the full combination
+  std::vector<uint8_t> changed_vertices(dirty_vertices.size(), 0);
+#pragma omp parallel for
+  for (size_t i = 0; i < dirty_vertices.size(); i++)
+  {
+    const lvr2::VertexHandle& vH = dirty_vertices[i];
+    if (!mesh_ptr->containsVertex(vH))
+      continue;
+
+    float combined = 0;
+    if (lethals.find(vH) != lethals.end())
+    {
+      combined = std::numeric_limits<float>::infinity();
+    }
+    else
+    {
+      for (size_t l = 0; l < layers.size(); l++)
       {
-        edge_weights[eH] = edge_distances[eH];
-        // edge_weights[eH] = std::numeric_limits<float>::infinity();
+        const auto& costs = layers[l].second->costs();
+        combined += factors[l] * (costs.containsKey(vH) ? costs[vH] : layers[l].second->defaultValue());
       }
-      else
-      {
-        float cost_diff = std::fabs(vertex_costs[vH1] - vertex_costs[vH2]);
+    }
 
-        float vertex_factor = config.layer_factor * cost_diff;
-        if (std::isnan(vertex_factor))
-          ROS_INFO_STREAM("NaN: v1:" << vertex_costs[vH1] << " v2:" << vertex_costs[vH2]
-                                     << " vertex_factor:" << vertex_factor << " cost_diff:" << cost_diff);
-        edge_weights[eH] = edge_distances[eH] * (1 + vertex_factor);
-      }
+    const float previous = vertex_costs[vH];
+    changed_vertices[i] = previous != combined && !(std::isnan(previous) && std::isnan(combined));
+    vertex_costs[vH] = combined;
+  }
+
+  CostChanges changes;
+  for (size_t i = 0; i < dirty_vertices.size(); i++)
+  {
+    if (changed_vertices[i])
+      changes.vertices.push_back(dirty_vertices[i]);
+  }
+
+  // collect the edges incident to the changed vertices
+  const auto& edge_vertices = compact_mesh_ptr->edgeVertices();
+  const auto& distances = compact_mesh_ptr->edgeDistances();
+  const auto& neighbour_edges = compact_mesh_ptr->neighbourEdges();
+  std::vector<lvr2::Index> dirty_edges;
+  for (const auto& vH : changes.vertices)
+  {
+    const lvr2::Index neighbours_end = compact_mesh_ptr->neighboursEnd(vH);
+    for (lvr2::Index i = compact_mesh_ptr->neighboursBegin(vH); i < neighbours_end; i++)
+    {
+      dirty_edges.push_back(neighbour_edges[i]);
     }
-    else
+  }
+  std::sort(dirty_edges.begin(), dirty_edges.end());
+  dirty_edges.erase(std::unique(dirty_edges.begin(), dirty_edges.end()), dirty_edges.end());
+
+  const float layer_factor = config.layer_factor;
+  for (const auto& e : dirty_edges)
+  {
+    const lvr2::EdgeHandle eH(e);
+    const float c1 = vertex_costs[lvr2::VertexHandle(edge_vertices[2 * e])];
+    const float c2 = vertex_costs[lvr2::VertexHandle(edge_vertices[2 * e + 1])];
+
+    // same weighting as in the full combination
+    float weight = distances[e];
+    if (layer_factor != 0 && !std::isinf(c1) && !std::isinf(c2))
+      weight = distances[e] * (1 + layer_factor * std::fabs(c1 - c2));
+
+    if (weight != edge_weights[eH])
     {
-      edge_weights[eH] = edge_distances[eH];
+      changes.edges.push_back(eH);
+      edge_weights[eH] = weight;
+      compact_mesh_ptr->updateEdgeWeight(eH, weight);
     }
   }
 
-  ROS_INFO("Successfully combined costs!");
+  ROS_INFO_STREAM("Updated the costs of " << changes.vertices.size() << " vertices and the weights of "
+                                          << changes.edges.size() << " edges.");
+  recordCostChanges(changes);
+  publishCostSnapshot(changes);
+
+  // the cost message always contains all vertices, it is only converted for subscribers
+  if (vertex_costs_pub.getNumSubscribers() > 0)
+    vertex_costs_pub.publish(
+        mesh_msgs_conversions::toVertexCostsStamped(vertex_costs, "Combined Costs", global_frame, uuid_str));
+
+  ROS_INFO_STREAM("Successfully combined costs in " << (ros::WallTime::now() - t_start).toSec() * 1e3 << " ms!");
+}
+
+void MeshMap::recordCostChanges(CostChanges& changes)
+{
+  std::lock_guard<std::mutex> lock(cost_changes_mtx);
+  changes.version = ++costs_version;
+
+  // if large parts of the map changed, recomputing everything is cheaper than incremental updates
+  if (changes.vertices.size() > mesh_ptr->numVertices() / 2)
+  {
+    ROS_INFO_STREAM("The costs of " << changes.vertices.size() << " vertices changed, dropping the cost changes.");
+    cost_changes.clear();
+    return;
+  }
+
+  cost_changes.push_back(changes);
+  while (cost_changes.size() > MAX_COST_CHANGES)
+    cost_changes.pop_front();
+}
+
+void MeshMap::publishCostSnapshot(const CostChanges& changes)
+{
+  // the copy is made outside of any lock, readers keep using the previous snapshot until the pointer is swapped. Only
+  // the blocks containing changed vertices or edges are copied, the others are shared with the previous snapshot.
+  const CostSnapshot::ConstPtr previous = costSnapshot();
+  std::shared_ptr<CostSnapshot> snapshot;
+  if (previous && previous->vertex_costs.numValues() == vertex_costs.numValues() &&
+      previous->edge_weights.numValues() == edge_weights.numValues())
+  {
+    snapshot = std::make_shared<CostSnapshot>(*previous);
+    snapshot->vertex_costs.update(vertex_costs, changes.vertices);
+    snapshot->edge_weights.update(edge_weights, changes.edges);
+  }
+  else
+  {
+    snapshot = std::make_shared<CostSnapshot>();
+    snapshot->vertex_costs.assign(vertex_costs, vertex_costs.numValues());
+    snapshot->edge_weights.assign(edge_weights, edge_weights.numValues());
+  }
+  snapshot->version = changes.version;
+  std::atomic_store(&cost_snapshot_ptr, CostSnapshot::ConstPtr(std::move(snapshot)));
+}
+
+uint64_t MeshMap::costsVersion()
+{
+  std::lock_guard<std::mutex> lock(cost_changes_mtx);
+  return costs_version;
+}
+
+bool MeshMap::changedVerticesSince(const uint64_t version, std::vector<lvr2::VertexHandle>& vertices,
+                                   uint64_t& current_version)
+{
+  std::lock_guard<std::mutex> lock(cost_changes_mtx);
+  current_version = costs_version;
+  vertices.clear();
+
+  if (version == costs_version)
+    return true;
+
+  // the recorded changes have to cover all versions after the given one
+  if (version > costs_version || cost_changes.empty() || cost_changes.front().version > version + 1)
+    return false;
+
+  for (const auto& changes : cost_changes)
+  {
+    if (changes.version > version)
+      vertices.insert(vertices.end(), changes.vertices.begin(), changes.vertices.end());
+  }
+
+  std::sort(vertices.begin(), vertices.end(),
+            [](const lvr2::VertexHandle& a, const lvr2::VertexHandle& b) { return a.idx() < b.idx(); });
+  vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+  return true;
+}
+
+bool MeshMap::changedEdgesSince(const uint64_t version, std::vector<lvr2::EdgeHandle>& edges,
+                                uint64_t& current_version)
+{
+  std::lock_guard<std::mutex> lock(cost_changes_mtx);
+  current_version = costs_version;
+  edges.clear();
+
+  if (version == costs_version)
+    return true;
+
+  // the recorded changes have to cover all versions after the given one
+  if (version > costs_version || cost_changes.empty() || cost_changes.front().version > version + 1)
+    return false;
+
+  for (const auto& changes : cost_changes)
+  {
+    if (changes.version > version)
+      edges.insert(edges.end(), changes.edges.begin(), changes.edges.end());
+  }
+
+  std::sort(edges.begin(), edges.end(),
+            [](const lvr2::EdgeHandle& a, const lvr2::EdgeHandle& b) { return a.idx() < b.idx(); });
+  edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+  return true;
 }
 
 void MeshMap::findLethalByContours(const int& min_contour_size, std::set<lvr2::VertexHandle>& lethals)
@@ -590,9 +1308,58 @@ void MeshMap::findContours(std::vector<std::vector<lvr2::VertexHandle>>& contour
   ROS_INFO_STREAM("Found " << contours.size() << " contours.");
 }
 
-void MeshMap::setVectorMap(lvr2::DenseVertexMap<mesh_map::Vector>& vector_map)
+lvr2::DenseVertexMap<mesh_map::Vector> MeshMap::acquireVectorMap()
 {
-  this->vector_map = vector_map;
+  {
+    std::lock_guard<std::mutex> lock(vector_map_pool->mutex);
+    if (!vector_map_pool->vector_maps.empty())
+    {
+      lvr2::DenseVertexMap<mesh_map::Vector> vector_map = std::move(vector_map_pool->vector_maps.back());
+      vector_map_pool->vector_maps.pop_back();
+      return vector_map;
+    }
+  }
+
+  lvr2::DenseVertexMap<mesh_map::Vector> vector_map;
+  vector_map.reserve(mesh_ptr->nextVertexIndex());
+  return vector_map;
+}
+
+VectorFieldSnapshot::ConstPtr MeshMap::createVectorField(lvr2::DenseVertexMap<mesh_map::Vector>&& vector_map,
+                                                         std::vector<lvr2::VertexHandle>&& vertices)
+{
+  VectorFieldSnapshot* snapshot = new VectorFieldSnapshot();
+  snapshot->version = ++vector_field_version;
+  snapshot->vector_map = std::move(vector_map);
+  snapshot->vertices = std::move(vertices);
+
+  // the snapshot returns its vector map to the pool when it is released, the pool outlives the mesh map if necessary
+  std::shared_ptr<VectorMapPool> pool = vector_map_pool;
+  return VectorFieldSnapshot::ConstPtr(snapshot, [pool](VectorFieldSnapshot* snapshot) {
+    for (auto vH : snapshot->vertices)
+    {
+      snapshot->vector_map.erase(vH);
+    }
+    {
+      std::lock_guard<std::mutex> lock(pool->mutex);
+      if (pool->vector_maps.size() < MAX_RECYCLED_VECTOR_MAPS)
+        pool->vector_maps.push_back(std::move(snapshot->vector_map));
+    }
+    delete snapshot;
+  });
+}
+
+VectorFieldSnapshot::ConstPtr MeshMap::setVectorMap(lvr2::DenseVertexMap<mesh_map::Vector>&& vector_map,
+                                                    std::vector<lvr2::VertexHandle>&& vertices)
+{
+  VectorFieldSnapshot::ConstPtr vector_field = createVectorField(std::move(vector_map), std::move(vertices));
+  std::atomic_store(&vector_field_ptr, vector_field);
+  return vector_field;
+}
+
+void MeshMap::setVectorField(const VectorFieldSnapshot::ConstPtr& vector_field)
+{
+  std::atomic_store(&vector_field_ptr, vector_field);
 }
 
 boost::optional<Vector> MeshMap::directionAtPosition(
@@ -625,7 +1392,25 @@ boost::optional<Vector> MeshMap::directionAtPosition(
 float MeshMap::costAtPosition(const std::array<lvr2::VertexHandle, 3>& vertices,
                               const std::array<float, 3>& barycentric_coords)
 {
-  return costAtPosition(vertex_costs, vertices, barycentric_coords);
+  const CostSnapshot::ConstPtr snapshot = costSnapshot();
+  if (!snapshot)
+    return std::numeric_limits<float>::quiet_NaN();
+  return costAtPosition(snapshot->vertex_costs, vertices, barycentric_coords);
+}
+
+float MeshMap::costAtPosition(const SharedVertexCosts& costs, const std::array<lvr2::VertexHandle, 3>& vertices,
+                              const std::array<float, 3>& barycentric_coords)
+{
+  const auto& a = costs.get(vertices[0]);
+  const auto& b = costs.get(vertices[1]);
+  const auto& c = costs.get(vertices[2]);
+
+  if (a && b && c)
+  {
+    std::array<float, 3> costs = { a.get(), b.get(), c.get() };
+    return mesh_map::linearCombineBarycentricCoords(costs, barycentric_coords);
+  }
+  return std::numeric_limits<float>::quiet_NaN();
 }
 
 float MeshMap::costAtPosition(const lvr2::DenseVertexMap<float>& costs,
@@ -702,7 +1487,18 @@ void MeshMap::publishVectorField(const std::string& name,
                                  const lvr2::DenseVertexMap<lvr2::BaseVector<float>>& vector_map,
                                  const bool publish_face_vectors)
 {
-  publishVectorField(name, vector_map, vertex_costs, {}, publish_face_vectors);
+  const CostSnapshot::ConstPtr snapshot = costSnapshot();
+  if (!snapshot)
+    return;
+
+  // the marker colors are looked up in a dense copy of the snapshot costs
+  const SharedVertexCosts& snapshot_costs = snapshot->vertex_costs;
+  lvr2::DenseVertexMap<float> costs(snapshot_costs.numValues(), 0);
+  for (lvr2::Index i = 0; i < snapshot_costs.numValues(); i++)
+  {
+    costs[lvr2::VertexHandle(i)] = snapshot_costs[lvr2::VertexHandle(i)];
+  }
+  publishVectorField(name, vector_map, costs, {}, publish_face_vectors);
 }
 
 void MeshMap::publishCombinedVectorField()
@@ -759,7 +1555,6 @@ void MeshMap::publishVectorField(const std::string& name,
                                  const std::function<float(float)>& cost_function, const bool publish_face_vectors)
 {
   const auto& mesh = this->mesh();
-  const auto& vertex_costs = vertexCosts();
   const auto& face_normals = faceNormals();
 
   visualization_msgs::Marker vector_field;
@@ -985,6 +1780,15 @@ boost::optional<std::tuple<lvr2::FaceHandle, std::array<Vector, 3>, std::array<f
 }
 
 bool MeshMap::meshAhead(mesh_map::Vector& pos, lvr2::FaceHandle& face, const float& step_size)
+{
+  const VectorFieldSnapshot::ConstPtr vector_field = vectorField();
+  if (!vector_field)
+    return false;
+  return meshAhead(pos, face, step_size, *vector_field);
+}
+
+bool MeshMap::meshAhead(mesh_map::Vector& pos, lvr2::FaceHandle& face, const float& step_size,
+                        const VectorFieldSnapshot& vector_field)
 {
   std::array<float, 3> bary_coords;
   float dist;
@@ -1007,7 +1811,7 @@ bool MeshMap::meshAhead(mesh_map::Vector& pos, lvr2::FaceHandle& face, const flo
   {
     return false;
   }
-  const auto& opt_dir = directionAtPosition(vector_map, mesh_ptr->getVerticesOfFace(face), bary_coords);
+  const auto& opt_dir = directionAtPosition(vector_field.vector_map, mesh_ptr->getVerticesOfFace(face), bary_coords);
   if (opt_dir)
   {
     Vector dir = opt_dir.get().normalized();
@@ -1036,44 +1840,36 @@ boost::optional<std::tuple<lvr2::FaceHandle, std::array<mesh_map::Vector , 3>,
     std::array<float, 3>>> MeshMap::searchContainingFace(
     Vector& position, const float& max_dist)
 {
-  if(auto vH_opt = getNearestVertexHandle(position))
-  {
-    auto vH = vH_opt.unwrap();
-    float min_triangle_position_distance = std::numeric_limits<float>::max();
-    std::array<Vector, 3> vertices;
-    std::array<float, 3> bary_coords;
-    lvr2::OptionalFaceHandle opt_fH;
-    for(auto fH : mesh_ptr->getFacesOfVertex(vH))
-    {
-      const auto& tmp_vertices = mesh_ptr->getVertexPositionsOfFace(fH);
-      float dist = 0;
-      std::array<float, 3> tmp_bary_coords;
-      if (mesh_map::projectedBarycentricCoords(position, vertices, tmp_bary_coords, dist)
-          && std::fabs(dist) < max_dist)
-      {
-        return std::make_tuple(fH, tmp_vertices, tmp_bary_coords);
-      }
+  lvr2::FaceHandle fH(0);
+  std::array<float, 3> bary_coords;
+  float dist;
+  if (face_bvh.closestFace(position, max_dist, fH, bary_coords, dist))
+  {
+    return std::make_tuple(fH, mesh_ptr->getVertexPositionsOfFace(fH), bary_coords);
+  }
+  ROS_ERROR_STREAM("No containing face found!");
+  return boost::none;
+}
 
-      float triangle_dist = 0;
-      triangle_dist += (vertices[0] - position).length2();
-      triangle_dist += (vertices[1] - position).length2();
-      triangle_dist += (vertices[2] - position).length2();
-      if(triangle_dist < min_triangle_position_distance)
-      {
-        min_triangle_position_distance = triangle_dist;
-        opt_fH = fH;
-        vertices = tmp_vertices;
-        bary_coords = tmp_bary_coords;
-      }
-    }
-    if(opt_fH)
-    {
-      return std::make_tuple(opt_fH.unwrap(), vertices, bary_coords);
-    }
-    ROS_ERROR_STREAM("No containing face found!");
-    return boost::none;
+void MeshMap::searchContainingFaces(const std::vector<Vector>& positions, const float& max_dist,
+                                    std::vector<lvr2::OptionalFaceHandle>& faces,
+                                    std::vector<std::array<float, 3>>& barycentric_coords,
+                                    std::vector<float>& distances)
+{
+  face_bvh.closestFaces(positions, max_dist, faces, barycentric_coords, distances);
+}
+
+boost::optional<std::tuple<lvr2::FaceHandle, std::array<mesh_map::Vector , 3>,
+    std::array<float, 3>>> MeshMap::searchRayIntersection(
+    const Vector& origin, const Vector& direction, const float& max_dist)
+{
+  lvr2::FaceHandle fH(0);
+  std::array<float, 3> bary_coords;
+  float t;
+  if (face_bvh.intersectRay(origin, direction, max_dist, fH, bary_coords, t))
+  {
+    return std::make_tuple(fH, mesh_ptr->getVertexPositionsOfFace(fH), bary_coords);
   }
-  ROS_FATAL_STREAM("Could not find the nearest vertex");
   return boost::none;
 }
 
@@ -1083,7 +1879,29 @@ lvr2::OptionalVertexHandle MeshMap::getNearestVertexHandle(const Vector& pos)
   size_t ret_index;
   float out_dist_sqr;
   size_t num_results = kd_tree_ptr->knnSearch(&querry_point[0], 1, &ret_index, &out_dist_sqr);
-  return num_results == 0 ? lvr2::OptionalVertexHandle() : lvr2::VertexHandle(ret_index);
+  return num_results == 0 ? lvr2::OptionalVertexHandle() : adaptor_ptr->vertexHandle(ret_index);
+}
+
+void MeshMap::getNearestVertexHandles(const std::vector<Vector>& positions,
+                                      std::vector<lvr2::OptionalVertexHandle>& vertices)
+{
+  vertices.assign(positions.size(), lvr2::OptionalVertexHandle());
+  std::vector<size_t> order;
+  mortonOrder(positions, order);
+
+  // the k-d tree queries are read only, neighbouring positions of the Morton order share the cached tree nodes
+#pragma omp parallel for schedule(static)
+  for (size_t k = 0; k < order.size(); k++)
+  {
+    const size_t i = order[k];
+    const float query_point[3] = { positions[i].x, positions[i].y, positions[i].z };
+    size_t ret_index;
+    float out_dist_sqr;
+    if (kd_tree_ptr->knnSearch(&query_point[0], 1, &ret_index, &out_dist_sqr) > 0)
+    {
+      vertices[i] = adaptor_ptr->vertexHandle(ret_index);
+    }
+  }
 }
 
 inline const geometry_msgs::Point MeshMap::toPoint(const Vector& vec)
@@ -1238,6 +2056,7 @@ void MeshMap::reconfigureCallback(mesh_map::MeshMapConfig& cfg, uint32_t level)
   {
     if (cfg.cost_limit != config.cost_limit)
     {
+      std::lock_guard<std::mutex> lock(layer_mtx);
       combineVertexCosts();
     }
 
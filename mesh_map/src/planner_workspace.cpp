@@ -0,0 +1,107 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+#include <mesh_map/planner_workspace.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace mesh_map
+{
+void StampedVertexFlags::reset(const size_t size)
+{
+  if (stamps.size() != size)
+  {
+    stamps.assign(size, 0);
+    generation = 1;
+  }
+  else if (++generation == 0)
+  {
+    // the generation wrapped around, stamps of old generations could match again
+    std::fill(stamps.begin(), stamps.end(), 0);
+    generation = 1;
+  }
+}
+
+PlannerWorkspace::PlannerWorkspace() : valid(false), last_distances(nullptr), last_predecessors(nullptr)
+{
+}
+
+void PlannerWorkspace::reset(const lvr2::HalfEdgeMesh<lvr2::BaseVector<float>>& mesh,
+                             lvr2::DenseVertexMap<float>& distances,
+                             lvr2::DenseVertexMap<lvr2::VertexHandle>& predecessors)
+{
+  const size_t num_vertices = mesh.nextVertexIndex();
+  const bool restore_touched = valid && last_distances == &distances && last_predecessors == &predecessors &&
+                               distances.numValues() == mesh.numVertices() &&
+                               predecessors.numValues() == mesh.numVertices() && touched_flags.size() == num_vertices;
+
+  if (restore_touched)
+  {
+    for (auto vH : touched)
+    {
+      distances[vH] = std::numeric_limits<float>::infinity();
+      predecessors[vH] = vH;
+    }
+  }
+  else
+  {
+    distances.clear();
+    predecessors.clear();
+    distances.reserve(num_vertices);
+    predecessors.reserve(num_vertices);
+    for (auto const& vH : mesh.vertices())
+    {
+      distances.insert(vH, std::numeric_limits<float>::infinity());
+      predecessors.insert(vH, vH);
+    }
+  }
+
+  touched.clear();
+  touched_flags.reset(num_vertices);
+  fixed_flags.reset(num_vertices);
+  last_distances = &distances;
+  last_predecessors = &predecessors;
+  valid = true;
+}
+
+void PlannerWorkspace::invalidate()
+{
+  valid = false;
+}
+
+} /* namespace mesh_map */
@@ -0,0 +1,114 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+#include <mesh_map/potential_field_cache.h>
+
+namespace mesh_map
+{
+PotentialFieldCache::PotentialFieldCache(const size_t capacity) : capacity(capacity), newest_costs_version(0)
+{
+}
+
+void PotentialFieldCache::setCapacity(const size_t capacity)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  this->capacity = capacity;
+  while (fields.size() > capacity)
+    fields.pop_back();
+}
+
+PotentialField::ConstPtr PotentialFieldCache::find(const lvr2::Index seed_index, const Vector& seed,
+                                                   const float seed_tolerance, const uint64_t costs_version,
+                                                   const float cost_limit)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  evictOutdated(costs_version);
+  for (auto iter = fields.begin(); iter != fields.end(); iter++)
+  {
+    const PotentialField& field = **iter;
+
+    // a request may still plan on older costs than the cached fields, which is a miss but does not outdate them
+    if (field.costs_version == costs_version && field.seed_index == seed_index && field.cost_limit == cost_limit &&
+        field.seed.distance2(seed) <= seed_tolerance * seed_tolerance)
+    {
+      fields.splice(fields.begin(), fields, iter);
+      return fields.front();
+    }
+  }
+  return PotentialField::ConstPtr();
+}
+
+void PotentialFieldCache::insert(const PotentialField::ConstPtr& field)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  evictOutdated(field->costs_version);
+  if (capacity == 0 || field->costs_version < newest_costs_version)
+    return;
+
+  for (auto iter = fields.begin(); iter != fields.end(); iter++)
+  {
+    if ((*iter)->seed_index == field->seed_index)
+    {
+      fields.erase(iter);
+      break;
+    }
+  }
+
+  fields.push_front(field);
+  while (fields.size() > capacity)
+    fields.pop_back();
+}
+
+void PotentialFieldCache::evictOutdated(const uint64_t costs_version)
+{
+  // the costs versions only increase, fields of costs older than the newest seen version are not requested anymore
+  if (costs_version <= newest_costs_version)
+    return;
+
+  newest_costs_version = costs_version;
+  fields.remove_if([this](const PotentialField::ConstPtr& field) {
+    return field->costs_version < newest_costs_version;
+  });
+}
+
+void PotentialFieldCache::clear()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  fields.clear();
+}
+
+} /* namespace mesh_map */
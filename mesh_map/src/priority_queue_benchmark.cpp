@@ -0,0 +1,171 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+/*
+ * Micro-benchmark for the vertex priority queues. It runs a Dijkstra propagation with each queue type on a
+ * triangulated grid graph with random edge weights, which resembles the vertex neighbourhoods of a mesh, and compares
+ * the runtimes. The resulting distances of all queues are checked against each other.
+ *
+ * usage: priority_queue_benchmark [grid_size] [runs]
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <mesh_map/vertex_priority_queue.h>
+
+namespace
+{
+struct Graph
+{
+  std::vector<lvr2::Index> offsets;
+  std::vector<lvr2::Index> neighbours;
+  std::vector<float> weights;
+};
+
+/**
+ * @brief Builds a triangulated grid graph, each inner vertex has six neighbours like a regular triangle mesh
+ */
+Graph buildGridGraph(const lvr2::Index size, const unsigned int seed)
+{
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<float> dist(0.05, 0.15);
+
+  const int offsets[6][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 }, { -1, -1 }, { 1, 1 } };
+
+  Graph graph;
+  graph.offsets.push_back(0);
+  for (lvr2::Index y = 0; y < size; y++)
+  {
+    for (lvr2::Index x = 0; x < size; x++)
+    {
+      for (const auto& offset : offsets)
+      {
+        const long nx = static_cast<long>(x) + offset[0];
+        const long ny = static_cast<long>(y) + offset[1];
+        if (nx < 0 || ny < 0 || nx >= size || ny >= size)
+          continue;
+        graph.neighbours.push_back(ny * size + nx);
+        graph.weights.push_back(dist(gen));
+      }
+      graph.offsets.push_back(graph.neighbours.size());
+    }
+  }
+  return graph;
+}
+
+/**
+ * @brief Runs a Dijkstra propagation from vertex zero and returns the runtime in milliseconds
+ */
+double dijkstra(const Graph& graph, mesh_map::VertexPriorityQueue& pq, std::vector<float>& distances,
+                size_t& num_pops)
+{
+  const lvr2::Index num_vertices = graph.offsets.size() - 1;
+  distances.assign(num_vertices, std::numeric_limits<float>::infinity());
+  std::vector<bool> fixed(num_vertices, false);
+  num_pops = 0;
+
+  auto start = std::chrono::steady_clock::now();
+
+  distances[0] = 0;
+  pq.insert(lvr2::VertexHandle(0), 0);
+  while (!pq.isEmpty())
+  {
+    const lvr2::Index current = pq.popMin().idx();
+    fixed[current] = true;
+    num_pops++;
+    for (lvr2::Index i = graph.offsets[current]; i < graph.offsets[current + 1]; i++)
+    {
+      const lvr2::Index n = graph.neighbours[i];
+      if (fixed[n])
+        continue;
+      const float tmp = distances[current] + graph.weights[i];
+      if (tmp < distances[n])
+      {
+        distances[n] = tmp;
+        pq.insert(lvr2::VertexHandle(n), tmp);
+      }
+    }
+  }
+
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  const lvr2::Index grid_size = argc > 1 ? std::atoi(argv[1]) : 1000;
+  const int runs = argc > 2 ? std::atoi(argv[2]) : 3;
+
+  std::cout << "Building a " << grid_size << " x " << grid_size << " triangulated grid graph..." << std::endl;
+  const Graph graph = buildGridGraph(grid_size, 42);
+  const lvr2::Index num_vertices = graph.offsets.size() - 1;
+
+  const std::vector<std::pair<std::string, mesh_map::PriorityQueueType>> types = {
+    { "meap", mesh_map::MEAP }, { "dary_heap", mesh_map::DARY_HEAP }, { "radix_heap", mesh_map::RADIX_HEAP }
+  };
+
+  std::vector<float> reference;
+  for (const auto& type : types)
+  {
+    double best = std::numeric_limits<double>::infinity();
+    std::vector<float> distances;
+    size_t num_pops = 0;
+    for (int run = 0; run < runs; run++)
+    {
+      mesh_map::VertexPriorityQueue::Ptr pq = mesh_map::createVertexPriorityQueue(type.second, num_vertices);
+      best = std::min(best, dijkstra(graph, *pq, distances, num_pops));
+    }
+
+    float max_error = 0;
+    if (reference.empty())
+      reference = distances;
+    for (lvr2::Index i = 0; i < num_vertices; i++)
+      max_error = std::max(max_error, std::fabs(reference[i] - distances[i]));
+
+    std::cout << type.first << ": " << best << " ms for " << num_pops << " pops, "
+              << best * 1e6 / num_pops << " ns per pop, max distance deviation: " << max_error << std::endl;
+  }
+  return 0;
+}
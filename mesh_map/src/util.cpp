@@ -36,6 +36,7 @@
  */
 
 #include <mesh_map/util.h>
+#include <algorithm>
 #include <std_msgs/ColorRGBA.h>
 #include <tf/transform_datatypes.h>
 
@@ -56,6 +57,115 @@ void getMinMax(const lvr2::VertexMap<float>& costs, float& min, float& max)
   }
 }
 
+uint64_t fnv1a(const void* data, const size_t size, uint64_t hash)
+{
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < size; i++)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+uint64_t layerCacheKey(const uint64_t hash, const std::vector<double>& params)
+{
+  return fnv1a(params.data(), params.size() * sizeof(double), hash);
+}
+
+//! number of 16 bit parts the cache key is stored in, floats represent them exactly
+static const size_t CACHE_KEY_PARTS = 4;
+
+bool readLayerCache(lvr2::AttributeMeshIOBase& mesh_io, const std::string& name, const uint64_t key,
+                    lvr2::DenseVertexMap<float>& values)
+{
+  // the key parts are followed by a flag which is only set once the values have been written completely
+  auto key_opt = mesh_io.getDenseAttributeMap<lvr2::DenseVertexMap<float>>(name + "_key");
+  if (!key_opt || key_opt.get().numValues() != CACHE_KEY_PARTS + 1 ||
+      key_opt.get()[lvr2::VertexHandle(CACHE_KEY_PARTS)] != 1)
+    return false;
+
+  uint64_t cached_key = 0;
+  for (size_t i = 0; i < CACHE_KEY_PARTS; i++)
+  {
+    cached_key |= static_cast<uint64_t>(key_opt.get()[lvr2::VertexHandle(i)]) << (16 * i);
+  }
+  if (cached_key != key)
+    return false;
+
+  auto values_opt = mesh_io.getDenseAttributeMap<lvr2::DenseVertexMap<float>>(name);
+  if (!values_opt)
+    return false;
+  values = values_opt.get();
+  return true;
+}
+
+bool writeLayerCache(lvr2::AttributeMeshIOBase& mesh_io, const std::string& name, const uint64_t key,
+                     const lvr2::DenseVertexMap<float>& values)
+{
+  lvr2::DenseVertexMap<float> key_parts;
+  for (size_t i = 0; i < CACHE_KEY_PARTS; i++)
+  {
+    key_parts.insert(lvr2::VertexHandle(i), static_cast<float>((key >> (16 * i)) & 0xffff));
+  }
+
+  // invalidate the previous entry first, so that partially replaced values are never read with a key
+  key_parts.insert(lvr2::VertexHandle(CACHE_KEY_PARTS), 0);
+  if (!mesh_io.addDenseAttributeMap(key_parts, name + "_key") || !mesh_io.addDenseAttributeMap(values, name))
+    return false;
+  key_parts.insert(lvr2::VertexHandle(CACHE_KEY_PARTS), 1);
+  return mesh_io.addDenseAttributeMap(key_parts, name + "_key");
+}
+
+/**
+ * @brief Spreads the lower 21 bits of the value to every third bit
+ */
+static uint64_t spreadBits(uint64_t value)
+{
+  value &= 0x1fffff;
+  value = (value | value << 32) & 0x1f00000000ffffULL;
+  value = (value | value << 16) & 0x1f0000ff0000ffULL;
+  value = (value | value << 8) & 0x100f00f00f00f00fULL;
+  value = (value | value << 4) & 0x10c30c30c30c30c3ULL;
+  value = (value | value << 2) & 0x1249249249249249ULL;
+  return value;
+}
+
+void mortonOrder(const std::vector<Vector>& points, std::vector<size_t>& order)
+{
+  Vector bb_min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+                std::numeric_limits<float>::max());
+  Vector bb_max(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(),
+                std::numeric_limits<float>::lowest());
+  for (const auto& point : points)
+  {
+    bb_min = Vector(std::min(bb_min.x, point.x), std::min(bb_min.y, point.y), std::min(bb_min.z, point.z));
+    bb_max = Vector(std::max(bb_max.x, point.x), std::max(bb_max.y, point.y), std::max(bb_max.z, point.z));
+  }
+
+  // quantize each coordinate to 21 bits and interleave them
+  const float cells = (1 << 21) - 1;
+  const Vector extent = bb_max - bb_min;
+  const Vector scale(extent.x > 0 ? cells / extent.x : 0, extent.y > 0 ? cells / extent.y : 0,
+                     extent.z > 0 ? cells / extent.z : 0);
+  std::vector<std::pair<uint64_t, size_t>> codes(points.size());
+  for (size_t i = 0; i < points.size(); i++)
+  {
+    const Vector cell = points[i] - bb_min;
+    codes[i].first = spreadBits(static_cast<uint64_t>(cell.x * scale.x)) |
+                     spreadBits(static_cast<uint64_t>(cell.y * scale.y)) << 1 |
+                     spreadBits(static_cast<uint64_t>(cell.z * scale.z)) << 2;
+    codes[i].second = i;
+  }
+  std::sort(codes.begin(), codes.end());
+
+  order.resize(points.size());
+  for (size_t i = 0; i < codes.size(); i++)
+  {
+    order[i] = codes[i].second;
+  }
+}
+
 Vector toVector(const geometry_msgs::Point& p)
 {
   return Vector(p.x, p.y, p.z);
@@ -0,0 +1,297 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <mesh_map/vertex_priority_queue.h>
+#include <ros/ros.h>
+
+namespace mesh_map
+{
+constexpr size_t DaryHeap::ARITY;
+constexpr lvr2::Index DaryHeap::NOT_IN_HEAP;
+constexpr size_t RadixHeap::NUM_BUCKETS;
+
+DaryHeap::DaryHeap(const lvr2::Index num_vertices) : positions(num_vertices, NOT_IN_HEAP)
+{
+}
+
+void DaryHeap::insert(const lvr2::VertexHandle& vH, const float& key)
+{
+  const lvr2::Index pos = positions[vH.idx()];
+  if (pos == NOT_IN_HEAP)
+  {
+    heap.emplace_back(key, vH.idx());
+    siftUp(heap.size() - 1);
+  }
+  else if (key < heap[pos].first)
+  {
+    heap[pos].first = key;
+    siftUp(pos);
+  }
+  else if (key > heap[pos].first)
+  {
+    heap[pos].first = key;
+    siftDown(pos);
+  }
+}
+
+lvr2::VertexHandle DaryHeap::popMin()
+{
+  const lvr2::Index min = heap.front().second;
+  positions[min] = NOT_IN_HEAP;
+
+  if (heap.size() > 1)
+  {
+    heap.front() = heap.back();
+    heap.pop_back();
+    siftDown(0);
+  }
+  else
+  {
+    heap.pop_back();
+  }
+  return lvr2::VertexHandle(min);
+}
+
+void DaryHeap::clear()
+{
+  for (const auto& entry : heap)
+  {
+    positions[entry.second] = NOT_IN_HEAP;
+  }
+  heap.clear();
+}
+
+inline void DaryHeap::siftUp(size_t pos)
+{
+  const std::pair<float, lvr2::Index> entry = heap[pos];
+  while (pos > 0)
+  {
+    const size_t parent = (pos - 1) / ARITY;
+    if (!(entry.first < heap[parent].first))
+      break;
+    heap[pos] = heap[parent];
+    positions[heap[pos].second] = pos;
+    pos = parent;
+  }
+  heap[pos] = entry;
+  positions[entry.second] = pos;
+}
+
+inline void DaryHeap::siftDown(size_t pos)
+{
+  const std::pair<float, lvr2::Index> entry = heap[pos];
+  const size_t size = heap.size();
+  while (true)
+  {
+    const size_t first_child = ARITY * pos + 1;
+    if (first_child >= size)
+      break;
+
+    // find the smallest of up to ARITY children
+    const size_t last_child = std::min(first_child + ARITY, size);
+    size_t min_child = first_child;
+    for (size_t child = first_child + 1; child < last_child; child++)
+    {
+      if (heap[child].first < heap[min_child].first)
+        min_child = child;
+    }
+
+    if (!(heap[min_child].first < entry.first))
+      break;
+    heap[pos] = heap[min_child];
+    positions[heap[pos].second] = pos;
+    pos = min_child;
+  }
+  heap[pos] = entry;
+  positions[entry.second] = pos;
+}
+
+RadixHeap::RadixHeap(const lvr2::Index num_vertices)
+  : keys(num_vertices, 0), sequences(num_vertices, 0), queued(num_vertices, false), last(0), num_queued(0)
+{
+}
+
+inline uint32_t RadixHeap::toBits(const float& key)
+{
+  // NaN and infinite keys are sorted to the very end
+  if (!(key <= std::numeric_limits<float>::max()))
+    return std::numeric_limits<uint32_t>::max();
+  // negative keys and -0.0 are not supported, clamp them to zero
+  if (!(key > 0))
+    return 0;
+  uint32_t bits;
+  std::memcpy(&bits, &key, sizeof(bits));
+  return bits;
+}
+
+inline size_t RadixHeap::bucketIndex(const uint32_t& bits) const
+{
+  return bits == last ? 0 : 32 - __builtin_clz(bits ^ last);
+}
+
+void RadixHeap::insert(const lvr2::VertexHandle& vH, const float& key)
+{
+  const lvr2::Index idx = vH.idx();
+  const uint32_t bits = std::max(toBits(key), last);
+
+  if (queued[idx])
+  {
+    if (keys[idx] == bits)
+      return;
+  }
+  else
+  {
+    queued[idx] = true;
+    num_queued++;
+  }
+
+  // the previous entry of the vertex, if any, becomes outdated
+  keys[idx] = bits;
+  buckets[bucketIndex(bits)].push_back(Entry{ bits, idx, ++sequences[idx] });
+}
+
+lvr2::VertexHandle RadixHeap::popMin()
+{
+  auto& first_bucket = buckets[0];
+
+  // drop outdated entries with the last extracted key
+  while (!first_bucket.empty() && !isCurrent(first_bucket.back()))
+    first_bucket.pop_back();
+
+  if (first_bucket.empty())
+  {
+    for (size_t i = 1; i < NUM_BUCKETS; i++)
+    {
+      auto& bucket = buckets[i];
+
+      // find the smallest current key of the first non-empty bucket
+      uint32_t min = std::numeric_limits<uint32_t>::max();
+      bool found = false;
+      for (const auto& entry : bucket)
+      {
+        if (isCurrent(entry))
+        {
+          min = std::min(min, entry.bits);
+          found = true;
+        }
+      }
+
+      if (!found)
+      {
+        bucket.clear();
+        continue;
+      }
+
+      // redistribute the bucket with respect to the new minimum, all entries are moved to smaller buckets
+      last = min;
+      for (const auto& entry : bucket)
+      {
+        if (isCurrent(entry))
+          buckets[bucketIndex(entry.bits)].push_back(entry);
+      }
+      bucket.clear();
+      break;
+    }
+  }
+
+  const lvr2::Index min = first_bucket.back().idx;
+  first_bucket.pop_back();
+  queued[min] = false;
+  num_queued--;
+  return lvr2::VertexHandle(min);
+}
+
+void RadixHeap::clear()
+{
+  for (auto& bucket : buckets)
+  {
+    for (const auto& entry : bucket)
+    {
+      queued[entry.idx] = false;
+    }
+    bucket.clear();
+  }
+  last = 0;
+  num_queued = 0;
+}
+
+bool priorityQueueTypeFromString(const std::string& name, PriorityQueueType& type)
+{
+  if (name == "dary_heap")
+    type = DARY_HEAP;
+  else if (name == "radix_heap")
+    type = RADIX_HEAP;
+  else if (name == "meap")
+    type = MEAP;
+  else
+    return false;
+  return true;
+}
+
+PriorityQueueType readPriorityQueueType(const ros::NodeHandle& private_nh)
+{
+  std::string priority_queue;
+  private_nh.param<std::string>("priority_queue", priority_queue, "dary_heap");
+  PriorityQueueType type;
+  if (!priorityQueueTypeFromString(priority_queue, type))
+  {
+    ROS_WARN_STREAM("Unknown priority queue type \"" << priority_queue << "\", using \"dary_heap\" instead. "
+                    << "Available types are \"dary_heap\", \"radix_heap\" and \"meap\".");
+    type = DARY_HEAP;
+  }
+  return type;
+}
+
+VertexPriorityQueue::Ptr createVertexPriorityQueue(const PriorityQueueType& type, const lvr2::Index num_vertices)
+{
+  switch (type)
+  {
+    case RADIX_HEAP:
+      return VertexPriorityQueue::Ptr(new RadixHeap(num_vertices));
+    case MEAP:
+      return VertexPriorityQueue::Ptr(new MeapQueue(num_vertices));
+    case DARY_HEAP:
+    default:
+      return VertexPriorityQueue::Ptr(new DaryHeap(num_vertices));
+  }
+}
+
+} /* namespace mesh_map */
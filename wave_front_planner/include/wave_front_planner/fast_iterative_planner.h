@@ -0,0 +1,126 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+#ifndef MESH_NAVIGATION__FAST_ITERATIVE_PLANNER_H
+#define MESH_NAVIGATION__FAST_ITERATIVE_PLANNER_H
+
+#include <mesh_map/triangle_update.h>
+#include <wave_front_planner/wave_front_planner.h>
+
+namespace wave_front_planner
+{
+/**
+ * @brief Wave front planner which solves the eikonal equation with the Fast Iterative Method (FIM) instead of the
+ * serial Fast Marching Method. The vertices of the active list are updated in parallel with the same triangle update
+ * as the Fast Marching Method, until all of them have converged. The propagation always computes the full field, the
+ * propagation mode of the configuration is not used.
+ */
+class FastIterativePlanner : public WaveFrontPlanner
+{
+public:
+  typedef boost::shared_ptr<wave_front_planner::FastIterativePlanner> Ptr;
+
+  /**
+   * @brief Constructor
+   */
+  FastIterativePlanner();
+
+  /**
+   * @brief Destructor
+   */
+  virtual ~FastIterativePlanner();
+
+  /**
+   * @brief Initializes the planner plugin with a user configured name and a shared pointer to the mesh map
+   * @param name The user configured name, which is used as namespace for parameters, etc.
+   * @param mesh_map_ptr A shared pointer to the mesh map instance to access attributes and helper functions, etc.
+   * @return true if the plugin has been initialized successfully
+   */
+  virtual bool initialize(const std::string& name, const boost::shared_ptr<mesh_map::MeshMap>& mesh_map_ptr);
+
+protected:
+  /**
+   * @brief Solves the eikonal equation from the seeded vertices of the start face using the Fast Iterative Method
+   * @param face_geometry The triangle corners of the edge weights to use for vertex distances in a triangle
+   * @param vertex_costs The combined vertex costs to use during the propagation
+   * @param start_face The face containing the seed, its vertices are seeded and fixed
+   * @param goal_vertices The vertices of the faces containing the goals of the wavefront, not used
+   * @param ctx The state of the request, its potential is initialized with the seed distances and the fixed vertices
+   * of its workspace with the seeded vertices
+   * @return the number of vertices which have been fixed
+   */
+  virtual size_t propagateWaveFront(const mesh_map::FaceGeometry& face_geometry,
+                                    const mesh_map::SharedVertexCosts& vertex_costs,
+                                    const lvr2::FaceHandle& start_face,
+                                    const std::vector<lvr2::VertexHandle>& goal_vertices, PlanningContext& ctx);
+
+  /**
+   * @brief Computes the shortest distance of a vertex over all its faces, whose other two vertices are passable and
+   * have been reached. It only reads the given maps, such that multiple vertices can be solved concurrently.
+   * @param vH The vertex to solve
+   * @param face_geometry The triangle corners of the edge weights
+   * @param distances The current distances
+   * @param passable The vertices which are valid and within the cost limit, i.e. which may propagate their distance
+   * @param update The new distance and direction of the vertex
+   * @param face The face the new distance has been computed with
+   * @return true if the distance of the vertex can be decreased
+   */
+  bool solveVertex(const lvr2::VertexHandle& vH, const mesh_map::FaceGeometry& face_geometry,
+                   const lvr2::DenseVertexMap<float>& distances, const lvr2::DenseVertexMap<bool>& passable,
+                   mesh_map::TriangleUpdate& update, lvr2::FaceHandle& face) const;
+
+  /**
+   * @brief Stores the solved distance and direction of a vertex
+   * @param vH The solved vertex
+   * @param update The new distance and direction of the vertex
+   * @param face The face the new distance has been computed with
+   * @param ctx The state of the request to update
+   */
+  void applyUpdate(const lvr2::VertexHandle& vH, const mesh_map::TriangleUpdate& update, const lvr2::FaceHandle& face,
+                   PlanningContext& ctx);
+
+private:
+  //! minimum distance decrease for which an active vertex is updated again
+  float convergence_epsilon;
+
+  //! number of threads used to solve the active vertices, zero to use all available cores
+  int num_threads;
+};
+
+}  // namespace wave_front_planner
+
+#endif  // MESH_NAVIGATION__FAST_ITERATIVE_PLANNER_H
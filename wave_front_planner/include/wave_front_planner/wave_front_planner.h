@@ -41,6 +41,10 @@
 #include <mbf_mesh_core/mesh_planner.h>
 #include <mbf_msgs/GetPathResult.h>
 #include <mesh_map/mesh_map.h>
+#include <mesh_map/planner_workspace.h>
+#include <mesh_map/potential_field_cache.h>
+#include <mesh_map/vertex_priority_queue.h>
+#include <mesh_map/workspace_pool.h>
 #include <wave_front_planner/WaveFrontPlannerConfig.h>
 #include <nav_msgs/Path.h>
 
@@ -76,11 +80,37 @@ public:
                             std::string& message);
 
   /**
-   * @brief Requests the planner to cancel, e.g. if it takes too much time.
+   * @brief Computes paths from many start poses to the same goal with a single wave front propagation, which is
+   * seeded at the goal and stops as soon as the faces of all start poses are reached. Neither the vector field of the
+   * map, which is followed by the controller, is replaced nor are the paths published.
+   * @param goal The goal pose shared by all plans
+   * @param starts The start poses
+   * @param tolerance The goal tolerance, TODO is currently not used
+   * @param outcomes The result outcome code of each plan, see the GetPath action definition
+   * @param plans The computed plans, one per start pose
+   * @param costs The computed costs for the plans
+   * @param message a detailed outcome message
+   */
+  virtual void makePlans(const geometry_msgs::PoseStamped& goal, const std::vector<geometry_msgs::PoseStamped>& starts,
+                         double tolerance, std::vector<uint32_t>& outcomes,
+                         std::vector<std::vector<geometry_msgs::PoseStamped>>& plans, std::vector<double>& costs,
+                         std::string& message);
+
+  /**
+   * @brief Requests the planner to cancel, e.g. if it takes too much time. All running requests are canceled.
    * @return true if cancel has been successfully requested, false otherwise
    */
   virtual bool cancel();
 
+  /**
+   * @brief Each call plans in its own planning context, such that makePlans() may be called concurrently
+   * @return true
+   */
+  virtual bool supportsConcurrentPlans()
+  {
+    return true;
+  }
+
   /**
    * @brief Initializes the planner plugin with a user configured name and a shared pointer to the mesh map
    * @param name The user configured name, which is used as namespace for parameters, etc.
@@ -90,72 +120,171 @@ public:
   virtual bool initialize(const std::string& name, const boost::shared_ptr<mesh_map::MeshMap>& mesh_map_ptr);
 
 protected:
+  /**
+   * @brief Per request state of the wave front propagation. Each makePlan call checks out its own context from the
+   * pool, such that multiple requests can be planned concurrently on the same mesh map.
+   */
+  struct PlanningContext
+  {
+    //! flag if cancel has been requested for this request
+    std::atomic_bool canceled;
+
+    //! theta angles to the source of the wave front propagation
+    lvr2::DenseVertexMap<float> direction;
+
+    //! predecessors while wave propagation
+    lvr2::DenseVertexMap<lvr2::VertexHandle> predecessors;
+
+    //! the face which is cut by the computed line to the source
+    lvr2::DenseVertexMap<lvr2::FaceHandle> cutting_faces;
+
+    //! stores the current vector map containing vectors pointing to the seed
+    lvr2::DenseVertexMap<mesh_map::Vector> vector_map;
+
+    //! vertices which hold a vector in the vector map
+    std::vector<lvr2::VertexHandle> vector_vertices;
+
+    //! vector field of the request, shared with the mesh map if it is stored as the latest vector field
+    mesh_map::VectorFieldSnapshot::ConstPtr vector_field;
+
+    //! true if the vector field is stored as the latest vector field of the map, false for batch requests
+    bool store_vector_field;
+
+    //! potential field / scalar distance field to the seed
+    lvr2::DenseVertexMap<float> potential;
+
+    //! cached potential field the request has been backtracked from instead of the potential, if any
+    mesh_map::PotentialField::ConstPtr potential_field;
+
+    //! workspace of the propagation, which restores only the touched vertices between requests
+    mesh_map::PlannerWorkspace workspace;
+
+    //! goal vertices which have not been fixed yet by the propagation
+    mesh_map::StampedVertexFlags goal_flags;
+  };
 
   /**
-   * @brief Computes a wavefront propagation from the start until it reached the goal
+   * @brief Computes a wavefront propagation from the start until it reached all goals
    * @param start The seed of the wave, i.e. the robot's goal pose
-   * @param goal The goal of the wavefront, where it will stop propagating
-   * @param path The backtracked path
-   * @return a ExePath action related outcome code
+   * @param goals The goals of the wavefront, i.e. the robot's poses. It will stop propagating once all are reached.
+   * @param paths The backtracked paths, one per goal
+   * @param outcomes The GetPath action related outcome code of each path
+   * @param ctx The state of the request
+   * @return a ExePath action related outcome code of the propagation, the outcomes are only valid on success
    */
-  uint32_t waveFrontPropagation(const mesh_map::Vector& start, const mesh_map::Vector& goal,
-                                std::list<std::pair<mesh_map::Vector, lvr2::FaceHandle>>& path);
+  uint32_t waveFrontPropagation(const mesh_map::Vector& start, const std::vector<mesh_map::Vector>& goals,
+                                std::vector<std::list<std::pair<mesh_map::Vector, lvr2::FaceHandle>>>& paths,
+                                std::vector<uint32_t>& outcomes, PlanningContext& ctx);
 
   /**
    *
-   * @brief Computes a wavefront propagation from the start until it reached the goal
+   * @brief Computes a wavefront propagation from the start until it reached all goals
+   * @param start The seed of the wave, i.e. the robot's goal pose
+   * @param goals The goals of the wavefront, i.e. the robot's poses. It will stop propagating once all are reached.
+   * @param face_geometry The triangle corners of the edge weights to use for vertex distances in a triangle
+   * @param costs The snapshot of the combined vertex costs to use during the propagation
+   * @param paths The backtracked paths, one per goal
+   * @param outcomes The GetPath action related outcome code of each path
+   * @param ctx The state of the request, which receives the computed distances and predecessors
+   * @return a ExePath action related outcome code of the propagation, the outcomes are only valid on success
+   */
+  uint32_t waveFrontPropagation(const mesh_map::Vector& start, const std::vector<mesh_map::Vector>& goals,
+                                const mesh_map::FaceGeometry& face_geometry, const mesh_map::CostSnapshot& costs,
+                                std::vector<std::list<std::pair<mesh_map::Vector, lvr2::FaceHandle>>>& paths,
+                                std::vector<uint32_t>& outcomes, PlanningContext& ctx);
+
+  /**
+   * @brief Propagates the wave front from the seeded vertices of the start face over the mesh using the Fast Marching
+   * Method. Subclasses may override it to solve the eikonal equation with a different method.
+   * @param face_geometry The triangle corners of the edge weights to use for vertex distances in a triangle
+   * @param vertex_costs The combined vertex costs to use during the propagation
+   * @param start_face The face containing the seed, its vertices are seeded and fixed
+   * @param goal_vertices The vertices of the faces containing the goals of the wavefront
+   * @param ctx The state of the request, its potential is initialized with the seed distances and the fixed vertices
+   * of its workspace with the seeded vertices
+   * @return the number of vertices which have been fixed
+   */
+  virtual size_t propagateWaveFront(const mesh_map::FaceGeometry& face_geometry,
+                                    const mesh_map::SharedVertexCosts& vertex_costs,
+                                    const lvr2::FaceHandle& start_face,
+                                    const std::vector<lvr2::VertexHandle>& goal_vertices, PlanningContext& ctx);
+
+  /**
+   * @brief Backtracks the path from the goal of the wavefront to its seed along the vector field of the request
    * @param start The seed of the wave, i.e. the robot's goal pose
-   * @param goal The goal of the wavefront, where it will stop propagating
-   * @param edge_weights The edge weights map to use for vertex distances in a triangle
-   * @param costs The combined vertex costs to use during the propagation
+   * @param start_face The face containing the seed
+   * @param goal The goal of the wavefront, i.e. the robot's pose
+   * @param goal_face The face containing the goal of the wavefront
    * @param path The backtracked path
-   * @param distances The computed distances
-   * @param predecessors The backtracked predecessors
-   * @return a ExePath action related outcome code
+   * @param ctx The state of the request containing the vector field
+   * @return a GetPath action related outcome code
    */
-  uint32_t waveFrontPropagation(const mesh_map::Vector& start, const mesh_map::Vector& goal,
-                                const lvr2::DenseEdgeMap<float>& edge_weights, const lvr2::DenseVertexMap<float>& costs,
-                                std::list<std::pair<mesh_map::Vector, lvr2::FaceHandle>>& path,
-                                lvr2::DenseVertexMap<float>& distances,
-                                lvr2::DenseVertexMap<lvr2::VertexHandle>& predecessors);
+  uint32_t backtrackPath(const mesh_map::Vector& start, const lvr2::FaceHandle& start_face,
+                         const mesh_map::Vector& goal, const lvr2::FaceHandle& goal_face,
+                         std::list<std::pair<mesh_map::Vector, lvr2::FaceHandle>>& path, const PlanningContext& ctx);
 
   /**
    * Fast Marching Method update step using the Hesse normal form to determine if the direction vector is cutting the current triangle
    * @param distances Distance map to the goal which stores the current state of all distances to the goal
-   * @param edge_weights Distances assigned to each edge
+   * @param a The edge weight between the second and the third vertex
+   * @param b The edge weight between the first and the third vertex
+   * @param c The edge weight between the first and the second vertex
    * @param v1 The first vertex of the triangle
    * @param v2 The second vertex of the triangle
    * @param v3 The thrid vertex of the triangle
+   * @param fh The triangle spanned by the three vertices
+   * @param ctx The state of the request, which receives the predecessor, direction and cutting face
    * @return true if the newly computed distance is shorter than before and if the current triangle is cut
    */
-  inline bool waveFrontUpdateWithS(lvr2::DenseVertexMap<float>& distances,
-                                   const lvr2::DenseEdgeMap<float>& edge_weights, const lvr2::VertexHandle& v1,
-                                   const lvr2::VertexHandle& v2, const lvr2::VertexHandle& v3);
+  inline bool waveFrontUpdateWithS(lvr2::DenseVertexMap<float>& distances, const float& a, const float& b,
+                                   const float& c, const lvr2::VertexHandle& v1, const lvr2::VertexHandle& v2,
+                                   const lvr2::VertexHandle& v3, const lvr2::FaceHandle& fh, PlanningContext& ctx);
 
 
   /**
    * Fast Marching Method update step using the Law of Cosines to determine if the direction vector is cutting the current triangle
    * @param distances Distance map to the goal which stores the current state of all distances to the goal
-   * @param edge_weights Distances assigned to each edge
+   * @param corner The precomputed geometry of the triangle seen from the third vertex
    * @param v1 The first vertex of the triangle
    * @param v2 The second vertex of the triangle
    * @param v3 The thrid vertex of the triangle
+   * @param fh The triangle spanned by the three vertices
+   * @param ctx The state of the request, which receives the predecessor, direction and cutting face
    * @return true if the newly computed distance is shorter than before and if the current triangle is cut
    */
-  inline bool waveFrontUpdate(lvr2::DenseVertexMap<float>& distances, const lvr2::DenseEdgeMap<float>& edge_weights,
-                              const lvr2::VertexHandle& v1, const lvr2::VertexHandle& v2, const lvr2::VertexHandle& v3);
+  inline bool waveFrontUpdate(lvr2::DenseVertexMap<float>& distances, const mesh_map::TriangleCorner& corner,
+                              const lvr2::VertexHandle& v1, const lvr2::VertexHandle& v2, const lvr2::VertexHandle& v3,
+                              const lvr2::FaceHandle& fh, PlanningContext& ctx);
+
+  /**
+   * @brief Converts a backtracked path into a plan and computes its length
+   * @param path The backtracked path from the seed to the goal of the wavefront, it is reversed in place
+   * @param goal The seed of the wave, i.e. the robot's goal pose, which ends the plan
+   * @param header The header of the plan poses
+   * @param plan The plan from the robot's pose to its goal
+   * @param cost The length of the plan
+   */
+  void pathToPlan(std::list<std::pair<mesh_map::Vector, lvr2::FaceHandle>>& path, const mesh_map::Vector& goal,
+                  const std_msgs::Header& header, std::vector<geometry_msgs::PoseStamped>& plan, double& cost);
 
   /**
    * @brief Computes the vector field in a post processing. It rotates the predecessor edges by the stored angles
+   * @param ctx The state of the request, which receives the vector field
    */
-  void computeVectorMap();
+  void computeVectorMap(PlanningContext& ctx);
 
   /**
    * @brief Dynamic reconfigure callback
    */
   void reconfigureCallback(wave_front_planner::WaveFrontPlannerConfig& cfg, uint32_t level);
 
-private:
+  /**
+   * @brief Delivers a human readable name of the given propagation mode
+   * @param propagation_mode The propagation mode as defined in the WaveFrontPlanner config
+   * @return name of the propagation mode
+   */
+  static std::string propagationModeName(const int propagation_mode);
+
 
   //! shared pointer to the mesh map
   mesh_map::MeshMap::Ptr mesh_map;
@@ -166,9 +295,6 @@ private:
   //! the private node handle with the user defined namespace (name)
   ros::NodeHandle private_nh;
 
-  //! flag if cancel has been requested
-  std::atomic_bool cancel_planning;
-
   //! publisher for the backtracked path
   ros::Publisher path_pub;
 
@@ -181,8 +307,8 @@ private:
   //! the map coordinate frame / system id
   std::string map_frame;
 
-  //! an offset that determines how far beyond the goal (robot's position) is propagated.
-  float goal_dist_offset;
+  //! the priority queue implementation used for the wave front propagation
+  mesh_map::PriorityQueueType priority_queue_type;
 
   //! shared pointer to dynamic reconfigure server
   boost::shared_ptr<dynamic_reconfigure::Server<wave_front_planner::WaveFrontPlannerConfig>> reconfigure_server_ptr;
@@ -196,20 +322,11 @@ private:
   //! the current dynamic reconfigure planner configuration
   WaveFrontPlannerConfig config;
 
-  //! theta angles to the source of the wave front propagation
-  lvr2::DenseVertexMap<float> direction;
-
-  //! predecessors while wave propagation
-  lvr2::DenseVertexMap<lvr2::VertexHandle> predecessors;
-
-  //! the face which is cut by the computed line to the source
-  lvr2::DenseVertexMap<lvr2::FaceHandle> cutting_faces;
-
-  //! stores the current vector map containing vectors pointing to the seed
-  lvr2::DenseVertexMap<mesh_map::Vector> vector_map;
+  //! contexts of the running requests and idle contexts kept for later requests
+  mesh_map::WorkspacePool<PlanningContext> contexts;
 
-  //! potential field / scalar distance field to the seed
-  lvr2::DenseVertexMap<float> potential;
+  //! completed potential fields of recent goals, which are reused for repeated plans to the same goal
+  mesh_map::PotentialFieldCache potential_cache;
 };
 
 }  // namespace wave_front_planner
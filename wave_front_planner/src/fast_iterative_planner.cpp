@@ -0,0 +1,244 @@
+/*
+ *  Copyright 2020, Sebastian Pütz
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *  3. Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  authors:
+ *    Sebastian Pütz <spuetz@uni-osnabrueck.de>
+ *
+ */
+
+#include <omp.h>
+
+#include <mbf_msgs/GetPathResult.h>
+#include <pluginlib/class_list_macros.h>
+
+#include "wave_front_planner/fast_iterative_planner.h"
+
+PLUGINLIB_EXPORT_CLASS(wave_front_planner::FastIterativePlanner, mbf_mesh_core::MeshPlanner);
+
+namespace wave_front_planner
+{
+FastIterativePlanner::FastIterativePlanner()
+{
+}
+
+FastIterativePlanner::~FastIterativePlanner()
+{
+}
+
+bool FastIterativePlanner::initialize(const std::string& plugin_name,
+                                      const boost::shared_ptr<mesh_map::MeshMap>& mesh_map_ptr)
+{
+  if (!WaveFrontPlanner::initialize(plugin_name, mesh_map_ptr))
+    return false;
+
+  private_nh.param("convergence_epsilon", convergence_epsilon, 1e-4f);
+  private_nh.param("num_threads", num_threads, 0);
+  return true;
+}
+
+bool FastIterativePlanner::solveVertex(const lvr2::VertexHandle& vH, const mesh_map::FaceGeometry& face_geometry,
+                                       const lvr2::DenseVertexMap<float>& distances,
+                                       const lvr2::DenseVertexMap<bool>& passable, mesh_map::TriangleUpdate& update,
+                                       lvr2::FaceHandle& face) const
+{
+  const auto& graph = mesh_map->compactMesh();
+  const auto& vertex_faces = graph.vertexFaces();
+  const auto& face_vertices = graph.faceVertices();
+  const auto& invalid = mesh_map->invalid;
+
+  float best_dist = distances[vH];
+  bool solved = false;
+  const lvr2::Index faces_end = graph.facesEnd(vH);
+  for (lvr2::Index i = graph.facesBegin(vH); i < faces_end; i++)
+  {
+    const lvr2::FaceHandle fh(vertex_faces[i]);
+    const lvr2::Index* vertices = &face_vertices[3 * fh.idx()];
+    if (invalid[lvr2::VertexHandle(vertices[0])] || invalid[lvr2::VertexHandle(vertices[1])] ||
+        invalid[lvr2::VertexHandle(vertices[2])])
+      continue;
+
+    // rotate the face, such that the solved vertex is the third one
+    const size_t k = vertices[0] == vH.idx() ? 0 : vertices[1] == vH.idx() ? 1 : 2;
+    const lvr2::VertexHandle v1(vertices[(k + 1) % 3]);
+    const lvr2::VertexHandle v2(vertices[(k + 2) % 3]);
+    if (!passable[v1] || !passable[v2] || !std::isfinite(distances[v1]) || !std::isfinite(distances[v2]))
+      continue;
+
+    mesh_map::TriangleUpdate face_update;
+    if (mesh_map::triangleUpdate(distances[v1], distances[v2], best_dist, face_geometry.corner(fh, k), v1, v2,
+                                 face_update))
+    {
+      best_dist = face_update.distance;
+      update = face_update;
+      face = fh;
+      solved = true;
+    }
+  }
+  return solved;
+}
+
+void FastIterativePlanner::applyUpdate(const lvr2::VertexHandle& vH, const mesh_map::TriangleUpdate& update,
+                                       const lvr2::FaceHandle& face, PlanningContext& ctx)
+{
+  ctx.workspace.touch(vH);
+  ctx.cutting_faces.insert(vH, face);
+  ctx.predecessors[vH] = update.predecessor;
+  ctx.potential[vH] = update.distance;
+  ctx.direction[vH] = update.direction;
+}
+
+size_t FastIterativePlanner::propagateWaveFront(const mesh_map::FaceGeometry& face_geometry,
+                                                const mesh_map::SharedVertexCosts& vertex_costs,
+                                                const lvr2::FaceHandle& start_face,
+                                                const std::vector<lvr2::VertexHandle>& goal_vertices,
+                                                PlanningContext& ctx)
+{
+  const auto& mesh = mesh_map->mesh();
+  const auto& graph = mesh_map->compactMesh();
+  const auto& neighbours = graph.neighbourVertices();
+  const auto& invalid = mesh_map->invalid;
+  const int threads = num_threads > 0 ? num_threads : omp_get_max_threads();
+  const lvr2::DenseVertexMap<float>& distances = ctx.potential;
+  mesh_map::StampedVertexFlags& fixed = ctx.workspace.fixed();
+
+  lvr2::DenseVertexMap<bool> passable(mesh.nextVertexIndex(), false);
+  for (auto vH : mesh.vertices())
+  {
+    passable[vH] = !invalid[vH] && vertex_costs[vH] <= config.cost_limit;
+  }
+
+  // vertices in the active list or among the candidates to activate
+  lvr2::DenseVertexMap<bool> listed(mesh.nextVertexIndex(), false);
+  std::vector<lvr2::VertexHandle> active;
+  std::vector<lvr2::VertexHandle> next_active;
+  std::vector<lvr2::VertexHandle> candidates;
+  std::vector<mesh_map::TriangleUpdate> updates;
+  std::vector<lvr2::FaceHandle> faces;
+  std::vector<char> solved;
+
+  // appends the neighbours of a converged vertex, which are not listed yet, to the candidates
+  auto collectNeighbours = [&](const lvr2::VertexHandle& vH) {
+    if (!passable[vH])
+      return;
+    const lvr2::Index neighbours_end = graph.neighboursEnd(vH);
+    for (lvr2::Index i = graph.neighboursBegin(vH); i < neighbours_end; i++)
+    {
+      const lvr2::VertexHandle nH(neighbours[i]);
+      if (fixed[nH] || listed[nH] || invalid[nH])
+        continue;
+      listed[nH] = true;
+      candidates.push_back(nH);
+    }
+  };
+
+  // solves the given vertices in parallel, the maps are only read
+  auto solveAll = [&](const std::vector<lvr2::VertexHandle>& vertices) {
+    updates.resize(vertices.size(), mesh_map::TriangleUpdate{ 0, lvr2::VertexHandle(0), 0 });
+    faces.resize(vertices.size(), lvr2::FaceHandle(0));
+    solved.resize(vertices.size());
+#pragma omp parallel for schedule(dynamic, 64) num_threads(threads)
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+      solved[i] = solveVertex(vertices[i], face_geometry, distances, passable, updates[i], faces[i]);
+    }
+  };
+
+  for (auto vH : mesh.getVerticesOfFace(start_face))
+  {
+    collectNeighbours(vH);
+  }
+  active.swap(candidates);
+
+  size_t iterations = 0;
+  size_t expanded_cnt = 0;
+  while (!active.empty() && !ctx.canceled)
+  {
+    iterations++;
+    expanded_cnt += active.size();
+    solveAll(active);
+
+    // vertices whose distance did not decrease significantly have converged and activate their neighbours
+    next_active.clear();
+    candidates.clear();
+    for (size_t i = 0; i < active.size(); i++)
+    {
+      const lvr2::VertexHandle& vH = active[i];
+      const float old_dist = distances[vH];
+      if (solved[i])
+        applyUpdate(vH, updates[i], faces[i], ctx);
+      if (solved[i] && old_dist - updates[i].distance > convergence_epsilon)
+      {
+        next_active.push_back(vH);
+      }
+      else
+      {
+        listed[vH] = false;
+        collectNeighbours(vH);
+      }
+    }
+
+    // candidates whose distance decreases join the active list
+    expanded_cnt += candidates.size();
+    solveAll(candidates);
+    for (size_t i = 0; i < candidates.size(); i++)
+    {
+      const lvr2::VertexHandle& vH = candidates[i];
+      if (solved[i])
+      {
+        applyUpdate(vH, updates[i], faces[i], ctx);
+        next_active.push_back(vH);
+      }
+      else
+      {
+        listed[vH] = false;
+      }
+    }
+    active.swap(next_active);
+  }
+
+  // all reached vertices have converged, the potential covers the whole reachable mesh
+  size_t fixed_set_cnt = 0;
+  for (auto vH : mesh.vertices())
+  {
+    if (std::isfinite(distances[vH]))
+    {
+      fixed.set(vH);
+      fixed_set_cnt++;
+    }
+  }
+
+  ROS_INFO_STREAM("Expanded " << expanded_cnt << " vertex updates in " << iterations << " iterations using "
+                              << threads << " threads.");
+  return fixed_set_cnt;
+}
+
+}  // namespace wave_front_planner
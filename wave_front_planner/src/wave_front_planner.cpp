@@ -36,9 +36,9 @@
  */
 
 #include <lvr2/geometry/Handles.hpp>
-#include <lvr2/util/Meap.hpp>
 
 #include <mbf_msgs/GetPathResult.h>
+#include <mesh_map/triangle_update.h>
 #include <mesh_map/util.h>
 #include <pluginlib/class_list_macros.h>
 
@@ -50,6 +50,9 @@ PLUGINLIB_EXPORT_CLASS(wave_front_planner::WaveFrontPlanner, mbf_mesh_core::Mesh
 
 namespace wave_front_planner
 {
+//! maximum distance between two goals to share a cached potential field
+static const float CACHED_SEED_TOLERANCE = 0.01;
+
 WaveFrontPlanner::WaveFrontPlanner()
 {
 }
@@ -62,8 +65,13 @@ uint32_t WaveFrontPlanner::makePlan(const geometry_msgs::PoseStamped& start, con
                                     double tolerance, std::vector<geometry_msgs::PoseStamped>& plan, double& cost,
                                     std::string& message)
 {
-  const auto& mesh = mesh_map->mesh();
-  std::list<std::pair<mesh_map::Vector, lvr2::FaceHandle>> path;
+  std::vector<std::list<std::pair<mesh_map::Vector, lvr2::FaceHandle>>> paths;
+  std::vector<uint32_t> outcomes;
+
+  // check out the state of this request, concurrent requests use their own contexts
+  const mesh_map::WorkspacePool<PlanningContext>::Lease ctx_lease = contexts.acquire();
+  PlanningContext& ctx = *ctx_lease;
+  ctx.store_vector_field = true;
 
   // mesh_map->combineVertexCosts(); // TODO should be outside the planner
 
@@ -72,14 +80,90 @@ uint32_t WaveFrontPlanner::makePlan(const geometry_msgs::PoseStamped& start, con
   mesh_map::Vector goal_vec = mesh_map::toVector(goal.pose.position);
   mesh_map::Vector start_vec = mesh_map::toVector(start.pose.position);
 
-  uint32_t outcome = waveFrontPropagation(goal_vec, start_vec, path);
+  uint32_t outcome = waveFrontPropagation(goal_vec, { start_vec }, paths, outcomes, ctx);
+  if (outcome == mbf_msgs::GetPathResult::SUCCESS)
+    outcome = outcomes.front();
 
-  path.reverse();
+  std_msgs::Header header;
+  header.stamp = ros::Time::now();
+  header.frame_id = mesh_map->mapFrame();
+
+  cost = 0;
+  if (!paths.empty())
+    pathToPlan(paths.front(), goal_vec, header, plan, cost);
+
+  nav_msgs::Path path_msg;
+  path_msg.poses = plan;
+  path_msg.header = header;
+
+  path_pub.publish(path_msg);
+  if (ctx.potential_field)
+    mesh_map->publishVertexCosts(ctx.potential_field->potential, "Potential");
+  else
+    mesh_map->publishVertexCosts(ctx.potential, "Potential");
+  ROS_INFO_STREAM("Path length: " << cost << "m");
+
+  if (publish_vector_field && ctx.vector_field)
+  {
+    mesh_map->publishVectorField("vector_field", ctx.vector_field->vector_map, publish_face_vectors);
+  }
+
+  return outcome;
+}
+
+void WaveFrontPlanner::makePlans(const geometry_msgs::PoseStamped& goal,
+                                 const std::vector<geometry_msgs::PoseStamped>& starts, double tolerance,
+                                 std::vector<uint32_t>& outcomes,
+                                 std::vector<std::vector<geometry_msgs::PoseStamped>>& plans,
+                                 std::vector<double>& costs, std::string& message)
+{
+  std::vector<std::list<std::pair<mesh_map::Vector, lvr2::FaceHandle>>> paths;
+
+  // check out the state of this request, concurrent requests use their own contexts
+  const mesh_map::WorkspacePool<PlanningContext>::Lease ctx_lease = contexts.acquire();
+  PlanningContext& ctx = *ctx_lease;
+  // what-if requests must not change the vector field the controller follows
+  ctx.store_vector_field = false;
+
+  const mesh_map::Vector goal_vec = mesh_map::toVector(goal.pose.position);
+  std::vector<mesh_map::Vector> start_vecs;
+  start_vecs.reserve(starts.size());
+  for (const auto& start : starts)
+  {
+    start_vecs.push_back(mesh_map::toVector(start.pose.position));
+  }
+
+  // one propagation from the goal, which stops as soon as the faces of all start poses are reached
+  const uint32_t outcome = waveFrontPropagation(goal_vec, start_vecs, paths, outcomes, ctx);
+  if (outcome != mbf_msgs::GetPathResult::SUCCESS)
+    outcomes.assign(starts.size(), outcome);
 
   std_msgs::Header header;
   header.stamp = ros::Time::now();
   header.frame_id = mesh_map->mapFrame();
 
+  plans.assign(starts.size(), std::vector<geometry_msgs::PoseStamped>());
+  costs.assign(starts.size(), 0);
+  size_t num_planned = 0;
+  for (size_t i = 0; i < starts.size(); i++)
+  {
+    if (outcomes[i] != mbf_msgs::GetPathResult::SUCCESS)
+      continue;
+    pathToPlan(paths[i], goal_vec, header, plans[i], costs[i]);
+    num_planned++;
+  }
+
+  message = "Planned " + std::to_string(num_planned) + " of " + std::to_string(starts.size()) +
+            " paths with one wave front propagation.";
+  ROS_INFO_STREAM(message);
+}
+
+void WaveFrontPlanner::pathToPlan(std::list<std::pair<mesh_map::Vector, lvr2::FaceHandle>>& path,
+                                  const mesh_map::Vector& goal, const std_msgs::Header& header,
+                                  std::vector<geometry_msgs::PoseStamped>& plan, double& cost)
+{
+  path.reverse();
+
   cost = 0;
   float dir_length;
   if (!path.empty())
@@ -102,30 +186,16 @@ uint32_t WaveFrontPlanner::makePlan(const geometry_msgs::PoseStamped& start, con
 
     geometry_msgs::PoseStamped pose;
     pose.header = header;
-    pose.pose = mesh_map::calculatePoseFromPosition(vec, goal_vec, face_normals[fH], dir_length);
+    pose.pose = mesh_map::calculatePoseFromPosition(vec, goal, face_normals[fH], dir_length);
     cost += dir_length;
     plan.push_back(pose);
   }
-
-  nav_msgs::Path path_msg;
-  path_msg.poses = plan;
-  path_msg.header = header;
-
-  path_pub.publish(path_msg);
-  mesh_map->publishVertexCosts(potential, "Potential");
-  ROS_INFO_STREAM("Path length: " << cost << "m");
-
-  if (publish_vector_field)
-  {
-    mesh_map->publishVectorField("vector_field", vector_map, publish_face_vectors);
-  }
-
-  return outcome;
 }
 
 bool WaveFrontPlanner::cancel()
 {
-  cancel_planning = true;
+  // the cancel request carries no request id, all running requests are canceled
+  contexts.cancelAll();
   return true;
 }
 
@@ -139,11 +209,10 @@ bool WaveFrontPlanner::initialize(const std::string& plugin_name,
 
   private_nh.param("publish_vector_field", publish_vector_field, false);
   private_nh.param("publish_face_vectors", publish_face_vectors, false);
-  private_nh.param("goal_dist_offset", goal_dist_offset, 0.3f);
+
+  priority_queue_type = mesh_map::readPriorityQueueType(private_nh);
 
   path_pub = private_nh.advertise<nav_msgs::Path>("path", 1, true);
-  const auto& mesh = mesh_map->mesh();
-  direction = lvr2::DenseVertexMap<float>(mesh.nextVertexIndex(), 0);
   // TODO check all map dependencies! (loaded layers etc...)
 
   reconfigure_server_ptr = boost::shared_ptr<dynamic_reconfigure::Server<wave_front_planner::WaveFrontPlannerConfig>>(
@@ -167,25 +236,26 @@ void WaveFrontPlanner::reconfigureCallback(wave_front_planner::WaveFrontPlannerC
   config = cfg;
 }
 
-void WaveFrontPlanner::computeVectorMap()
+void WaveFrontPlanner::computeVectorMap(PlanningContext& ctx)
 {
   const auto& mesh = mesh_map->mesh();
   const auto& face_normals = mesh_map->faceNormals();
   const auto& vertex_normals = mesh_map->vertexNormals();
 
-  for (auto v3 : mesh.vertices())
+  // only the vertices touched by the propagation can have a predecessor
+  for (auto v3 : ctx.workspace.touchedVertices())
   {
     // if(vertex_costs[v3] > config.cost_limit || !predecessors.containsKey(v3))
     // continue;
 
-    const lvr2::VertexHandle& v1 = predecessors[v3];
+    const lvr2::VertexHandle& v1 = ctx.predecessors[v3];
 
     // if predecessor is pointing to it self, continue with the next vertex.
     if (v1 == v3)
       continue;
 
     // get the cut face
-    const auto& optFh = cutting_faces.get(v3);
+    const auto& optFh = ctx.cutting_faces.get(v3);
     // if no cut face, continue with the next vertex
     if (!optFh)
       continue;
@@ -197,41 +267,47 @@ void WaveFrontPlanner::computeVectorMap()
 
     // compute the direction vector and rotate it by theta, which is stored in
     // the direction vertex map
-    const auto dirVec = (vec1 - vec3).rotated(vertex_normals[v3], direction[v3]);
+    const auto dirVec = (vec1 - vec3).rotated(vertex_normals[v3], ctx.direction[v3]);
     // store the normalized rotated vector in the vector map
-    vector_map.insert(v3, dirVec.normalized());
+    ctx.vector_map.insert(v3, dirVec.normalized());
+    ctx.vector_vertices.push_back(v3);
   }
-  mesh_map->setVectorMap(vector_map);
+  // hand the vector map over to the mesh map without copying it, the request keeps a reference for backtracking and
+  // publishing it. Concurrent requests replace the latest vector field of the map in the order they finish.
+  if (ctx.store_vector_field)
+    ctx.vector_field = mesh_map->setVectorMap(std::move(ctx.vector_map), std::move(ctx.vector_vertices));
+  else
+    ctx.vector_field = mesh_map->createVectorField(std::move(ctx.vector_map), std::move(ctx.vector_vertices));
 }
 
-uint32_t WaveFrontPlanner::waveFrontPropagation(const mesh_map::Vector& start, const mesh_map::Vector& goal,
-                                                std::list<std::pair<mesh_map::Vector, lvr2::FaceHandle>>& path)
+uint32_t WaveFrontPlanner::waveFrontPropagation(
+    const mesh_map::Vector& start, const std::vector<mesh_map::Vector>& goals,
+    std::vector<std::list<std::pair<mesh_map::Vector, lvr2::FaceHandle>>>& paths, std::vector<uint32_t>& outcomes,
+    PlanningContext& ctx)
 {
-  return waveFrontPropagation(start, goal, mesh_map->edgeDistances(), mesh_map->vertexCosts(), path, potential,
-                              predecessors);
+  // pin the current costs for the whole propagation, concurrent layer updates publish a new snapshot
+  const mesh_map::CostSnapshot::ConstPtr cost_snapshot = mesh_map->costSnapshot();
+  if (!cost_snapshot)
+    return mbf_msgs::GetPathResult::NOT_INITIALIZED;
+  return waveFrontPropagation(start, goals, mesh_map->compactMesh().faceDistanceGeometry(), *cost_snapshot, paths,
+                              outcomes, ctx);
 }
 
-inline bool WaveFrontPlanner::waveFrontUpdateWithS(lvr2::DenseVertexMap<float>& distances,
-                                                   const lvr2::DenseEdgeMap<float>& edge_weights,
-                                                   const lvr2::VertexHandle& v1, const lvr2::VertexHandle& v2,
-                                                   const lvr2::VertexHandle& v3)
+inline bool WaveFrontPlanner::waveFrontUpdateWithS(lvr2::DenseVertexMap<float>& distances, const float& a,
+                                                   const float& b, const float& c, const lvr2::VertexHandle& v1,
+                                                   const lvr2::VertexHandle& v2, const lvr2::VertexHandle& v3,
+                                                   const lvr2::FaceHandle& fh, PlanningContext& ctx)
 {
-  const auto& mesh = mesh_map->mesh();
+  auto& predecessors = ctx.predecessors;
+  auto& direction = ctx.direction;
+  auto& cutting_faces = ctx.cutting_faces;
 
   const double u1 = distances[v1];
   const double u2 = distances[v2];
   const double u3 = distances[v3];
 
-  const lvr2::OptionalEdgeHandle e12h = mesh.getEdgeBetween(v1, v2);
-  const double c = edge_weights[e12h.unwrap()];
   const double c_sq = c * c;
-
-  const lvr2::OptionalEdgeHandle e13h = mesh.getEdgeBetween(v1, v3);
-  const double b = edge_weights[e13h.unwrap()];
   const double b_sq = b * b;
-
-  const lvr2::OptionalEdgeHandle e23h = mesh.getEdgeBetween(v2, v3);
-  const double a = edge_weights[e23h.unwrap()];
   const double a_sq = a * a;
 
   const double u1_sq = u1 * u1;
@@ -263,7 +339,6 @@ inline bool WaveFrontPlanner::waveFrontUpdateWithS(lvr2::DenseVertexMap<float>&
         predecessors[v3] = v1;
         direction[v3] = static_cast<float>(theta);
         distances[v3] = static_cast<float>(u3tmp);
-        const lvr2::FaceHandle fh = mesh.getFaceBetween(v1, v2, v3).unwrap();
         cutting_faces.insert(v3, fh);
 #ifdef DEBUG
         mesh_map->publishDebugVector(v3, v1, fh, theta, mesh_map::color(0.9, 0.9, 0.2),
@@ -279,7 +354,6 @@ inline bool WaveFrontPlanner::waveFrontUpdateWithS(lvr2::DenseVertexMap<float>&
           predecessors[v3] = v1;
           direction[v3] = 0;
           distances[v3] = u3tmp;
-          const lvr2::FaceHandle fh = mesh.getFaceBetween(v1, v2, v3).unwrap();
           cutting_faces.insert(v3, fh);
 #ifdef DEBUG
           mesh_map->publishDebugVector(v3, v1, fh, 0, mesh_map::color(0.9, 0.9, 0.2),
@@ -296,7 +370,6 @@ inline bool WaveFrontPlanner::waveFrontUpdateWithS(lvr2::DenseVertexMap<float>&
       const double t2cos = (a_sq + u3tmp_sq - u2_sq) / (2 * a * u3tmp);
       if (S <= 0 && std::fabs(t2cos) <= 1)
       {
-        const lvr2::FaceHandle fh = mesh.getFaceBetween(v1, v2, v3).unwrap();
         const double theta = -acos(t2cos);
         direction[v3] = static_cast<float>(theta);
         distances[v3] = static_cast<float>(u3tmp);
@@ -316,7 +389,6 @@ inline bool WaveFrontPlanner::waveFrontUpdateWithS(lvr2::DenseVertexMap<float>&
           direction[v3] = 0;
           distances[v3] = u3tmp;
           predecessors[v3] = v2;
-          const lvr2::FaceHandle fh = mesh.getFaceBetween(v1, v2, v3).unwrap();
           cutting_faces.insert(v3, fh);
 #ifdef DEBUG
           mesh_map->publishDebugVector(v3, v2, fh, 0, mesh_map::color(0.9, 0.9, 0.2),
@@ -332,452 +404,424 @@ inline bool WaveFrontPlanner::waveFrontUpdateWithS(lvr2::DenseVertexMap<float>&
 }
 
 inline bool WaveFrontPlanner::waveFrontUpdate(lvr2::DenseVertexMap<float>& distances,
-                                              const lvr2::DenseEdgeMap<float>& edge_weights,
-                                              const lvr2::VertexHandle& v1, const lvr2::VertexHandle& v2,
-                                              const lvr2::VertexHandle& v3)
+                                              const mesh_map::TriangleCorner& corner, const lvr2::VertexHandle& v1,
+                                              const lvr2::VertexHandle& v2, const lvr2::VertexHandle& v3,
+                                              const lvr2::FaceHandle& fh, PlanningContext& ctx)
 {
-  const auto& mesh = mesh_map->mesh();
+  mesh_map::TriangleUpdate update;
+  if (!mesh_map::triangleUpdate(distances[v1], distances[v2], distances[v3], corner, v1, v2, update))
+    return false;
+
+  ctx.cutting_faces.insert(v3, fh);
+  ctx.predecessors[v3] = update.predecessor;
+  distances[v3] = update.distance;
+  ctx.direction[v3] = update.direction;
+#ifdef DEBUG
+  mesh_map->publishDebugVector(v3, update.predecessor, fh, update.direction, mesh_map::color(0.9, 0.9, 0.2),
+                               "dir_vec" + std::to_string(v3.idx()));
+#endif
+  return true;
+}
 
-  const double u1 = distances[v1];
-  const double u2 = distances[v2];
-  const double u3 = distances[v3];
+uint32_t WaveFrontPlanner::waveFrontPropagation(
+    const mesh_map::Vector& original_start, const std::vector<mesh_map::Vector>& original_goals,
+    const mesh_map::FaceGeometry& face_geometry, const mesh_map::CostSnapshot& costs,
+    std::vector<std::list<std::pair<mesh_map::Vector, lvr2::FaceHandle>>>& paths, std::vector<uint32_t>& outcomes,
+    PlanningContext& ctx)
+{
+  ROS_DEBUG_STREAM("Init wave front propagation.");
 
-  const lvr2::OptionalEdgeHandle e12h = mesh.getEdgeBetween(v1, v2);
-  const double c = edge_weights[e12h.unwrap()];
-  const double c_sq = c * c;
+  const auto& mesh = mesh_map->mesh();
+  const auto& vertex_costs = costs.vertex_costs;
+  lvr2::DenseVertexMap<float>& distances = ctx.potential;
+  lvr2::DenseVertexMap<lvr2::VertexHandle>& predecessors = ctx.predecessors;
 
-  const lvr2::OptionalEdgeHandle e13h = mesh.getEdgeBetween(v1, v3);
-  const double b = edge_weights[e13h.unwrap()];
-  const double b_sq = b * b;
+  // the debug markers are only published for single plans, a batch would overwrite them for every goal
+  const bool single_goal = original_goals.size() == 1;
 
-  const lvr2::OptionalEdgeHandle e23h = mesh.getEdgeBetween(v2, v3);
-  const double a = edge_weights[e23h.unwrap()];
-  const double a_sq = a * a;
+  mesh_map->publishDebugPoint(original_start, mesh_map::color(0, 1, 0), "start_point");
+  if (single_goal)
+    mesh_map->publishDebugPoint(original_goals.front(), mesh_map::color(0, 0, 1), "goal_point");
 
-  const double u1_sq = u1 * u1;
-  const double u2_sq = u2 * u2;
+  mesh_map::Vector start = original_start;
+  std::vector<mesh_map::Vector> goals = original_goals;
 
-  const double sx = (c_sq + u1_sq - u2_sq) / (2 * c);
-  const double sy = -sqrt(std::max(u1_sq - sx*sx, 0.0));
+  // Find the containing faces of start and goals
+  const auto& start_opt = mesh_map->getContainingFace(start, 0.4);
+  std::vector<lvr2::OptionalFaceHandle> goal_faces;
+  goal_faces.reserve(goals.size());
+  for (auto& goal : goals)
+  {
+    goal_faces.push_back(mesh_map->getContainingFace(goal, 0.4));
+  }
 
-  const double p = (b_sq + c_sq -a_sq) / (2 * c);
-  const double hc = sqrt(std::max(b_sq - p*p, 0.0));
+  ros::WallTime t_initialization_start = ros::WallTime::now();
 
-  const double dy = hc - sy;
-  const double dx = p - sx;
+  paths.assign(goals.size(), std::list<std::pair<mesh_map::Vector, lvr2::FaceHandle>>());
+  ctx.potential_field.reset();
+  outcomes.assign(goals.size(), mbf_msgs::GetPathResult::INVALID_GOAL);
 
-  const double u3tmp_sq = dx * dx + dy * dy;
-  double u3tmp = sqrt(u3tmp_sq);
+  if (!start_opt)
+    return mbf_msgs::GetPathResult::INVALID_START;
 
-  if (!std::isfinite(u3tmp))
-  {
-    ROS_ERROR_STREAM("u3 tmp is not finite!");
-  }
-  if (u3tmp < u3)
+  const auto& start_face = start_opt.unwrap();
+  mesh_map->publishDebugFace(start_face, mesh_map::color(0, 0, 1), "start_face");
+
+  // collect the vertices of the goal faces, the wave front has to reach all of them. Goals within the start face
+  // are reached without propagation.
+  std::vector<lvr2::VertexHandle> goal_vertices;
+  goal_vertices.reserve(3 * goals.size());
+  for (size_t i = 0; i < goals.size(); i++)
   {
-    const double t0a = (a_sq + b_sq - c_sq) / (2 * a * b);
-    const double t1a = (u3tmp_sq + b_sq - u1_sq) / (2 * u3tmp * b);
-    const double t2a = (a_sq + u3tmp_sq - u2_sq) / (2 * a * u3tmp);
+    if (!goal_faces[i])
+      continue;
 
-    // corner case: side b + u1 ~= u3
-    if (std::fabs(t1a) > 1)
-    {
-      u3tmp = u1 + b;
-      if (u3tmp < u3)
-      {
-        auto fH = mesh.getFaceBetween(v1, v2, v3).unwrap();
-        cutting_faces.insert(v3, fH);
-        predecessors[v3] = v1;
-#ifdef DEBUG
-        mesh_map->publishDebugVector(v3, v1, fH, 0, mesh_map::color(0.9, 0.9, 0.2),
-                                     "dir_vec" + std::to_string(v3.idx()));
-#endif
-        distances[v3] = static_cast<float>(u3tmp);
-        direction[v3] = 0;
-        return true;
-      }
-      return false;
-    }
-    // corner case: side a + u2 ~= u3
-    else if (std::fabs(t2a) > 1)
+    const lvr2::FaceHandle goal_face = goal_faces[i].unwrap();
+    if (goal_face == start_face)
     {
-      u3tmp = u2 + a;
-      if (u3tmp < u3)
-      {
-        auto fH = mesh.getFaceBetween(v1, v2, v3).unwrap();
-        cutting_faces.insert(v3, fH);
-        predecessors[v3] = v2;
-#ifdef DEBUG
-        mesh_map->publishDebugVector(v3, v2, fH, 0, mesh_map::color(0.9, 0.9, 0.2),
-                                     "dir_vec" + std::to_string(v3.idx()));
-#endif
-        distances[v3] = static_cast<float>(u3tmp);
-        direction[v3] = 0;
-        return true;
-      }
-      return false;
+      outcomes[i] = mbf_msgs::GetPathResult::SUCCESS;
+      continue;
     }
 
-    const double theta0 = acos(t0a);
-    const double theta1 = acos(t1a);
-    const double theta2 = acos(t2a);
+    outcomes[i] = mbf_msgs::GetPathResult::NO_PATH_FOUND;
+    const std::array<lvr2::VertexHandle, 3> face_vertices = mesh.getVerticesOfFace(goal_face);
+    goal_vertices.insert(goal_vertices.end(), face_vertices.begin(), face_vertices.end());
 
-#ifdef DEBUG
-    if (!std::isfinite(theta0 + theta1 + theta2))
+    if (single_goal)
     {
-      ROS_ERROR_STREAM("------------------");
-      if (std::isnan(theta0))
-        ROS_ERROR_STREAM("Theta0 is NaN!");
-      if (std::isnan(theta1))
-        ROS_ERROR_STREAM("Theta1 is NaN!");
-      if (std::isnan(theta2))
-        ROS_ERROR_STREAM("Theta2 is NaN!");
-      if (std::isinf(theta2))
-        ROS_ERROR_STREAM("Theta2 is inf!");
-      if (std::isinf(theta2))
-        ROS_ERROR_STREAM("Theta2 is inf!");
-      if (std::isinf(theta2))
-        ROS_ERROR_STREAM("Theta2 is inf!");
-      if (std::isnan(t1a))
-        ROS_ERROR_STREAM("t1a is NaN!");
-      if (std::isnan(t2a))
-        ROS_ERROR_STREAM("t2a is NaN!");
-      if (std::fabs(t2a) > 1)
-      {
-        ROS_ERROR_STREAM("|t2a| is > 1: " << t2a);
-        ROS_INFO_STREAM("a: " << a << ", u3: " << u3tmp << ", u2: " << u2 << ", a+u2: " << a + u2);
-      }
-      if (std::fabs(t1a) > 1)
-      {
-        ROS_ERROR_STREAM("|t1a| is > 1: " << t1a);
-        ROS_INFO_STREAM("b: " << b << ", u3: " << u3tmp << ", u1: " << u1 << ", b+u1: " << b + u1);
-      }
-    }
-#endif
-
-    if (theta1 < theta0 && theta2 < theta0)
-    {
-      auto fH = mesh.getFaceBetween(v1, v2, v3).unwrap();
-      cutting_faces.insert(v3, fH);
-      distances[v3] = static_cast<float>(u3tmp);
-      if (theta1 < theta2)
-      {
-        predecessors[v3] = v1;
-        direction[v3] = theta1;
-#ifdef DEBUG
-        mesh_map->publishDebugVector(v3, v1, fH, theta1, mesh_map::color(0.9, 0.9, 0.2),
-                                     "dir_vec" + std::to_string(v3.idx()));
-#endif
-      }
-      else
-      {
-        predecessors[v3] = v2;
-        direction[v3] = -theta2;
-#ifdef DEBUG
-        mesh_map->publishDebugVector(v3, v2, fH, -theta2, mesh_map::color(0.9, 0.9, 0.2),
-                                     "dir_vec" + std::to_string(v3.idx()));
-#endif
-      }
-      return true;
-    }
-    else if (theta1 < theta2)
-    {
-      u3tmp = u1 + b;
-      if (u3tmp < u3)
-      {
-        auto fH = mesh.getFaceBetween(v1, v2, v3).unwrap();
-        cutting_faces.insert(v3, fH);
-        predecessors[v3] = v1;
-        distances[v3] = static_cast<float>(u3tmp);
-#ifdef DEBUG
-        mesh_map->publishDebugVector(v3, v1, fH, 0, mesh_map::color(0.9, 0.9, 0.2),
-                                     "dir_vec" + std::to_string(v3.idx()));
-#endif
-        direction[v3] = 0;
-        return true;
-      }
-      return false;
-    }
-    else
-    {
-      u3tmp = u2 + a;
-      if (u3tmp < u3)
-      {
-        auto fH = mesh.getFaceBetween(v1, v2, v3).unwrap();
-        cutting_faces.insert(v3, fH);
-        predecessors[v3] = v2;
-        distances[v3] = static_cast<float>(u3tmp);
-#ifdef DEBUG
-        mesh_map->publishDebugVector(v3, v2, fH, 0, mesh_map::color(0.9, 0.9, 0.2),
-                                     "dir_vec" + std::to_string(v3.idx()));
-#endif
-        direction[v3] = 0;
-        return true;
-      }
-      return false;
+      const mesh_map::Vector& goal = goals[i];
+      mesh_map->publishDebugFace(goal_face, mesh_map::color(0, 1, 0), "goal_face");
+      ROS_DEBUG_STREAM("The goal is at (" << goal.x << ", " << goal.y << ", " << goal.z << ") at the face ("
+                                         << face_vertices[0] << ", " << face_vertices[1] << ", " << face_vertices[2]
+                                         << ")");
+      mesh_map->publishDebugPoint(mesh.getVertexPosition(face_vertices[0]), mesh_map::color(0, 0, 1), "goal_face_v1");
+      mesh_map->publishDebugPoint(mesh.getVertexPosition(face_vertices[1]), mesh_map::color(0, 0, 1), "goal_face_v2");
+      mesh_map->publishDebugPoint(mesh.getVertexPosition(face_vertices[2]), mesh_map::color(0, 0, 1), "goal_face_v3");
     }
   }
-  return false;
-}
-
-uint32_t WaveFrontPlanner::waveFrontPropagation(const mesh_map::Vector& original_start,
-                                                const mesh_map::Vector& original_goal,
-                                                const lvr2::DenseEdgeMap<float>& edge_weights,
-                                                const lvr2::DenseVertexMap<float>& costs,
-                                                std::list<std::pair<mesh_map::Vector, lvr2::FaceHandle>>& path,
-                                                lvr2::DenseVertexMap<float>& distances,
-                                                lvr2::DenseVertexMap<lvr2::VertexHandle>& predecessors)
-{
-  ROS_DEBUG_STREAM("Init wave front propagation.");
 
-  const auto& mesh = mesh_map->mesh();
-  const auto& vertex_costs = mesh_map->vertexCosts();
-  auto& invalid = mesh_map->invalid;
+  // only restores the vertices touched by the previous request of this context
+  ctx.workspace.reset(mesh, distances, predecessors);
+  mesh_map::StampedVertexFlags& fixed = ctx.workspace.fixed();
+  if (ctx.direction.numValues() != mesh.nextVertexIndex())
+    ctx.direction = lvr2::DenseVertexMap<float>(mesh.nextVertexIndex(), 0);
 
-  mesh_map->publishDebugPoint(original_start, mesh_map::color(0, 1, 0), "start_point");
-  mesh_map->publishDebugPoint(original_goal, mesh_map::color(0, 0, 1), "goal_point");
+  if (goal_vertices.empty())
+  {
+    return mbf_msgs::GetPathResult::SUCCESS;
+  }
 
-  mesh_map::Vector start = original_start;
-  mesh_map::Vector goal = original_goal;
+  // a potential field seeded at the same goal can be backtracked from any start whose face has been settled. The
+  // path is backtracked along the cached vector field, the maps of the context stay untouched.
+  potential_cache.setCapacity(config.potential_cache_size);
+  const mesh_map::PotentialField::ConstPtr cached_field =
+      potential_cache.find(start_face.idx(), start, CACHED_SEED_TOLERANCE, costs.version, config.cost_limit);
+  if (cached_field && cached_field->covers(goal_vertices))
+  {
+    ROS_INFO_STREAM("Reusing the cached potential field of the goal, only backtracking the path.");
+    ctx.potential_field = cached_field;
+    ctx.vector_field = cached_field->vector_field;
+    if (ctx.store_vector_field)
+      mesh_map->setVectorField(ctx.vector_field);
+    for (size_t i = 0; i < goals.size(); i++)
+    {
+      if (outcomes[i] == mbf_msgs::GetPathResult::NO_PATH_FOUND)
+        outcomes[i] = backtrackPath(start, start_face, goals[i], goal_faces[i].unwrap(), paths[i], ctx);
+    }
+    return ctx.canceled ? mbf_msgs::GetPathResult::CANCELED : mbf_msgs::GetPathResult::SUCCESS;
+  }
 
-  // Find the containing faces of start and goal
-  const auto& start_opt = mesh_map->getContainingFace(start, 0.4);
-  const auto& goal_opt = mesh_map->getContainingFace(goal, 0.4);
+  // the vector map of the previous request has been moved into its vector field snapshot, a released one is recycled
+  ctx.vector_map = mesh_map->acquireVectorMap();
+  ctx.vector_vertices.clear();
 
-  ros::WallTime t_initialization_start = ros::WallTime::now();
+  // seed the vertices of the start face with their distance to the start
+  for (auto vH : mesh.getVerticesOfFace(start_face))
+  {
+    const mesh_map::Vector diff = start - mesh.getVertexPosition(vH);
+    const float dist = diff.length();
+    distances[vH] = dist;
+    ctx.vector_map.insert(vH, diff);
+    ctx.vector_vertices.push_back(vH);
+    ctx.cutting_faces.insert(vH, start_face);
+    ctx.workspace.touch(vH);
+    fixed.set(vH);
+  }
 
-  // reset cancel planning
-  cancel_planning = false;
+  ros::WallTime t_wavefront_start = ros::WallTime::now();
+  double initialization_duration = (t_wavefront_start - t_initialization_start).toNSec() * 1e-6;
 
-  if (!start_opt)
-    return mbf_msgs::GetPathResult::INVALID_START;
-  if (!goal_opt)
-    return mbf_msgs::GetPathResult::INVALID_GOAL;
+  const size_t fixed_set_cnt = propagateWaveFront(face_geometry, vertex_costs, start_face, goal_vertices, ctx);
 
-  const auto& start_face = start_opt.unwrap();
-  const auto& goal_face = goal_opt.unwrap();
+  if (ctx.canceled)
+  {
+    ROS_WARN_STREAM("Wave front propagation has been canceled!");
+    return mbf_msgs::GetPathResult::CANCELED;
+  }
+  ros::WallTime t_wavefront_end = ros::WallTime::now();
+  double wavefront_propagation_duration = (t_wavefront_end - t_wavefront_start).toNSec() * 1e-6;
+  ROS_DEBUG_STREAM("Finished wave front propagation.");
+  ROS_DEBUG_STREAM("Computing the vector map...");
+  computeVectorMap(ctx);
 
-  mesh_map->publishDebugFace(start_face, mesh_map::color(0, 0, 1), "start_face");
-  mesh_map->publishDebugFace(goal_face, mesh_map::color(0, 1, 0), "goal_face");
+  ros::WallTime t_vector_field_end = ros::WallTime::now();
+  double vector_field_duration = (t_vector_field_end - t_wavefront_end).toNSec() * 1e-6;
 
-  path.clear();
-  distances.clear();
-  predecessors.clear();
+  // a goal can be backtracked if the predecessor of one of its face vertices is set
+  std::vector<bool> path_exists(goals.size(), false);
+  bool any_path_exists = false;
+  for (size_t i = 0; i < goals.size(); i++)
+  {
+    if (outcomes[i] != mbf_msgs::GetPathResult::NO_PATH_FOUND)
+      continue;
+    for (auto goal_vertex : mesh.getVerticesOfFace(goal_faces[i].unwrap()))
+    {
+      if (goal_vertex != predecessors[goal_vertex])
+      {
+        path_exists[i] = true;
+        any_path_exists = true;
+        break;
+      }
+    }
+  }
 
-  if (goal_face == start_face)
+  if (!any_path_exists)
   {
+    // the outcomes of the goals remain NO_PATH_FOUND
+    ROS_WARN("Predecessor of the goal is not set! No path found!");
     return mbf_msgs::GetPathResult::SUCCESS;
   }
 
-  lvr2::DenseVertexMap<bool> fixed(mesh.nextVertexIndex(), false);
-
-  // clear vector field map
-  vector_map.clear();
+  if (config.potential_cache_size > 0)
+  {
+    auto field = std::make_shared<mesh_map::PotentialField>();
+    field->seed = start;
+    field->seed_index = start_face.idx();
+    field->costs_version = costs.version;
+    field->cost_limit = config.cost_limit;
+    field->storeSettled(ctx.workspace.touchedVertices(), distances, predecessors, fixed);
+    field->vector_field = ctx.vector_field;
+    potential_cache.insert(field);
+  }
 
-  // initialize distances with infinity
-  // initialize predecessor of each vertex with itself
-  for (auto const& vH : mesh.vertices())
+  for (size_t i = 0; i < goals.size(); i++)
   {
-    distances.insert(vH, std::numeric_limits<float>::infinity());
-    predecessors.insert(vH, vH);
+    if (path_exists[i])
+      outcomes[i] = backtrackPath(start, start_face, goals[i], goal_faces[i].unwrap(), paths[i], ctx);
   }
 
-  lvr2::Meap<lvr2::VertexHandle, float> pq;
-  // Set start distance to zero
-  // add start vertex to priority queue
+  if (ctx.canceled)
+    return mbf_msgs::GetPathResult::CANCELED;
+
+  ros::WallTime t_path_backtracking = ros::WallTime::now();
+  double path_backtracking_duration = (t_path_backtracking - t_vector_field_end).toNSec() * 1e-6;
+
+  ROS_INFO_STREAM("Processed " << fixed_set_cnt << " vertices in the fixed set.");
+  ROS_INFO_STREAM("Initialization duration (ms): " << initialization_duration);
+  ROS_INFO_STREAM("Execution time wavefront propagation (ms): "<< wavefront_propagation_duration);
+  ROS_INFO_STREAM("Vector field post computation (ms): " << vector_field_duration);
+  ROS_INFO_STREAM("Path backtracking duration (ms): " << path_backtracking_duration);
+  return mbf_msgs::GetPathResult::SUCCESS;
+}
+
+size_t WaveFrontPlanner::propagateWaveFront(const mesh_map::FaceGeometry& face_geometry,
+                                            const mesh_map::SharedVertexCosts& vertex_costs,
+                                            const lvr2::FaceHandle& start_face,
+                                            const std::vector<lvr2::VertexHandle>& goal_vertices,
+                                            PlanningContext& ctx)
+{
+  const auto& mesh = mesh_map->mesh();
+  const auto& graph = mesh_map->compactMesh();
+  const auto& vertex_faces = graph.vertexFaces();
+  const auto& face_vertices = graph.faceVertices();
+  const auto& invalid = mesh_map->invalid;
+  lvr2::DenseVertexMap<float>& distances = ctx.potential;
+  mesh_map::StampedVertexFlags& fixed = ctx.workspace.fixed();
+
+  mesh_map::VertexPriorityQueue::Ptr pq_ptr =
+      mesh_map::createVertexPriorityQueue(priority_queue_type, mesh.nextVertexIndex());
+  mesh_map::VertexPriorityQueue& pq = *pq_ptr;
   for (auto vH : mesh.getVerticesOfFace(start_face))
   {
-    const mesh_map::Vector diff = start - mesh.getVertexPosition(vH);
-    const float dist = diff.length();
-    distances[vH] = dist;
-    vector_map.insert(vH, diff);
-    cutting_faces.insert(vH, start_face);
-    fixed[vH] = true;
-    pq.insert(vH, dist);
+    pq.insert(vH, distances[vH]);
   }
 
-  std::array<lvr2::VertexHandle, 3> goal_vertices = mesh.getVerticesOfFace(goal_face);
-  ROS_DEBUG_STREAM("The goal is at (" << goal.x << ", " << goal.y << ", " << goal.z << ") at the face ("
-                                     << goal_vertices[0] << ", " << goal_vertices[1] << ", " << goal_vertices[2]
-                                     << ")");
-  mesh_map->publishDebugPoint(mesh.getVertexPosition(goal_vertices[0]), mesh_map::color(0, 0, 1), "goal_face_v1");
-  mesh_map->publishDebugPoint(mesh.getVertexPosition(goal_vertices[1]), mesh_map::color(0, 0, 1), "goal_face_v2");
-  mesh_map->publishDebugPoint(mesh.getVertexPosition(goal_vertices[2]), mesh_map::color(0, 0, 1), "goal_face_v3");
+  // flag the goal vertices, the goal is reached as soon as all of them have been fixed
+  mesh_map::StampedVertexFlags& goal_flags = ctx.goal_flags;
+  goal_flags.reset(mesh.nextVertexIndex());
+  size_t open_goal_cnt = 0;
+  for (const auto& vH : goal_vertices)
+  {
+    if (!goal_flags[vH])
+    {
+      goal_flags.set(vH);
+      open_goal_cnt++;
+    }
+  }
 
   float goal_dist = std::numeric_limits<float>::infinity();
 
-  ROS_DEBUG_STREAM("Start wavefront propagation...");
+  // the full field mode does not stop at the goal, the whole potential is cached for later plans
+  const bool full_field = config.propagation_mode == WaveFrontPlanner_FullField;
+  ROS_DEBUG_STREAM("Start wavefront propagation in the " << propagationModeName(config.propagation_mode) << " mode...");
 
   size_t fixed_cnt = 0;
   size_t fixed_set_cnt = 0;
-  ros::WallTime t_wavefront_start = ros::WallTime::now();
-  double initialization_duration = (t_wavefront_start - t_initialization_start).toNSec() * 1e-6;
+  size_t expanded_cnt = 0;
 
-  while (!pq.isEmpty() && !cancel_planning)
+  while (!pq.isEmpty() && !ctx.canceled)
   {
-    lvr2::VertexHandle current_vh = pq.popMin().key();
+    lvr2::VertexHandle current_vh = pq.popMin();
 
-    fixed[current_vh] = true;
+    fixed.set(current_vh);
     fixed_set_cnt++;
 
+    // the vertices are popped in ascending distance order, all remaining vertices are beyond the goal band
     if (distances[current_vh] > goal_dist)
-      continue;
-
-    if (vertex_costs[current_vh] > config.cost_limit)
-      continue;
-
-    if (invalid[current_vh])
-      continue;
+      break;
 
-    if (current_vh == goal_vertices[0] || current_vh == goal_vertices[1] || current_vh == goal_vertices[2])
+    // impassable goal vertices are fixed as well, the goal face can still be reached over the other vertices
+    if (!full_field && goal_flags[current_vh])
     {
-      if (goal_dist == std::numeric_limits<float>::infinity() && fixed[goal_vertices[0]] && fixed[goal_vertices[1]] &&
-          fixed[goal_vertices[2]])
+      goal_flags.unset(current_vh);
+      if (--open_goal_cnt == 0)
       {
         ROS_DEBUG_STREAM("Wave front reached the goal!");
-        goal_dist = distances[current_vh] + goal_dist_offset;
+        goal_dist = distances[current_vh] + config.goal_dist_offset;
       }
     }
 
-    try
-    {
-      std::vector<lvr2::FaceHandle> faces;
-      mesh.getFacesOfVertex(current_vh, faces);
+    if (vertex_costs[current_vh] > config.cost_limit)
+      continue;
 
-      for (auto fh : faces)
-      {
-        const auto vertices = mesh.getVerticesOfFace(fh);
-        const lvr2::VertexHandle& a = vertices[0];
-        const lvr2::VertexHandle& b = vertices[1];
-        const lvr2::VertexHandle& c = vertices[2];
+    if (invalid[current_vh])
+      continue;
 
-        if (invalid[a] || invalid[b] || invalid[c])
-          continue;
+    expanded_cnt++;
 
-        // We are looking for a face where exactly
-        // one vertex is not in the fixed set
-        if (fixed[a] && fixed[b] && fixed[c])
-        {
+    const lvr2::Index faces_end = graph.facesEnd(current_vh);
+    for (lvr2::Index i = graph.facesBegin(current_vh); i < faces_end; i++)
+    {
+      const lvr2::FaceHandle fh(vertex_faces[i]);
+      const lvr2::Index* vertices = &face_vertices[3 * fh.idx()];
+      const lvr2::VertexHandle a(vertices[0]);
+      const lvr2::VertexHandle b(vertices[1]);
+      const lvr2::VertexHandle c(vertices[2]);
+
+      if (invalid[a] || invalid[b] || invalid[c])
+        continue;
+
+      // We are looking for a face where exactly
+      // one vertex is not in the fixed set
+      if (fixed[a] && fixed[b] && fixed[c])
+      {
 // The face's vertices are already optimal
 // with respect to the distance
 #ifdef DEBUG
-          mesh_map->publishDebugFace(fh, mesh_map::color(1, 0, 0), "fmm_fixed_" + std::to_string(fixed_cnt++));
+        mesh_map->publishDebugFace(fh, mesh_map::color(1, 0, 0), "fmm_fixed_" + std::to_string(fixed_cnt++));
 #endif
-          continue;
-        }
-        else if (fixed[a] && fixed[b] && !fixed[c])
-        {
-          // c is free
+        continue;
+      }
+      else if (fixed[a] && fixed[b] && !fixed[c])
+      {
+        // c is free
 #ifdef USE_UPDATE_WITH_S
-          if (waveFrontUpdateWithS(distances, edge_weights, a, b, c))
+        const mesh_map::TriangleCorner& corner = face_geometry.corner(fh, 2);
+        if (waveFrontUpdateWithS(distances, corner.a, corner.b, corner.c, a, b, c, fh, ctx))
 #else
-          if (waveFrontUpdate(distances, edge_weights, a, b, c))
+        if (waveFrontUpdate(distances, face_geometry.corner(fh, 2), a, b, c, fh, ctx))
 #endif
-          {
-            pq.insert(c, distances[c]);
+        {
+          ctx.workspace.touch(c);
+          pq.insert(c, distances[c]);
 #ifdef DEBUG
-            mesh_map->publishDebugFace(fh, mesh_map::color(0, 1, 1), "fmm_update");
-            sleep(2);
+          mesh_map->publishDebugFace(fh, mesh_map::color(0, 1, 1), "fmm_update");
+          sleep(2);
 #endif
-          }
         }
-        else if (fixed[a] && !fixed[b] && fixed[c])
-        {
-          // b is free
+      }
+      else if (fixed[a] && !fixed[b] && fixed[c])
+      {
+        // b is free
 #ifdef USE_UPDATE_WITH_S
-          if (waveFrontUpdateWithS(distances, edge_weights, c, a, b))
+        const mesh_map::TriangleCorner& corner = face_geometry.corner(fh, 1);
+        if (waveFrontUpdateWithS(distances, corner.a, corner.b, corner.c, c, a, b, fh, ctx))
 #else
-          if (waveFrontUpdate(distances, edge_weights, c, a, b))
+        if (waveFrontUpdate(distances, face_geometry.corner(fh, 1), c, a, b, fh, ctx))
 #endif
-          {
-            pq.insert(b, distances[b]);
+        {
+          ctx.workspace.touch(b);
+          pq.insert(b, distances[b]);
 #ifdef DEBUG
-            mesh_map->publishDebugFace(fh, mesh_map::color(0, 1, 1), "fmm_update");
-            sleep(2);
+          mesh_map->publishDebugFace(fh, mesh_map::color(0, 1, 1), "fmm_update");
+          sleep(2);
 #endif
-          }
         }
-        else if (!fixed[a] && fixed[b] && fixed[c])
-        {
-          // a if free
+      }
+      else if (!fixed[a] && fixed[b] && fixed[c])
+      {
+        // a if free
 #ifdef USE_UPDATE_WITH_S
-          if (waveFrontUpdateWithS(distances, edge_weights, b, c, a))
+        const mesh_map::TriangleCorner& corner = face_geometry.corner(fh, 0);
+        if (waveFrontUpdateWithS(distances, corner.a, corner.b, corner.c, b, c, a, fh, ctx))
 #else
-          if (waveFrontUpdate(distances, edge_weights, b, c, a))
+        if (waveFrontUpdate(distances, face_geometry.corner(fh, 0), b, c, a, fh, ctx))
 #endif
-          {
-            pq.insert(a, distances[a]);
+        {
+          ctx.workspace.touch(a);
+          pq.insert(a, distances[a]);
 #ifdef DEBUG
-            mesh_map->publishDebugFace(fh, mesh_map::color(0, 1, 1), "fmm_update");
-            sleep(2);
+          mesh_map->publishDebugFace(fh, mesh_map::color(0, 1, 1), "fmm_update");
+          sleep(2);
 #endif
-          }
-        }
-        else
-        {
-          // two free vertices -> skip that face
-          continue;
         }
       }
-    }
-    catch (lvr2::PanicException exception)
-    {
-      invalid.insert(current_vh, true);
-      ROS_ERROR_STREAM("Found invalid vertex!");
-      continue;
-    }
-    catch (lvr2::VertexLoopException exception)
-    {
-      invalid.insert(current_vh, true);
-      ROS_ERROR_STREAM("Found invalid vertex!");
-      continue;
+      else
+      {
+        // two free vertices -> skip that face
+        continue;
+      }
     }
   }
 
-  if (cancel_planning)
-  {
-    ROS_WARN_STREAM("Wave front propagation has been canceled!");
-    return mbf_msgs::GetPathResult::CANCELED;
-  }
-  ros::WallTime t_wavefront_end = ros::WallTime::now();
-  double wavefront_propagation_duration = (t_wavefront_end - t_wavefront_start).toNSec() * 1e-6;
-  ROS_DEBUG_STREAM("Finished wave front propagation.");
-  ROS_DEBUG_STREAM("Computing the vector map...");
-  computeVectorMap();
-
-  ros::WallTime t_vector_field_end = ros::WallTime::now();
-  double vector_field_duration = (t_vector_field_end - t_wavefront_end).toNSec() * 1e-6;
-
-  bool path_exists = false;
-  for (auto goal_vertex : goal_vertices)
-  {
-    if (goal_vertex != predecessors[goal_vertex])
-    {
-      path_exists = true;
-      break;
-    }
-  }
+  ROS_INFO_STREAM("Expanded " << expanded_cnt << " of " << mesh.numVertices() << " vertices in the "
+                              << propagationModeName(config.propagation_mode) << " mode.");
+  return fixed_set_cnt;
+}
 
-  if (!path_exists)
+std::string WaveFrontPlanner::propagationModeName(const int propagation_mode)
+{
+  switch (propagation_mode)
   {
-    ROS_WARN("Predecessor of the goal is not set! No path found!");
-    return mbf_msgs::GetPathResult::NO_PATH_FOUND;
+    case WaveFrontPlanner_FullField:
+      return "full field";
+    default:
+      return "early exit";
   }
+}
 
+uint32_t WaveFrontPlanner::backtrackPath(const mesh_map::Vector& start, const lvr2::FaceHandle& start_face,
+                                         const mesh_map::Vector& goal, const lvr2::FaceHandle& goal_face,
+                                         std::list<std::pair<mesh_map::Vector, lvr2::FaceHandle>>& path,
+                                         const PlanningContext& ctx)
+{
   ROS_DEBUG_STREAM("Start vector field back tracking!");
+  if (!ctx.vector_field)
+    return mbf_msgs::GetPathResult::NO_PATH_FOUND;
 
   lvr2::FaceHandle current_face = goal_face;
   mesh_map::Vector current_pos = goal;
   path.push_front(std::pair<mesh_map::Vector, lvr2::FaceHandle>(current_pos, current_face));
 
   // move from the goal position towards the start position
-  while (current_pos.distance2(start) > config.step_width && !cancel_planning)
+  while (current_pos.distance2(start) > config.step_width && !ctx.canceled)
   {
     // move current pos ahead on the surface following the vector field,
     // updates the current face if necessary
     try
     {
-      if (mesh_map->meshAhead(current_pos, current_face, config.step_width))
+      // follow the vector field of this request, the latest one of the map may belong to a concurrent request
+      if (mesh_map->meshAhead(current_pos, current_face, config.step_width, *ctx.vector_field))
       {
         path.push_front(std::pair<mesh_map::Vector, lvr2::FaceHandle>(current_pos, current_face));
       }
@@ -795,16 +839,7 @@ uint32_t WaveFrontPlanner::waveFrontPropagation(const mesh_map::Vector& original
   }
   path.push_front(std::pair<mesh_map::Vector, lvr2::FaceHandle>(start, start_face));
 
-  ros::WallTime t_path_backtracking = ros::WallTime::now();
-  double path_backtracking_duration = (t_path_backtracking - t_vector_field_end).toNSec() * 1e-6;
-
-  ROS_INFO_STREAM("Processed " << fixed_set_cnt << " vertices in the fixed set.");
-  ROS_INFO_STREAM("Initialization duration (ms): " << initialization_duration);
-  ROS_INFO_STREAM("Execution time wavefront propagation (ms): "<< wavefront_propagation_duration);
-  ROS_INFO_STREAM("Vector field post computation (ms): " << vector_field_duration);
-  ROS_INFO_STREAM("Path backtracking duration (ms): " << path_backtracking_duration);
-
-  if (cancel_planning)
+  if (ctx.canceled)
   {
     ROS_WARN_STREAM("Wave front propagation has been canceled!");
     return mbf_msgs::GetPathResult::CANCELED;